@@ -0,0 +1,25 @@
+#include "AllocationCounter.h"
+
+// The counter of each thread is a plain pointer which needs no construction,
+// so it can be read by the allocation functions of a thread at any time.
+static thread_local AllocationCounter::Counter* t_counter = nullptr;
+
+uint64_t AllocationCounter::get_number_of_allocations(const Counter& counter)
+{
+    return counter.number_of_allocations.load(std::memory_order_relaxed);
+}
+
+AllocationCounter::Counter* AllocationCounter::set_thread_counter(Counter* counter)
+{
+    auto previous_counter = t_counter;
+    t_counter = counter;
+    return previous_counter;
+}
+
+void AllocationCounter::add_allocation()
+{
+    if (t_counter != nullptr)
+    {
+        t_counter->number_of_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Counts the heap allocations per group of threads, e.g. of the threads of one receiver.
+// It is used to check that the frame loop doesn't allocate once it is warmed up.
+// The allocations are only counted if AllocationInterposer.cpp is linked, like in the command line application.
+// With glibc, every malloc is counted then which includes the allocations of Eigen.
+// Otherwise, only the allocations by the operator new are counted.
+namespace AllocationCounter
+{
+    // The allocations of all threads which are attributed to the counter.
+    struct Counter
+    {
+        std::atomic<uint64_t> number_of_allocations{ 0 };
+    };
+
+    // Returns the number of heap allocations of the threads which were attributed to the counter so far.
+    uint64_t get_number_of_allocations(const Counter& counter);
+
+    // Attributes the following heap allocations of the calling thread to the counter, or to none if it is nullptr.
+    // Returns the counter which the thread was attributed to before.
+    Counter* set_thread_counter(Counter* counter);
+
+    // Is called by the allocation functions of the interposer.
+    void add_allocation();
+
+    // Attributes the heap allocations of the calling thread to the counter from its construction to its destruction.
+    class ScopedThreadCounter final
+    {
+    public:
+        explicit ScopedThreadCounter(Counter* counter) :
+            m_previous_counter(set_thread_counter(counter))
+        {
+
+        }
+
+        ~ScopedThreadCounter()
+        {
+            set_thread_counter(m_previous_counter);
+        }
+
+        ScopedThreadCounter(const ScopedThreadCounter&) = delete;
+        ScopedThreadCounter& operator=(const ScopedThreadCounter&) = delete;
+
+    private:
+        Counter* m_previous_counter;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "AllocationCounter.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+// Replaces the allocation functions of the process so that AllocationCounter counts every heap allocation.
+// It is only linked into the command line application, so the library doesn't replace the allocator
+// of an application which embeds it.
+
+#if defined(__GLIBC__)
+
+// glibc allows to replace its allocation functions by functions which forward to the internal ones.
+// All of them are replaced together, so memory is always freed by the allocator which allocated it.
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t number, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void* pointer);
+
+    void* malloc(size_t size)
+    {
+        AllocationCounter::add_allocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t number, size_t size)
+    {
+        AllocationCounter::add_allocation();
+        return __libc_calloc(number, size);
+    }
+
+    void* realloc(void* pointer, size_t size)
+    {
+        AllocationCounter::add_allocation();
+        return __libc_realloc(pointer, size);
+    }
+
+    void free(void* pointer)
+    {
+        __libc_free(pointer);
+    }
+
+    void* memalign(size_t alignment, size_t size)
+    {
+        AllocationCounter::add_allocation();
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size)
+    {
+        AllocationCounter::add_allocation();
+        return __libc_memalign(alignment, size);
+    }
+
+    // The alignment must be a power of two multiple of the size of a pointer, see POSIX.
+    int posix_memalign(void** pointer, size_t alignment, size_t size)
+    {
+        if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        {
+            return EINVAL;
+        }
+
+        AllocationCounter::add_allocation();
+        auto memory = __libc_memalign(alignment, size);
+        if (memory == nullptr)
+        {
+            return ENOMEM;
+        }
+
+        *pointer = memory;
+        return 0;
+    }
+}
+
+#else
+
+void* operator new(std::size_t size)
+{
+    AllocationCounter::add_allocation();
+    auto pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "Arena.h"
+
+#include <new>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+Arena::Arena(size_t capacity, bool use_huge_pages) :
+    m_memory(nullptr),
+    m_capacity(capacity),
+    m_used_size(0),
+    m_is_mapped(false),
+    m_is_hugetlb_mapped(false)
+{
+#if defined(__linux__)
+    if (use_huge_pages)
+    {
+        // The capacity must be a multiple of the huge page size.
+        m_capacity = ((capacity + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+        auto memory = mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+            m_memory = static_cast<uint8_t*>(memory);
+            m_is_mapped = true;
+            m_is_hugetlb_mapped = true;
+            return;
+        }
+
+        // If no huge pages are reserved, transparent huge pages are requested instead.
+        memory = mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+            madvise(memory, m_capacity, MADV_HUGEPAGE);
+            m_memory = static_cast<uint8_t*>(memory);
+            m_is_mapped = true;
+            return;
+        }
+    }
+#endif
+
+    m_memory = static_cast<uint8_t*>(operator new(m_capacity, std::align_val_t(ALIGNMENT)));
+}
+
+Arena::~Arena()
+{
+#if defined(__linux__)
+    if (m_is_mapped)
+    {
+        munmap(m_memory, m_capacity);
+        return;
+    }
+#endif
+
+    operator delete(m_memory, std::align_val_t(ALIGNMENT));
+}
+
+void* Arena::allocate_bytes(size_t size)
+{
+    auto start = ((m_used_size + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+    if (start + size > m_capacity)
+    {
+        throw std::logic_error("The capacity of the arena is exceeded.");
+    }
+
+    m_used_size = start + size;
+    return m_memory + start;
+}
+
+size_t Arena::get_used_size() const
+{
+    return m_used_size;
+}
+
+bool Arena::get_huge_pages_used() const
+{
+    return m_is_hugetlb_mapped;
+}
+
+bool Arena::get_transparent_huge_pages_requested() const
+{
+    return m_is_mapped && !m_is_hugetlb_mapped;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A preallocated block of memory from which the buffers of a receiver are taken.
+// The buffers are never freed individually. All of them are released together with the arena,
+// so the frame loop doesn't need any heap allocations.
+class Arena final
+{
+public:
+    // If use_huge_pages is set, the memory is tried to be backed by huge pages
+    // which reduces the TLB misses for the large sample buffers.
+    Arena(size_t capacity, bool use_huge_pages);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Returns uninitialized memory for count values of the type T.
+    // It throws if the capacity of the arena is exceeded.
+    template <typename T>
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(allocate_bytes(count * sizeof(T)));
+    }
+
+    size_t get_used_size() const;
+
+    // Returns whether the memory is backed by explicitly reserved huge pages.
+    bool get_huge_pages_used() const;
+
+    // Returns whether transparent huge pages are requested for the memory
+    // since no huge pages were reserved. The kernel may still use normal pages.
+    bool get_transparent_huge_pages_requested() const;
+
+private:
+    // The alignment of every allocation which is sufficient for all vector instructions.
+    static constexpr size_t ALIGNMENT = 64;
+
+    // The size of a huge page on x86-64.
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    void* allocate_bytes(size_t size);
+
+    uint8_t* m_memory;
+    size_t m_capacity;
+    size_t m_used_size;
+    bool m_is_mapped;
+    bool m_is_hugetlb_mapped;
+};
\ No newline at end of file
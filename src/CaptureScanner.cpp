@@ -0,0 +1,69 @@
+#include "CaptureScanner.h"
+#include "DabConstants.h"
+#include "NullSymbolDetector.h"
+#include "RawFileHandler.h"
+#include "Resampler.h"
+
+#include "Eigen/Dense"
+
+using namespace DabConstants;
+
+// The number of samples which are read and processed at once.
+static constexpr int BLOCK_SIZE = 32'768;
+
+// The number of Null symbols in a row which must be found exactly one frame apart
+// before the file is classified as DAB signal.
+static constexpr int REQUIRED_CONSECUTIVE_FRAMES = 4;
+
+// The file is read only once and the power of each sample is shared by the detectors of all transmission modes.
+// The detectors are checked in the order of decreasing length of the Null symbol
+// because a detector also finds the longer Null symbols of other transmission modes with the same frame length.
+// The scan stops as soon as the file is classified as DAB signal.
+std::optional<TransmissionModeId> CaptureScanner::scan(const std::string& file_path, SampleFormat sample_format, int sample_rate)
+{
+    auto sample_source = open_sample_file(file_path, sample_format);
+    if (sample_rate != SAMPLE_RATE)
+    {
+        sample_source = std::make_unique<Resampler>(std::move(sample_source), sample_rate, SAMPLE_RATE);
+    }
+    auto signal_td{ Eigen::VectorXcf(BLOCK_SIZE) };
+    auto power{ Eigen::VectorXf(BLOCK_SIZE) };
+
+    auto null_symbol_detector_mode_i{ NullSymbolDetector<TransmissionModeI>() };
+    auto null_symbol_detector_mode_ii{ NullSymbolDetector<TransmissionModeII>() };
+    auto null_symbol_detector_mode_iii{ NullSymbolDetector<TransmissionModeIII>() };
+    auto null_symbol_detector_mode_iv{ NullSymbolDetector<TransmissionModeIV>() };
+
+    while (true)
+    {
+        sample_source->read(signal_td, 0, BLOCK_SIZE - 1);
+        if (sample_source->get_file_end_reached())
+        {
+            return std::nullopt;
+        }
+
+        power = signal_td.cwiseAbs2();
+
+        null_symbol_detector_mode_i.process(power);
+        null_symbol_detector_mode_ii.process(power);
+        null_symbol_detector_mode_iii.process(power);
+        null_symbol_detector_mode_iv.process(power);
+
+        if (null_symbol_detector_mode_i.get_number_of_consecutive_frames() >= REQUIRED_CONSECUTIVE_FRAMES)
+        {
+            return TransmissionModeId::I;
+        }
+        else if (null_symbol_detector_mode_iv.get_number_of_consecutive_frames() >= REQUIRED_CONSECUTIVE_FRAMES)
+        {
+            return TransmissionModeId::IV;
+        }
+        else if (null_symbol_detector_mode_ii.get_number_of_consecutive_frames() >= REQUIRED_CONSECUTIVE_FRAMES)
+        {
+            return TransmissionModeId::II;
+        }
+        else if (null_symbol_detector_mode_iii.get_number_of_consecutive_frames() >= REQUIRED_CONSECUTIVE_FRAMES)
+        {
+            return TransmissionModeId::III;
+        }
+    }
+}
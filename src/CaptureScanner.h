@@ -0,0 +1,16 @@
+#pragma once
+
+#include "DabConstants.h"
+#include "RawFileHandler.h"
+
+#include <optional>
+#include <string>
+
+namespace CaptureScanner
+{
+    // Classifies a raw IQ file as DAB signal or not by only detecting its Null symbols.
+    // Returns the transmission mode of the DAB signal if one is found.
+    // If the sample rate differs from the sample rate of the receiver, the samples are resampled,
+    // since the lengths of the Null symbols are detected in samples.
+    std::optional<DabConstants::TransmissionModeId> scan(const std::string& file_path, SampleFormat sample_format, int sample_rate);
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "Channelizer.h"
+#include "DabConstants.h"
+#include "FilterDesign.h"
+#include "Tracing.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <algorithm>
+
+using namespace DabConstants;
+using namespace std::complex_literals;
+
+// Half of the bandwidth around the center of a DAB signal in Hz which must be free of aliases.
+// Beyond it, the resampler to 2.048 MS/s aliases the signal only onto carriers which aren't used.
+static constexpr double ALIAS_FREE_HALF_BANDWIDTH = SAMPLE_RATE - DAB_HALF_BANDWIDTH;
+
+Channelizer::Channelizer(std::shared_ptr<SampleSource> input_sample_source, double input_sample_rate, const std::vector<int>& channel_frequencies) :
+    m_input_sample_source(std::move(input_sample_source)),
+    m_input_sample_rate(input_sample_rate),
+    m_n_bins(get_number_of_bins(input_sample_rate)),
+    m_decimation(m_n_bins / OVERSAMPLING),
+    m_filter_length(N_TAPS_PER_BIN * m_n_bins),
+    m_reversed_prototype_filter(create_prototype_filter(m_n_bins, input_sample_rate).reverse()),
+    m_fft_calculator(m_n_bins),
+    m_input_buffer(Eigen::VectorXcf::Zero(m_filter_length - 1 + m_decimation * OUTPUT_BLOCK_SIZE)),
+    m_weighted_input(m_filter_length),
+    m_folded_input(m_n_bins),
+    m_bins(m_n_bins),
+    m_output_time(0),
+    m_channels()
+{
+    auto bin_spacing = input_sample_rate / m_n_bins;
+    for (auto channel_frequency : channel_frequencies)
+    {
+        auto signed_bin_index = static_cast<int>(std::lround(channel_frequency / bin_spacing));
+        auto residual_frequency = channel_frequency - signed_bin_index * bin_spacing;
+
+        auto channel{ Channel() };
+        channel.bin_index = (signed_bin_index % m_n_bins + m_n_bins) % m_n_bins;
+        channel.mixer_phase_step = residual_frequency / get_channel_sample_rate();
+        channel.mixer_phase = 0.0;
+        channel.output_block = Eigen::VectorXcf(OUTPUT_BLOCK_SIZE);
+        channel.queue = std::make_shared<SampleQueue>(QUEUE_CAPACITY);
+        m_channels.push_back(channel);
+    }
+}
+
+// The number of bins is a multiple of OVERSAMPLING so that the decimation is an integer.
+int Channelizer::get_number_of_bins(double input_sample_rate)
+{
+    auto number_of_decimated_bins = static_cast<int>(std::lround(input_sample_rate / (OVERSAMPLING * TARGET_BIN_SPACING)));
+    return OVERSAMPLING * std::max(1, number_of_decimated_bins);
+}
+
+// The passband must contain a DAB signal whose center lies up to half of the bin spacing away from the bin center.
+// The stopband must begin early enough so that nothing is aliased into the alias-free bandwidth around the DAB signal.
+Eigen::VectorXf Channelizer::create_prototype_filter(int n_bins, double input_sample_rate)
+{
+    auto bin_spacing = input_sample_rate / n_bins;
+    auto channel_sample_rate = OVERSAMPLING * bin_spacing;
+    auto passband_edge = DAB_HALF_BANDWIDTH + bin_spacing / 2;
+    auto stopband_edge = channel_sample_rate - (ALIAS_FREE_HALF_BANDWIDTH + bin_spacing / 2);
+    auto cutoff = (passband_edge + stopband_edge) / (2 * input_sample_rate);
+
+    auto prototype_filter{ FilterDesign::create_kaiser_lowpass(N_TAPS_PER_BIN * n_bins, cutoff).cast<float>().eval() };
+
+    // The gain at the bin centers is 1.
+    return prototype_filter / prototype_filter.sum();
+}
+
+double Channelizer::get_channel_sample_rate() const
+{
+    return m_input_sample_rate / m_decimation;
+}
+
+std::shared_ptr<SampleQueue> Channelizer::get_channel_queue(int channel_index) const
+{
+    return m_channels[channel_index].queue;
+}
+
+void Channelizer::run()
+{
+    auto history_length = m_filter_length - 1;
+    auto block_length = m_decimation * OUTPUT_BLOCK_SIZE;
+
+    while (true)
+    {
+        m_input_sample_source->read(m_input_buffer, history_length, history_length + block_length - 1);
+        if (m_input_sample_source->get_file_end_reached())
+        {
+            break;
+        }
+
+        {
+            auto span{ Tracing::ScopedSpan("Channelizer::calculate_output_block") };
+            for (int i = 0; i < OUTPUT_BLOCK_SIZE; i++)
+            {
+                calculate_output(history_length + (i + 1) * m_decimation - 1, i);
+            }
+        }
+
+        for (auto& channel : m_channels)
+        {
+            channel.queue->push(channel.output_block.data(), OUTPUT_BLOCK_SIZE);
+        }
+
+        m_input_buffer.head(history_length) = m_input_buffer.tail(history_length);
+    }
+
+    for (auto& channel : m_channels)
+    {
+        channel.queue->close();
+    }
+}
+
+// The bin k at the time t is given by the sum over m of h[m] * x[t - m] * exp(-j * 2 * pi * k * (t - m) / N_BINS).
+// The products h[m] * x[t - m] are folded into N_BINS values so that all bins are calculated by a single FFT of the size N_BINS.
+// Since the folded values are in reverse order, the FFT result of the bin k is additionally rotated by exp(-j * 2 * pi * k * (t + 1) / N_BINS).
+void Channelizer::calculate_output(int input_end_index, int output_index)
+{
+    auto window = m_input_buffer.segment(input_end_index - m_filter_length + 1, m_filter_length);
+    m_weighted_input = window.cwiseProduct(m_reversed_prototype_filter.cast<std::complex<float>>());
+    m_folded_input = Eigen::Map<const Eigen::MatrixXcf>(m_weighted_input.data(), m_n_bins, N_TAPS_PER_BIN).rowwise().sum();
+    m_fft_calculator.fft(m_folded_input.data(), m_bins.data());
+
+    // The time t + 1 of the next output sample modulo the number of bins.
+    m_output_time = (m_output_time + m_decimation) % m_n_bins;
+
+    for (auto& channel : m_channels)
+    {
+        auto rotation_phase = static_cast<double>((static_cast<int64_t>(channel.bin_index) * m_output_time) % m_n_bins) / m_n_bins;
+        auto phase = rotation_phase + channel.mixer_phase;
+        channel.output_block[output_index] = m_bins[channel.bin_index] * std::polar(1.0f, static_cast<float>(-2.0 * M_PI * phase));
+
+        channel.mixer_phase = channel.mixer_phase + channel.mixer_phase_step;
+        channel.mixer_phase = channel.mixer_phase - std::floor(channel.mixer_phase);
+    }
+}
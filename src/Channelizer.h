@@ -0,0 +1,91 @@
+#pragma once
+
+#include "SampleSource.h"
+#include "SampleQueue.h"
+#include "FftCalculator.h"
+
+#include "Eigen/Dense"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Splits a wideband signal into several narrowband channels by an FFT based polyphase filter bank.
+// The filter bank divides the input bandwidth into N_BINS bins of which only the bins of the selected channels are used.
+// Since the bins are decimated by only N_BINS / OVERSAMPLING, a DAB channel fits into one bin
+// even if its center frequency lies between two bins.
+// The remaining frequency offset of each channel is removed by a mixer after the filter bank.
+class Channelizer final
+{
+public:
+    // The channel frequencies are given in Hz relative to the center frequency of the input signal.
+    Channelizer(std::shared_ptr<SampleSource> input_sample_source, double input_sample_rate, const std::vector<int>& channel_frequencies);
+
+    // Returns the sample rate of the channels.
+    double get_channel_sample_rate() const;
+
+    // Returns the queue into which the samples of the given channel are pushed.
+    std::shared_ptr<SampleQueue> get_channel_queue(int channel_index) const;
+
+    // Reads the whole input signal and pushes the samples of every channel into its queue.
+    // Afterwards, the queues are closed.
+    void run();
+
+private:
+    // The bin spacing which the number of bins is chosen for.
+    // A DAB signal of 1.536 MHz plus the distance to the nearest bin center
+    // fits into the passband of a bin then.
+    static constexpr double TARGET_BIN_SPACING = 400'000.0;
+
+    // The ratio between the sample rate of the bins and the bin spacing.
+    static constexpr int OVERSAMPLING = 8;
+
+    // The number of taps of the prototype filter per bin.
+    static constexpr int N_TAPS_PER_BIN = 8;
+
+    // The number of output samples per channel which are calculated per input block.
+    static constexpr int OUTPUT_BLOCK_SIZE = 4'096;
+
+    // The capacity of each channel queue in samples.
+    static constexpr int QUEUE_CAPACITY = 1 << 18;
+
+    struct Channel
+    {
+        // The bin index which is nearest to the center frequency of the channel.
+        int bin_index;
+
+        // The phase increment of the mixer per output sample in cycles.
+        double mixer_phase_step;
+        double mixer_phase;
+
+        Eigen::VectorXcf output_block;
+        std::shared_ptr<SampleQueue> queue;
+    };
+
+    static int get_number_of_bins(double input_sample_rate);
+    static Eigen::VectorXf create_prototype_filter(int n_bins, double input_sample_rate);
+
+    void calculate_output(int input_end_index, int output_index);
+
+    std::shared_ptr<SampleSource> m_input_sample_source;
+    double m_input_sample_rate;
+    int m_n_bins;
+    int m_decimation;
+    int m_filter_length;
+
+    // The prototype filter in reverse order so that it is multiplied with the history in time order.
+    Eigen::VectorXf m_reversed_prototype_filter;
+    FftCalculator m_fft_calculator;
+
+    // The last m_filter_length - 1 input samples followed by the current input block.
+    Eigen::VectorXcf m_input_buffer;
+    Eigen::VectorXcf m_weighted_input;
+    Eigen::VectorXcf m_folded_input;
+    Eigen::VectorXcf m_bins;
+
+    // The time index of the next output sample modulo the number of bins
+    // which determines the phase rotation of the bins.
+    int64_t m_output_time;
+
+    std::vector<Channel> m_channels;
+};
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "Checkpoint.h"
+
+#include <cstring>
+
+using namespace DabConstants;
+
+static constexpr char MAGIC[8] = { 'D', 'A', 'B', 'C', 'K', 'P', 'T', '\0' };
+
+// Is increased whenever the layout of the checkpoint changes.
+static constexpr uint32_t VERSION = 2;
+
+// The header consists of the magic number, the version, the transmission mode and the stage.
+struct CheckpointHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t transmission_mode_id;
+    uint32_t stage;
+    uint32_t reserved;
+};
+
+// Every record starts with the frame number, the number of data symbols, the size of its data and the sample clock offset.
+struct RecordHeader
+{
+    int32_t frame_number;
+    int32_t n_data_symbols;
+    uint64_t size;
+    double sample_clock_offset;
+};
+
+// The size of the data of a record is limited so that a damaged file doesn't allocate huge buffers.
+static constexpr uint64_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+std::optional<CheckpointStage> parse_checkpoint_stage(const std::string& value)
+{
+    if (value == "frames")
+    {
+        return CheckpointStage::FRAMES;
+    }
+    else if (value == "carriers")
+    {
+        return CheckpointStage::CARRIER_VALUES;
+    }
+    else if (value == "hard-bits")
+    {
+        return CheckpointStage::HARD_BITS;
+    }
+    else if (value == "codewords")
+    {
+        return CheckpointStage::CODEWORDS;
+    }
+
+    return std::nullopt;
+}
+
+const char* get_checkpoint_stage_name(CheckpointStage stage)
+{
+    switch (stage)
+    {
+    case CheckpointStage::FRAMES:
+        return "frames";
+    case CheckpointStage::CARRIER_VALUES:
+        return "carriers";
+    case CheckpointStage::HARD_BITS:
+        return "hard-bits";
+    default:
+        return "codewords";
+    }
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& file_path, TransmissionModeId transmission_mode_id, CheckpointStage stage) :
+    m_stage(stage),
+    m_ofstream(std::ofstream(file_path, std::ios_base::binary)),
+    m_number_of_records(0)
+{
+    auto header{ CheckpointHeader() };
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.transmission_mode_id = static_cast<uint32_t>(transmission_mode_id);
+    header.stage = static_cast<uint32_t>(stage);
+    header.reserved = 0;
+    m_ofstream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+bool CheckpointWriter::is_open() const
+{
+    return m_ofstream.is_open();
+}
+
+CheckpointStage CheckpointWriter::get_stage() const
+{
+    return m_stage;
+}
+
+void CheckpointWriter::write(int frame_number, int n_data_symbols, double sample_clock_offset, const void* data, size_t size)
+{
+    auto record_header{ RecordHeader{ frame_number, n_data_symbols, size, sample_clock_offset } };
+    m_ofstream.write(reinterpret_cast<const char*>(&record_header), sizeof(record_header));
+    m_ofstream.write(static_cast<const char*>(data), size);
+    m_number_of_records++;
+}
+
+int CheckpointWriter::get_number_of_records() const
+{
+    return m_number_of_records;
+}
+
+bool CheckpointWriter::close()
+{
+    m_ofstream.close();
+    return !m_ofstream.fail();
+}
+
+CheckpointReader::CheckpointReader(const std::string& file_path) :
+    m_ifstream(std::ifstream(file_path, std::ios_base::binary)),
+    m_is_valid(false),
+    m_transmission_mode_id(TransmissionModeId::I),
+    m_stage(CheckpointStage::FRAMES)
+{
+    auto header{ CheckpointHeader() };
+    m_ifstream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!m_ifstream || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.transmission_mode_id > static_cast<uint32_t>(TransmissionModeId::IV) ||
+        header.stage > static_cast<uint32_t>(CheckpointStage::CODEWORDS))
+    {
+        return;
+    }
+
+    m_is_valid = true;
+    m_transmission_mode_id = static_cast<TransmissionModeId>(header.transmission_mode_id);
+    m_stage = static_cast<CheckpointStage>(header.stage);
+}
+
+bool CheckpointReader::is_valid() const
+{
+    return m_is_valid;
+}
+
+TransmissionModeId CheckpointReader::get_transmission_mode_id() const
+{
+    return m_transmission_mode_id;
+}
+
+CheckpointStage CheckpointReader::get_stage() const
+{
+    return m_stage;
+}
+
+bool CheckpointReader::read(CheckpointRecord& record)
+{
+    auto record_header{ RecordHeader() };
+    m_ifstream.read(reinterpret_cast<char*>(&record_header), sizeof(record_header));
+    if (!m_is_valid || !m_ifstream || record_header.size > MAX_RECORD_SIZE)
+    {
+        return false;
+    }
+
+    record.frame_number = record_header.frame_number;
+    record.n_data_symbols = record_header.n_data_symbols;
+    record.sample_clock_offset = record_header.sample_clock_offset;
+    record.data.resize(record_header.size);
+    m_ifstream.read(reinterpret_cast<char*>(record.data.data()), record_header.size);
+    return static_cast<bool>(m_ifstream);
+}
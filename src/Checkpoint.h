@@ -0,0 +1,100 @@
+#pragma once
+
+#include "DabConstants.h"
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// The boundaries between the stages of the receiver at which a checkpoint can be recorded
+// and from which the later stages can be replayed, e.g. to benchmark the FIC handler in isolation.
+enum class CheckpointStage
+{
+    // The samples of every frame from its PRS symbol on after the time synchronization.
+    // Replaying them runs the OFDM demodulator and the FIC handler.
+    FRAMES,
+
+    // The carriers of the PRS symbol and the FIC symbols after the FFT.
+    // Replaying them runs the phase correction, the deinterleaving and the demapping and the FIC handler.
+    CARRIER_VALUES,
+
+    // The packed hard bits of the FIC symbols. Replaying them runs the FIC handler.
+    HARD_BITS,
+
+    // The depunctured codewords of the FIC blocks. Replaying them only runs the Viterbi algorithm.
+    CODEWORDS
+};
+
+// Parses the stage, i.e. frames, carriers, hard-bits or codewords.
+std::optional<CheckpointStage> parse_checkpoint_stage(const std::string& value);
+
+const char* get_checkpoint_stage_name(CheckpointStage stage);
+
+// The data of one frame at the stage boundary.
+struct CheckpointRecord
+{
+    int frame_number;
+
+    // The number of data symbols which were demodulated.
+    // The FIC of the frame is only decoded during the replay if the FIC symbols were demodulated.
+    int n_data_symbols;
+
+    // The sample clock offset which the OFDM demodulator compensated in the frame,
+    // so that the replay corrects the phases of the carriers like the recorded run.
+    double sample_clock_offset;
+
+    // The values of the stage as raw bytes in the layout of the receiver's buffers.
+    std::vector<uint8_t> data;
+};
+
+// A checkpoint is a binary file of a header followed by one record per frame.
+// All numbers and values are stored in the byte order of the host.
+// Only the frames at the stage FRAMES are all recorded, since the OFDM demodulator tracks the frequency offsets
+// from frame to frame. Otherwise, only the frames whose FIC is decoded are recorded.
+class CheckpointWriter final
+{
+public:
+    CheckpointWriter(const std::string& file_path, DabConstants::TransmissionModeId transmission_mode_id, CheckpointStage stage);
+
+    // Returns whether the file could be opened.
+    bool is_open() const;
+
+    CheckpointStage get_stage() const;
+
+    void write(int frame_number, int n_data_symbols, double sample_clock_offset, const void* data, size_t size);
+
+    int get_number_of_records() const;
+
+    // Returns whether all records could be written.
+    bool close();
+
+private:
+    CheckpointStage m_stage;
+    std::ofstream m_ofstream;
+    int m_number_of_records;
+};
+
+class CheckpointReader final
+{
+public:
+    CheckpointReader(const std::string& file_path);
+
+    // Returns whether the file is a checkpoint of the current version.
+    bool is_valid() const;
+
+    DabConstants::TransmissionModeId get_transmission_mode_id() const;
+
+    CheckpointStage get_stage() const;
+
+    // Reads the next record into the given one whose data buffer is reused.
+    // Returns false at the end of the file or if the record is truncated.
+    bool read(CheckpointRecord& record);
+
+private:
+    std::ifstream m_ifstream;
+    bool m_is_valid;
+    DabConstants::TransmissionModeId m_transmission_mode_id;
+    CheckpointStage m_stage;
+};
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "CoarseFrequencyEstimator.h"
+#include "DabConstants.h"
+#include "PrsCreation.h"
+
+using namespace DabConstants;
+
+// Calculates the products between neighbouring carriers.
+// A timing offset rotates the carrier values by a phase which is linear in the carrier index.
+// Hence, these products only contain a constant phase and the correlation is not affected by the timing offset.
+static void calculate_differential_values(const Eigen::VectorXcf& values_fd, Eigen::VectorXcf& differential_values)
+{
+    auto size = values_fd.size();
+    differential_values.head(size - 1) = values_fd.head(size - 1).conjugate().cwiseProduct(values_fd.tail(size - 1));
+    differential_values[size - 1] = std::conj(values_fd[size - 1]) * values_fd[0];
+}
+
+template <typename Mode>
+CoarseFrequencyEstimator<Mode>::CoarseFrequencyEstimator(const FftCalculator& fft_calculator, const Eigen::VectorXcf& differential_prs_symbol_fd) :
+    m_fft_calculator(fft_calculator),
+    m_differential_prs_symbol_fd(differential_prs_symbol_fd),
+    m_prepared_differential_prs_symbol_fd(Mode::T_U),
+    m_differential_values(Mode::T_U),
+    m_differential_values_fd(Mode::T_U),
+    m_product_fd(Mode::T_U),
+    m_correlation_result(Mode::T_U)
+{
+    m_fft_calculator.fft(m_differential_prs_symbol_fd.data(), m_prepared_differential_prs_symbol_fd.data());
+    m_prepared_differential_prs_symbol_fd = m_prepared_differential_prs_symbol_fd.conjugate();
+}
+
+template <typename Mode>
+CoarseFrequencyEstimator<Mode> CoarseFrequencyEstimator<Mode>::create()
+{
+    auto fft_calculator{ FftCalculator(Mode::T_U) };
+
+    auto prs_symbol_fd = PrsCreation::create_fd<Mode>();
+    auto differential_prs_symbol_fd{ Eigen::VectorXcf(Mode::T_U) };
+    calculate_differential_values(prs_symbol_fd, differential_prs_symbol_fd);
+
+    return CoarseFrequencyEstimator(fft_calculator, differential_prs_symbol_fd);
+}
+
+// Correlates the differential values of the received PRS symbol shifted by the given number of carriers
+// with the differential values of the reference PRS symbol.
+template <typename Mode>
+std::complex<float> CoarseFrequencyEstimator<Mode>::correlate(int shift)
+{
+    auto correlation = std::complex<float>(0.0f, 0.0f);
+    for (int i = 0; i < Mode::T_U; i++)
+    {
+        auto shifted_index = (i + shift + Mode::T_U) % Mode::T_U;
+        correlation += m_differential_values[shifted_index] * std::conj(m_differential_prs_symbol_fd[i]);
+    }
+
+    return correlation;
+}
+
+// Calculates the cross correlation for all shifts at once using the "fourier transformation trick".
+// So only one FFT and one IFFT are needed instead of one FFT per candidate shift.
+template <typename Mode>
+int CoarseFrequencyEstimator<Mode>::estimate(const Eigen::VectorXcf& prs_symbol_fd)
+{
+    calculate_differential_values(prs_symbol_fd, m_differential_values);
+
+    m_fft_calculator.fft(m_differential_values.data(), m_differential_values_fd.data());
+    m_product_fd = m_differential_values_fd.cwiseProduct(m_prepared_differential_prs_symbol_fd);
+    m_fft_calculator.ifft(m_product_fd.data(), m_correlation_result.data());
+
+    auto argmax = 0;
+    auto max = 0.0f;
+    for (int shift = -MAX_OFFSET; shift <= MAX_OFFSET; shift++)
+    {
+        auto current_max = std::norm(m_correlation_result[(shift + Mode::T_U) % Mode::T_U]);
+        if (current_max > max)
+        {
+            argmax = shift;
+            max = current_max;
+        }
+    }
+
+    return argmax;
+}
+
+template <typename Mode>
+int CoarseFrequencyEstimator<Mode>::track(const Eigen::VectorXcf& prs_symbol_fd)
+{
+    calculate_differential_values(prs_symbol_fd, m_differential_values);
+
+    auto argmax = 0;
+    auto max = std::norm(correlate(0));
+    for (int shift = -1; shift <= 1; shift += 2)
+    {
+        auto current_max = std::norm(correlate(shift));
+        if (current_max > max)
+        {
+            argmax = shift;
+            max = current_max;
+        }
+    }
+
+    return argmax;
+}
+
+template class CoarseFrequencyEstimator<TransmissionModeI>;
+template class CoarseFrequencyEstimator<TransmissionModeII>;
+template class CoarseFrequencyEstimator<TransmissionModeIII>;
+template class CoarseFrequencyEstimator<TransmissionModeIV>;
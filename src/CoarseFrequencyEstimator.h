@@ -0,0 +1,44 @@
+#pragma once
+
+#include "FftCalculator.h"
+
+#include "Eigen/Dense"
+
+template <typename Mode>
+class CoarseFrequencyEstimator final
+{
+public:
+    static CoarseFrequencyEstimator create();
+
+    // Determines the integer carrier offset of the received PRS symbol
+    // by searching all shifts within MAX_OFFSET carriers.
+    // This is meant to be done once per acquisition.
+    int estimate(const Eigen::VectorXcf& prs_symbol_fd);
+
+    // Determines the integer carrier offset of the received PRS symbol
+    // by only comparing the shifts -1, 0 and 1.
+    // This is meant to be done in the steady state after the acquisition.
+    int track(const Eigen::VectorXcf& prs_symbol_fd);
+
+    // The maximum integer carrier offset which is searched during the acquisition.
+    // It is limited by the number of unused carriers at each side of the spectrum.
+    static constexpr int MAX_OFFSET = (Mode::T_U - Mode::N_CARRIERS) / 2;
+
+private:
+    CoarseFrequencyEstimator(const FftCalculator& fft_calculator, const Eigen::VectorXcf& differential_prs_symbol_fd);
+
+    std::complex<float> correlate(int shift);
+
+    FftCalculator m_fft_calculator;
+
+    // The differential values of the reference PRS symbol.
+    Eigen::VectorXcf m_differential_prs_symbol_fd;
+
+    // The conjugated FFT of m_differential_prs_symbol_fd which is used for the correlation.
+    Eigen::VectorXcf m_prepared_differential_prs_symbol_fd;
+
+    Eigen::VectorXcf m_differential_values;
+    Eigen::VectorXcf m_differential_values_fd;
+    Eigen::VectorXcf m_product_fd;
+    Eigen::VectorXcf m_correlation_result;
+};
\ No newline at end of file
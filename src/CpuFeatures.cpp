@@ -0,0 +1,127 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace CpuFeatures
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    // The bits of the CPUID leaves 1 and 7 and of the XCR0 register, see the Intel 64 and IA-32 Architectures Software Developer's Manual.
+    IsaLevel detect()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        auto max_leaf = info[0];
+
+        __cpuid(info, 1);
+        auto has_sse4_2 = (info[2] & (1 << 20)) != 0;
+        auto has_os_xsave = (info[2] & (1 << 27)) != 0;
+        auto has_avx = (info[2] & (1 << 28)) != 0;
+        if (!has_sse4_2)
+        {
+            return IsaLevel::SCALAR;
+        }
+
+        // The operating system must save the AVX registers on context switches.
+        auto xcr0 = has_os_xsave ? _xgetbv(0) : 0;
+        if (!has_avx || (xcr0 & 0x6) != 0x6 || max_leaf < 7)
+        {
+            return IsaLevel::SSE4_2;
+        }
+
+        __cpuidex(info, 7, 0);
+        auto has_avx2 = (info[1] & (1 << 5)) != 0;
+        auto has_avx512f = (info[1] & (1 << 16)) != 0;
+        if (!has_avx2)
+        {
+            return IsaLevel::SSE4_2;
+        }
+
+        if (!has_avx512f || (xcr0 & 0xe6) != 0xe6)
+        {
+            return IsaLevel::AVX2;
+        }
+
+        return IsaLevel::AVX512;
+    }
+
+    // The bit 8 of EBX of the CPUID leaf 7.
+    bool has_bmi2()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 8)) != 0;
+    }
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    IsaLevel detect()
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return IsaLevel::AVX512;
+        }
+        else if (__builtin_cpu_supports("avx2"))
+        {
+            return IsaLevel::AVX2;
+        }
+        else if (__builtin_cpu_supports("sse4.2"))
+        {
+            return IsaLevel::SSE4_2;
+        }
+
+        return IsaLevel::SCALAR;
+    }
+
+    bool has_bmi2()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2");
+    }
+#else
+    IsaLevel detect()
+    {
+        return IsaLevel::SCALAR;
+    }
+
+    bool has_bmi2()
+    {
+        return false;
+    }
+#endif
+
+    const char* get_name(IsaLevel isa_level)
+    {
+        switch (isa_level)
+        {
+        case IsaLevel::SSE4_2:
+            return "sse4.2";
+        case IsaLevel::AVX2:
+            return "avx2";
+        case IsaLevel::AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+        }
+    }
+
+    std::optional<IsaLevel> parse(const std::string& value)
+    {
+        for (auto isa_level : { IsaLevel::SCALAR, IsaLevel::SSE4_2, IsaLevel::AVX2, IsaLevel::AVX512 })
+        {
+            if (value == get_name(isa_level))
+            {
+                return isa_level;
+            }
+        }
+
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+// Detects the instruction set extensions of the CPU at runtime
+// so that one binary can bind the best implementation of each hot kernel.
+namespace CpuFeatures
+{
+    // The instruction set levels which the kernels are implemented for.
+    // Each level comprises the levels below.
+    enum class IsaLevel
+    {
+        SCALAR,
+        SSE4_2,
+        AVX2,
+        AVX512
+    };
+
+    // The name of the environment variable which limits the instruction set level for debugging, e.g. DAB_FORCE_ISA=sse4.2.
+    constexpr const char* FORCE_ISA_VARIABLE = "DAB_FORCE_ISA";
+
+    // Returns the highest instruction set level which the CPU and the operating system support.
+    IsaLevel detect();
+
+    // Returns whether the CPU supports BMI2, e.g. PDEP, which is independent of the instruction set levels.
+    bool has_bmi2();
+
+    const char* get_name(IsaLevel isa_level);
+
+    // Parses the instruction set level, i.e. scalar, sse4.2, avx2 or avx512.
+    std::optional<IsaLevel> parse(const std::string& value);
+}
\ No newline at end of file
@@ -2,63 +2,15 @@
 
 namespace DabConstants
 {
-    // The number of useful carriers of an OFDM symbol.
-    constexpr int N_CARRIERS = 1'536;
+    // The sample rate of the complex baseband signal in samples per second.
+    constexpr int SAMPLE_RATE = 2'048'000;
 
-    // Minimum discrete frequency.
-    constexpr int K_MIN = -768;
-
-    // Maximum discrete frequency.
-    constexpr int K_MAX = 768;
-
-    // Number of OFDM symbols.
-    constexpr int N_OFDM_SYMBOLS = 76;
-
-    // Number of symbols carrying data.
-    // It is 1 smaller than N_OFDM_SYMBOLS because
-    // the PRS symbol doesn't carry data.
-    constexpr int N_DATA_SYMBOLS = N_OFDM_SYMBOLS - 1;
-
-    // Length of a DAB frame.
-    constexpr int T_F = 196'608;
-
-    // Minimum length comprising one DAB frame and one symbol
-    // which is equal to a power of 2.
-    // It is used for the FFT to determine
-    // the cross correlation between an ideal PRS symbol
-    // and the received signal.
-    constexpr int T_F_FFT = 262'144;
-
-    // Length of the Null symbol.
-    constexpr int T_NULL = 2'656;
-
-    // Length of a DAB frame without the Null symbol.
-    constexpr int T_F_U = T_F - T_NULL;
-
-    // Useful length of an OFDM symbol.
-    constexpr int T_U = 2'048;
-
-    // Length of the guard interval.
-    constexpr int T_G = 504;
-
-    // Length of one of the OFDM symbols 1-76.
-    constexpr int T_S = T_U + T_G;
-
-    // Number of OFDM symbols used for the fast information channel (FIC).
-    constexpr int N_FIC_SYMBOLS = 3;
+    // Half of the bandwidth of a DAB signal in Hz, i.e. the frequency of the outermost carriers in transmission mode I.
+    constexpr int DAB_HALF_BANDWIDTH = 768'000;
 
     // There are 2 binary digits, 0 and 1.
     constexpr int BINARY = 2;
 
-    // Number of raw bits per FIC symbol.
-    constexpr int N_RAW_FIC_SYMBOL_BITS = N_CARRIERS * BINARY;
-
-    // Number of common interleaved frames (CIFs).
-    constexpr int N_CIFS = 4;
-
-    // Number of raw bits in the FIC per CIF.
-    constexpr int N_RAW_FIC_BLOCK_BITS = (N_FIC_SYMBOLS * N_RAW_FIC_SYMBOL_BITS) / N_CIFS;
-
     // Number of taps of the convolutional encoder.
     constexpr int N_TAPS = 6;
 
@@ -69,9 +21,137 @@ namespace DabConstants
     // Number of bits which the convoluational encoder produces per step.
     constexpr int N_CONV_OUTPUT = 4;
 
-    // Number of data bits per fast information block (FIB).
-    constexpr int N_FIB_BITS = 768;
-
-    // Length of the convolutional codeword.
-    constexpr int L_CONV_CODEWORD = N_CONV_OUTPUT * (N_FIB_BITS + N_TAPS);
+    // Returns the smallest power of 2 which is greater than or equal to value.
+    constexpr int next_power_of_two(int value)
+    {
+        auto power_of_two = 1;
+        while (power_of_two < value)
+        {
+            power_of_two = power_of_two * 2;
+        }
+        return power_of_two;
+    }
+
+    // The DAB transmission modes as described in section 14.1 of ETSI EN 300 401 V1.4.1.
+    // Note: ETSI EN 300 401 V2.1.1 only describes the transmission mode I.
+    enum class TransmissionModeId
+    {
+        I,
+        II,
+        III,
+        IV
+    };
+
+    // Returns the roman numeral of the transmission mode.
+    constexpr const char* get_transmission_mode_name(TransmissionModeId id)
+    {
+        switch (id)
+        {
+        case TransmissionModeId::I:
+            return "I";
+        case TransmissionModeId::II:
+            return "II";
+        case TransmissionModeId::III:
+            return "III";
+        default:
+            return "IV";
+        }
+    }
+
+    // Describes all parameters which depend on the transmission mode.
+    // The hot kernels are templated on this descriptor so that their loops and buffers
+    // are sized at compile time for each transmission mode.
+    template <
+        TransmissionModeId id,
+        int n_carriers,
+        int n_ofdm_symbols,
+        int t_null,
+        int t_u,
+        int t_g,
+        int n_fic_symbols,
+        int n_cifs,
+        int n_fibs_per_cif,
+        int n_pi_16_blocks>
+    struct TransmissionMode
+    {
+        // The identifier of the transmission mode.
+        static constexpr TransmissionModeId ID = id;
+
+        // The number of useful carriers of an OFDM symbol.
+        static constexpr int N_CARRIERS = n_carriers;
+
+        // Minimum discrete frequency.
+        static constexpr int K_MIN = -N_CARRIERS / 2;
+
+        // Maximum discrete frequency.
+        static constexpr int K_MAX = N_CARRIERS / 2;
+
+        // Number of OFDM symbols.
+        static constexpr int N_OFDM_SYMBOLS = n_ofdm_symbols;
+
+        // Number of symbols carrying data.
+        // It is 1 smaller than N_OFDM_SYMBOLS because
+        // the PRS symbol doesn't carry data.
+        static constexpr int N_DATA_SYMBOLS = N_OFDM_SYMBOLS - 1;
+
+        // Length of the Null symbol.
+        static constexpr int T_NULL = t_null;
+
+        // Useful length of an OFDM symbol.
+        static constexpr int T_U = t_u;
+
+        // Length of the guard interval.
+        static constexpr int T_G = t_g;
+
+        // Length of one of the OFDM symbols 1-L.
+        static constexpr int T_S = T_U + T_G;
+
+        // Length of a DAB frame.
+        static constexpr int T_F = T_NULL + N_OFDM_SYMBOLS * T_S;
+
+        // Length of a DAB frame without the Null symbol.
+        static constexpr int T_F_U = T_F - T_NULL;
+
+        // Minimum length comprising one DAB frame and one symbol
+        // which is equal to a power of 2.
+        // It is used for the FFT to determine
+        // the cross correlation between an ideal PRS symbol
+        // and the received signal.
+        static constexpr int T_F_FFT = next_power_of_two(T_F + T_S);
+
+        // Number of OFDM symbols used for the fast information channel (FIC).
+        static constexpr int N_FIC_SYMBOLS = n_fic_symbols;
+
+        // Number of raw bits per FIC symbol.
+        static constexpr int N_RAW_FIC_SYMBOL_BITS = N_CARRIERS * BINARY;
+
+        // Number of common interleaved frames (CIFs) per DAB frame.
+        static constexpr int N_CIFS = n_cifs;
+
+        // Number of raw bits in the FIC per CIF.
+        static constexpr int N_RAW_FIC_BLOCK_BITS = (N_FIC_SYMBOLS * N_RAW_FIC_SYMBOL_BITS) / N_CIFS;
+
+        // Number of data bits of the fast information blocks (FIBs) in the FIC per CIF.
+        // Each FIB comprises 256 bits.
+        static constexpr int N_FIB_BITS = n_fibs_per_cif * 256;
+
+        // Length of the convolutional codeword.
+        static constexpr int L_CONV_CODEWORD = N_CONV_OUTPUT * (N_FIB_BITS + N_TAPS);
+
+        // Number of blocks of the convolutional codeword punctured according to the puncturing index PI = 16.
+        // See 11.2.1 of ETSI EN 300 401 V1.4.1.
+        static constexpr int N_PI_16_BLOCKS = n_pi_16_blocks;
+    };
+
+    // See table 38 of ETSI EN 300 401 V1.4.1 for the parameters of the transmission modes.
+    using TransmissionModeI = TransmissionMode<TransmissionModeId::I, 1'536, 76, 2'656, 2'048, 504, 3, 4, 3, 21>;
+    using TransmissionModeII = TransmissionMode<TransmissionModeId::II, 384, 76, 664, 512, 126, 3, 1, 3, 21>;
+    using TransmissionModeIII = TransmissionMode<TransmissionModeId::III, 192, 153, 345, 256, 63, 8, 1, 4, 29>;
+    using TransmissionModeIV = TransmissionMode<TransmissionModeId::IV, 768, 76, 1'328, 1'024, 252, 3, 2, 3, 21>;
+
+    static_assert(TransmissionModeI::T_F == 196'608);
+    static_assert(TransmissionModeI::T_F_FFT == 262'144);
+    static_assert(TransmissionModeII::T_F == 49'152);
+    static_assert(TransmissionModeIII::T_F == 49'152);
+    static_assert(TransmissionModeIV::T_F == 98'304);
 }
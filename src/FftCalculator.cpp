@@ -58,3 +58,8 @@ void FftCalculator::ifft(const std::complex<float> input[], std::complex<float>
         output[i] = output[i] / scaling;
     }
 }
+
+int FftCalculator::get_size() const
+{
+    return m_size;
+}
@@ -18,6 +18,8 @@ public:
     void fft(const std::complex<float> input[], std::complex<float> output[]) const;
     void ifft(const std::complex<float> input[], std::complex<float> output[]) const;
 
+    int get_size() const;
+
 private:
     int* m_reference_count;
     int m_size;
@@ -0,0 +1,108 @@
+#include "FicBlockCache.h"
+
+#include "fmt/printf.h"
+
+#include <algorithm>
+#include <cstring>
+
+FicBlockCache::FicBlockCache(int capacity, int n_raw_words, int n_fib_bits) :
+    m_capacity(capacity),
+    m_n_raw_words(n_raw_words),
+    m_n_fib_bits(n_fib_bits),
+    m_hashes(capacity),
+    m_raw_bits(static_cast<size_t>(capacity) * n_raw_words),
+    m_fib_bits(static_cast<size_t>(capacity) * n_fib_bits),
+    m_numbers_of_error_bits(capacity),
+    m_last_uses(capacity, 0),
+    m_number_of_lookups(0),
+    m_number_of_hits(0)
+{
+
+}
+
+// Every word is mixed by a multiplication with an odd constant and a shift,
+// which spreads a single flipped bit over the whole hash.
+uint64_t FicBlockCache::hash(const uint64_t raw_bits[]) const
+{
+    auto hash = uint64_t(0);
+    for (int i = 0; i < m_n_raw_words; i++)
+    {
+        hash = (hash ^ raw_bits[i]) * 0x9E3779B97F4A7C15;
+        hash = hash ^ (hash >> 32);
+    }
+    return hash;
+}
+
+bool FicBlockCache::lookup(const uint64_t raw_bits[], uint8_t fib_bits[], int& number_of_error_bits)
+{
+    if (m_capacity == 0)
+    {
+        return false;
+    }
+
+    m_number_of_lookups++;
+    auto raw_bits_hash = hash(raw_bits);
+    for (int i = 0; i < m_capacity; i++)
+    {
+        if (m_last_uses[i] == 0 || m_hashes[i] != raw_bits_hash)
+        {
+            continue;
+        }
+
+        auto entry_raw_bits = m_raw_bits.data() + static_cast<size_t>(i) * m_n_raw_words;
+        if (std::memcmp(entry_raw_bits, raw_bits, m_n_raw_words * sizeof(uint64_t)) != 0)
+        {
+            continue;
+        }
+
+        std::memcpy(fib_bits, m_fib_bits.data() + static_cast<size_t>(i) * m_n_fib_bits, m_n_fib_bits);
+        number_of_error_bits = m_numbers_of_error_bits[i];
+        m_last_uses[i] = m_number_of_lookups;
+        m_number_of_hits++;
+        return true;
+    }
+
+    return false;
+}
+
+void FicBlockCache::insert(const uint64_t raw_bits[], const uint8_t fib_bits[], int number_of_error_bits)
+{
+    if (m_capacity == 0)
+    {
+        return;
+    }
+
+    // Empty entries have the oldest use of all.
+    auto i = static_cast<int>(std::min_element(m_last_uses.begin(), m_last_uses.end()) - m_last_uses.begin());
+    m_hashes[i] = hash(raw_bits);
+    std::memcpy(m_raw_bits.data() + static_cast<size_t>(i) * m_n_raw_words, raw_bits, m_n_raw_words * sizeof(uint64_t));
+    std::memcpy(m_fib_bits.data() + static_cast<size_t>(i) * m_n_fib_bits, fib_bits, m_n_fib_bits);
+    m_numbers_of_error_bits[i] = number_of_error_bits;
+    m_last_uses[i] = m_number_of_lookups;
+}
+
+int FicBlockCache::get_capacity() const
+{
+    return m_capacity;
+}
+
+uint64_t FicBlockCache::get_number_of_lookups() const
+{
+    return m_number_of_lookups;
+}
+
+uint64_t FicBlockCache::get_number_of_hits() const
+{
+    return m_number_of_hits;
+}
+
+void FicBlockCache::print_statistics() const
+{
+    if (m_capacity == 0)
+    {
+        return;
+    }
+
+    auto hit_rate = m_number_of_lookups > 0 ? 100.0 * m_number_of_hits / m_number_of_lookups : 0.0;
+    fmt::println("{} of {} FIC blocks were found in the cache ({:.1f}%).", m_number_of_hits, m_number_of_lookups, hit_rate);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// A content-addressed cache of the recently decoded FIC blocks.
+// With a clean reception, most FIC blocks repeat bit by bit since the FIGs are transmitted cyclically,
+// so the packed raw bits of a FIC block identify the result of its Viterbi decoding.
+// An entry is found by a hash of the raw bits, but only returned if the raw bits themselves are equal,
+// so the result is always identical to a decoding.
+class FicBlockCache final
+{
+public:
+    // A capacity of 0 disables the cache, i.e. every lookup misses.
+    FicBlockCache(int capacity, int n_raw_words, int n_fib_bits);
+
+    // Copies the decoded bits and the number of error bits of the raw bits into the given buffers.
+    // Returns false if the raw bits aren't in the cache.
+    bool lookup(const uint64_t raw_bits[], uint8_t fib_bits[], int& number_of_error_bits);
+
+    // Stores the result of a decoding by replacing the least recently used entry.
+    void insert(const uint64_t raw_bits[], const uint8_t fib_bits[], int number_of_error_bits);
+
+    int get_capacity() const;
+    uint64_t get_number_of_lookups() const;
+    uint64_t get_number_of_hits() const;
+
+    void print_statistics() const;
+
+private:
+    uint64_t hash(const uint64_t raw_bits[]) const;
+
+    int m_capacity;
+    int m_n_raw_words;
+    int m_n_fib_bits;
+
+    // The entries are stored in flat arrays, so the hashes are scanned without touching the bits.
+    std::vector<uint64_t> m_hashes;
+    std::vector<uint64_t> m_raw_bits;
+    std::vector<uint8_t> m_fib_bits;
+    std::vector<int> m_numbers_of_error_bits;
+
+    // The lookup at which each entry was used last. It is 0 for an empty entry.
+    std::vector<uint64_t> m_last_uses;
+
+    uint64_t m_number_of_lookups;
+    uint64_t m_number_of_hits;
+};
\ No newline at end of file
@@ -1,38 +1,51 @@
 #include "FicHandler.h"
 #include "DabConstants.h"
+#include "Kernels.h"
+#include "Tracing.h"
 
 #include "fmt/printf.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace DabConstants;
 
-FicHandler::FicHandler(const Viterbi& viterbi, const Eigen::VectorX<uint8_t>& puncturing_mask) :
-    m_raw_hard_bits_per_fic_block(N_CIFS),
-    m_decoded_hard_bits_per_fic_block(N_CIFS),
+template <typename Mode>
+FicHandler<Mode>::FicHandler(TaskScheduler& task_scheduler, const Viterbi& viterbi, const Eigen::VectorX<uint64_t>& puncturing_mask, int fic_block_cache_capacity, bool is_viterbi_adaptive, SharedMemoryPublisher* publisher) :
+    m_task_scheduler(task_scheduler),
+    m_decoded_hard_bits_per_fic_block(Mode::N_CIFS),
+    m_number_of_error_bits_per_fic_block(Mode::N_CIFS),
+    m_fib_bits_per_fic_block(Mode::N_CIFS),
     m_puncturing_mask(puncturing_mask),
-    m_depunctured_hard_bits_buffer(L_CONV_CODEWORD),
-    m_viterbi(viterbi)
+    m_codewords(N_CODEWORD_WORDS, Mode::N_CIFS),
+    m_viterbis(task_scheduler.get_number_of_threads(), viterbi),
+    m_is_viterbi_adaptive(is_viterbi_adaptive),
+    m_fic_block_cache(fic_block_cache_capacity, N_RAW_FIC_BLOCK_WORDS, Mode::N_FIB_BITS),
+    m_is_cached_per_fic_block(Mode::N_CIFS, false),
+    m_decoded_fic_block_indices(Mode::N_CIFS),
+    m_publisher(publisher)
 {
-    for (int i = 0; i < N_CIFS; i++)
+    for (int i = 0; i < Mode::N_CIFS; i++)
     {
-        m_raw_hard_bits_per_fic_block[i] = Eigen::VectorX<uint8_t>(N_RAW_FIC_BLOCK_BITS);
-        m_decoded_hard_bits_per_fic_block[i] = Eigen::VectorX<uint8_t>(N_FIB_BITS);
+        m_decoded_hard_bits_per_fic_block[i] = Eigen::VectorX<uint8_t>(Mode::N_FIB_BITS);
+        m_fib_bits_per_fic_block[i] = m_decoded_hard_bits_per_fic_block[i].data();
     }
 }
 
-FicHandler FicHandler::create()
+template <typename Mode>
+FicHandler<Mode> FicHandler<Mode>::create(TaskScheduler& task_scheduler, int fic_block_cache_capacity, bool is_viterbi_adaptive, SharedMemoryPublisher* publisher)
 {
     auto convolutional_code_config = get_convolutional_code_config();
-    Eigen::VectorX<uint8_t> ones = Eigen::VectorX<uint8_t>::Ones(N_RAW_FIC_BLOCK_BITS);
-    Eigen::VectorX<uint8_t> puncturing_mask = Eigen::VectorX<uint8_t>::Zero(L_CONV_CODEWORD);
-    depuncture(ones, puncturing_mask);
-    auto viterbi{ Viterbi(convolutional_code_config, L_CONV_CODEWORD) };
+    Eigen::VectorX<uint64_t> ones = Eigen::VectorX<uint64_t>::Constant(N_RAW_FIC_BLOCK_WORDS, ~uint64_t(0));
+    Eigen::VectorX<uint64_t> puncturing_mask = Eigen::VectorX<uint64_t>::Zero(N_CODEWORD_WORDS);
+    depuncture(ones.data(), puncturing_mask);
+    auto viterbi{ Viterbi(convolutional_code_config, Mode::L_CONV_CODEWORD, is_viterbi_adaptive) };
 
-    return FicHandler(viterbi, puncturing_mask);
+    return FicHandler(task_scheduler, viterbi, puncturing_mask, fic_block_cache_capacity, is_viterbi_adaptive, publisher);
 }
 
-std::shared_ptr<ConvolutionalCodeConfig> FicHandler::get_convolutional_code_config()
+template <typename Mode>
+std::shared_ptr<ConvolutionalCodeConfig> FicHandler<Mode>::get_convolutional_code_config()
 {
     auto bits_per_state{ Eigen::MatrixX<uint8_t>(N_STATES, N_TAPS) };
     auto previous_states_by_state{ std::map<uint8_t, std::vector<uint8_t>>() };
@@ -84,36 +97,61 @@ std::shared_ptr<ConvolutionalCodeConfig> FicHandler::get_convolutional_code_conf
     return convoluational_code_config;
 }
 
-static const int PI_16_TABLE[32] = { 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0 };
-static const int PI_15_TABLE[32] = { 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 0, 0 };
-static const int PI_X_TABLE[24] = { 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0 };
+static constexpr int PI_16_TABLE[32] = { 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0 };
+static constexpr int PI_15_TABLE[32] = { 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 0, 0 };
+static constexpr int PI_X_TABLE[24] = { 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0 };
+
+// Packs a puncturing vector into a mask where the first entry is the least significant bit.
+template <size_t N>
+static constexpr uint64_t create_puncturing_mask(const int (&table)[N])
+{
+    auto mask = uint64_t(0);
+    for (size_t i = 0; i < N; i++)
+    {
+        mask = mask | (static_cast<uint64_t>(table[i]) << i);
+    }
+    return mask;
+}
+
+static constexpr uint64_t PI_16_MASK = create_puncturing_mask(PI_16_TABLE);
+static constexpr uint64_t PI_15_MASK = create_puncturing_mask(PI_15_TABLE);
+static constexpr uint64_t PI_X_MASK = create_puncturing_mask(PI_X_TABLE);
+
+// Deposits the next raw bits at the positions given by a puncturing vector of up to 32 entries.
+// Since the puncturing vectors are always applied at multiples of 32 bits,
+// the deposited bits never cross a word boundary.
+// The bits are deposited by PDEP if the CPU supports it, see Kernels.h.
+static void deposit_punctured_bits(const Kernels::KernelTable& kernels, const uint64_t raw_bits[], int& raw_bits_index, uint64_t mask, uint64_t depunctured_bits[], int& filled_bits_index, int length)
+{
+    auto number_of_raw_bits = PackedBits::popcount(mask);
+    auto bits = kernels.deposit_bits(PackedBits::read_bits(raw_bits, raw_bits_index, number_of_raw_bits), mask);
+    depunctured_bits[filled_bits_index / PackedBits::WORD_BITS] |= bits << (filled_bits_index % PackedBits::WORD_BITS);
+
+    raw_bits_index = raw_bits_index + number_of_raw_bits;
+    filled_bits_index = filled_bits_index + length;
+}
 
 // See 11.1.2 and 11.2.1 of ETSI EN 300 401 V2.1.1.
-void FicHandler::depuncture(const Eigen::VectorX<uint8_t>& raw_bits, Eigen::VectorX<uint8_t>& depunctured_bits)
+// The number of blocks punctured according to PI = 16 depends on the transmission mode,
+// see 11.2.1 of ETSI EN 300 401 V1.4.1.
+template <typename Mode>
+void FicHandler<Mode>::depuncture(const uint64_t raw_bits[], Eigen::Ref<Eigen::VectorX<uint64_t>> depunctured_bits)
 {
+    auto span{ Tracing::ScopedSpan("FicHandler::depuncture") };
+
+    const auto& kernels = Kernels::get();
     auto raw_bits_index = 0;
     auto filled_bits_index = 0;
 
     // First we must reset the depunctured_bits to zeros.
-    for (int i = 0; i < depunctured_bits.size(); i++)
-    {
-        depunctured_bits[i] = 0;
-    }
+    depunctured_bits.setZero();
 
-    // The first 21 blocks are punctured as defined in clause 11.1.2, according to the puncturing index PI = 16.
-    for (int block = 0; block < 21; block++)
+    // The first 21 (or 29 in transmission mode III) blocks are punctured as defined in clause 11.1.2, according to the puncturing index PI = 16.
+    for (int block = 0; block < Mode::N_PI_16_BLOCKS; block++)
     {
         for (int subblock = 0; subblock < 4; subblock++)
         {
-            for (int bit_index = 0; bit_index < 32; bit_index++)
-            {
-                if (PI_16_TABLE[bit_index] == 1)
-                {
-                    depunctured_bits[filled_bits_index] = raw_bits[raw_bits_index];
-                    raw_bits_index++;
-                }
-                filled_bits_index++;
-            }
+            deposit_punctured_bits(kernels, raw_bits, raw_bits_index, PI_16_MASK, depunctured_bits.data(), filled_bits_index, 32);
         }
     }
 
@@ -122,50 +160,173 @@ void FicHandler::depuncture(const Eigen::VectorX<uint8_t>& raw_bits, Eigen::Vect
     {
         for (int subblock = 0; subblock < 4; subblock++)
         {
-            for (int bit_index = 0; bit_index < 32; bit_index++)
-            {
-                if (PI_15_TABLE[bit_index] == 1)
-                {
-                    depunctured_bits[filled_bits_index] = raw_bits[raw_bits_index];
-                    raw_bits_index++;
-                }
-                filled_bits_index++;
-            }
+            deposit_punctured_bits(kernels, raw_bits, raw_bits_index, PI_15_MASK, depunctured_bits.data(), filled_bits_index, 32);
         }
     }
 
     // Finally, the last 24 bits of the serial mother codeword are punctured as defined in clause 11.1.2.
-    for (int bit_index = 0; bit_index < 24; bit_index++)
+    deposit_punctured_bits(kernels, raw_bits, raw_bits_index, PI_X_MASK, depunctured_bits.data(), filled_bits_index, 24);
+}
+
+// TODO: Not complete. After running Viterbi, the data bits must be processed.
+// The rows of the FIC symbols are stored one after another and
+// the number of raw bits of a FIC block is a multiple of 64 in every transmission mode,
+// so each FIC block is a contiguous range of words which is depunctured directly.
+// The cache is only accessed by the calling thread before and after the parallel decoding.
+template <typename Mode>
+void FicHandler<Mode>::update_fib_blocks(const Eigen::Ref<const PackedBits::Matrix>& hard_bits, int frame_number, const FicBlockCallback& fic_block_callback)
+{
+    decode_fib_blocks(hard_bits);
+    pass_fic_blocks(frame_number, fic_block_callback);
+}
+
+template <typename Mode>
+void FicHandler<Mode>::decode_fib_blocks(const Eigen::Ref<const PackedBits::Matrix>& hard_bits)
+{
+    static_assert(Mode::N_RAW_FIC_BLOCK_BITS % PackedBits::WORD_BITS == 0);
+    assert(hard_bits.outerStride() == hard_bits.cols());
+
+    auto n_decoded_fic_blocks = 0;
+    for (int i = 0; i < Mode::N_CIFS; i++)
     {
-        if (PI_X_TABLE[bit_index] == 1)
+        auto raw_bits = hard_bits.data() + i * N_RAW_FIC_BLOCK_WORDS;
+        m_is_cached_per_fic_block[i] = m_fic_block_cache.lookup(raw_bits, m_decoded_hard_bits_per_fic_block[i].data(), m_number_of_error_bits_per_fic_block[i]);
+        if (!m_is_cached_per_fic_block[i])
         {
-            depunctured_bits[filled_bits_index] = raw_bits[raw_bits_index];
-            raw_bits_index++;
+            m_decoded_fic_block_indices[n_decoded_fic_blocks] = i;
+            n_decoded_fic_blocks++;
         }
-        filled_bits_index++;
+    }
+
+    m_task_scheduler.parallel_for(n_decoded_fic_blocks, [&](int task_index, int thread_index)
+    {
+        auto i = m_decoded_fic_block_indices[task_index];
+        depuncture(hard_bits.data() + i * N_RAW_FIC_BLOCK_WORDS, m_codewords.col(i));
+        decode_codeword(i, thread_index);
+    });
+
+    for (int task_index = 0; task_index < n_decoded_fic_blocks; task_index++)
+    {
+        auto i = m_decoded_fic_block_indices[task_index];
+        m_fic_block_cache.insert(hard_bits.data() + i * N_RAW_FIC_BLOCK_WORDS, m_decoded_hard_bits_per_fic_block[i].data(), m_number_of_error_bits_per_fic_block[i]);
     }
 }
 
-// TODO: Not complete. After running Viterbi, the data bits must be processed.
-void FicHandler::update_fib_blocks(Eigen::MatrixX<uint8_t>& hard_bits)
+template <typename Mode>
+void FicHandler<Mode>::update_fib_blocks_from_codewords(const uint64_t codewords[], int frame_number, const FicBlockCallback& fic_block_callback)
 {
-    update_raw_hard_bits_per_fic_block(hard_bits);
-    for (int i = 0; i < N_CIFS; i++)
+    m_codewords = Eigen::Map<const Eigen::Matrix<uint64_t, Eigen::Dynamic, Eigen::Dynamic>>(codewords, N_CODEWORD_WORDS, Mode::N_CIFS);
+    std::fill(m_is_cached_per_fic_block.begin(), m_is_cached_per_fic_block.end(), false);
+    m_task_scheduler.parallel_for(Mode::N_CIFS, [&](int i, int thread_index)
     {
-        depuncture(m_raw_hard_bits_per_fic_block[i], m_depunctured_hard_bits_buffer);
-        int number_of_error_bits = m_viterbi.run(m_depunctured_hard_bits_buffer, m_puncturing_mask, m_decoded_hard_bits_per_fic_block[i]);
-        fmt::println("The number of error bits is {} for the FIC block {}.", number_of_error_bits, i);
+        decode_codeword(i, thread_index);
+    });
+
+    pass_fic_blocks(frame_number, fic_block_callback);
+}
+
+template <typename Mode>
+const uint64_t* FicHandler<Mode>::get_codewords() const
+{
+    return m_codewords.data();
+}
+
+template <typename Mode>
+const uint8_t* const* FicHandler<Mode>::get_fib_bits_per_fic_block() const
+{
+    return m_fib_bits_per_fic_block.data();
+}
+
+template <typename Mode>
+const FicBlockCache& FicHandler<Mode>::get_fic_block_cache() const
+{
+    return m_fic_block_cache;
+}
+
+template <typename Mode>
+int64_t FicHandler<Mode>::get_number_of_viterbi_runs() const
+{
+    auto number_of_runs = int64_t(0);
+    for (const auto& viterbi : m_viterbis)
+    {
+        number_of_runs = number_of_runs + viterbi.get_number_of_runs();
+    }
+    return number_of_runs;
+}
+
+template <typename Mode>
+int64_t FicHandler<Mode>::get_number_of_viterbi_escalations() const
+{
+    auto number_of_escalations = int64_t(0);
+    for (const auto& viterbi : m_viterbis)
+    {
+        number_of_escalations = number_of_escalations + viterbi.get_number_of_escalations();
     }
+    return number_of_escalations;
 }
 
-void FicHandler::update_raw_hard_bits_per_fic_block(Eigen::MatrixX<uint8_t>& hard_bits)
+template <typename Mode>
+void FicHandler<Mode>::print_statistics() const
 {
-    auto reshaped_hard_bits = hard_bits.topRows(N_FIC_SYMBOLS).reshaped<Eigen::StorageOptions::RowMajor>(N_CIFS, N_RAW_FIC_BLOCK_BITS);
-    for (int row = 0; row < N_CIFS; row++)
+    m_fic_block_cache.print_statistics();
+    if (m_is_viterbi_adaptive)
     {
-        for (int col = 0; col < N_RAW_FIC_BLOCK_BITS; col++)
+        auto number_of_runs = get_number_of_viterbi_runs();
+        auto number_of_escalations = get_number_of_viterbi_escalations();
+        auto escalation_rate = number_of_runs > 0 ? 100.0 * number_of_escalations / number_of_runs : 0.0;
+        fmt::println("{} of {} FIC blocks were escalated to the full trellis ({:.1f}%).", number_of_escalations, number_of_runs, escalation_rate);
+    }
+}
+
+template <typename Mode>
+void FicHandler<Mode>::decode_codeword(int fic_block_index, int thread_index)
+{
+    m_number_of_error_bits_per_fic_block[fic_block_index] =
+        m_viterbis[thread_index].run(m_codewords.col(fic_block_index), m_puncturing_mask, m_decoded_hard_bits_per_fic_block[fic_block_index]);
+    m_fib_bits_per_fic_block[fic_block_index] = m_decoded_hard_bits_per_fic_block[fic_block_index].data();
+}
+
+template <typename Mode>
+void FicHandler<Mode>::pass_fic_blocks(int frame_number, const FicBlockCallback& fic_block_callback)
+{
+    for (int i = 0; i < Mode::N_CIFS; i++)
+    {
+        auto fic_block{ FicBlock{ frame_number, i, m_decoded_hard_bits_per_fic_block[i].data(), Mode::N_FIB_BITS, m_number_of_error_bits_per_fic_block[i], m_is_cached_per_fic_block[i] } };
+        if (m_publisher != nullptr)
         {
-            m_raw_hard_bits_per_fic_block[row][col] = reshaped_hard_bits(row, col);
+            publish_fic_block(fic_block);
         }
+        fic_block_callback(fic_block);
     }
 }
+
+// The first decoded bit of each byte becomes its most significant bit, so the bytes are the ones of the FIBs.
+template <typename Mode>
+void FicHandler<Mode>::publish_fic_block(const FicBlock& fic_block)
+{
+    static_assert(Mode::N_FIB_BITS / 8 <= sizeof(SharedMemoryEntry::data));
+
+    auto& entry = m_publisher->begin_entry();
+    entry.type = SharedMemoryEntryType::FIC_BLOCK;
+    entry.frame_number = fic_block.frame_number;
+    entry.index = fic_block.fic_block_index;
+    entry.number_of_errors = fic_block.number_of_error_bits;
+    entry.flags = fic_block.is_cached ? SharedMemoryEntry::IS_CACHED : 0;
+    entry.size = Mode::N_FIB_BITS / 8;
+    entry.frame_time = fic_block.frame_number * FRAME_DURATION;
+    for (int i = 0; i < Mode::N_FIB_BITS / 8; i++)
+    {
+        auto value = uint8_t(0);
+        for (int j = 0; j < 8; j++)
+        {
+            value = static_cast<uint8_t>((value << 1) | fic_block.fib_bits[8 * i + j]);
+        }
+        entry.data[i] = value;
+    }
+    m_publisher->publish();
+}
+
+template class FicHandler<TransmissionModeI>;
+template class FicHandler<TransmissionModeII>;
+template class FicHandler<TransmissionModeIII>;
+template class FicHandler<TransmissionModeIV>;
@@ -1,27 +1,124 @@
 #pragma once
 
 #include "Viterbi.h";
+#include "DabConstants.h"
+#include "FicBlockCache.h"
+#include "PackedBits.h"
+#include "SharedMemoryRing.h"
+#include "TaskScheduler.h"
 
 #include "Eigen/Dense"
 
+#include <functional>
+
+// A FIC block of one CIF after the Viterbi decoding.
+// The bits reference a buffer of the FIC handler, so they are only valid during the callback.
+struct FicBlock
+{
+    // The number of the DAB frame in the stream or in the frame index.
+    int frame_number;
+
+    // The index of the CIF within the DAB frame.
+    int fic_block_index;
+
+    // The decoded bits of the FIBs, one bit per byte.
+    const uint8_t* fib_bits;
+    int number_of_fib_bits;
+
+    // The number of error bits found in the last time step of the Viterbi algorithm.
+    int number_of_error_bits;
+
+    // Whether the FIC block was taken from the cache of recently decoded FIC blocks instead of being decoded.
+    bool is_cached;
+};
+
+// Is called for every decoded FIC block.
+using FicBlockCallback = std::function<void(const FicBlock&)>;
+
+template <typename Mode>
 class FicHandler final
 {
 public:
-    static FicHandler create();
+    // The FIC blocks of a frame are decoded in parallel by the task scheduler.
+    // Up to the given number of recently decoded FIC blocks are cached, see FicBlockCache.
+    // If the Viterbi decoding is adaptive, the full trellis is only used for FIC blocks with too many error bits.
+    // If a publisher is given, every FIC block is also published to its shared memory before the callback is called.
+    static FicHandler create(TaskScheduler& task_scheduler, int fic_block_cache_capacity = 0, bool is_viterbi_adaptive = false, SharedMemoryPublisher* publisher = nullptr);
+
+    // Each row of the hard bits contains the packed bits of one data symbol.
+    // Only the FIC blocks whose raw bits aren't found in the cache are decoded.
+    // The callback is called for each FIC block of the frame in order once all of them are decoded.
+    void update_fib_blocks(const Eigen::Ref<const PackedBits::Matrix>& hard_bits, int frame_number, const FicBlockCallback& fic_block_callback);
+
+    // Decodes the FIC blocks like update_fib_blocks without calling the callback, e.g. to compare them with a former frame first.
+    void decode_fib_blocks(const Eigen::Ref<const PackedBits::Matrix>& hard_bits);
+
+    // Calls the callback for each decoded FIC block in order.
+    void pass_fic_blocks(int frame_number, const FicBlockCallback& fic_block_callback);
+
+    // Returns the decoded bits of each FIC block of the last frame, one bit per byte.
+    const uint8_t* const* get_fib_bits_per_fic_block() const;
+
+    // Decodes the FIC blocks of a frame from their depunctured codewords, e.g. of a checkpoint, instead of from the hard bits.
+    // The codewords are given one after another like by get_codewords.
+    void update_fib_blocks_from_codewords(const uint64_t codewords[], int frame_number, const FicBlockCallback& fic_block_callback);
 
-    void update_fib_blocks(Eigen::MatrixX<uint8_t>& hard_bits);
+    // Returns the depunctured codewords of the FIC blocks of the last frame,
+    // N_CODEWORD_WORDS packed words per FIC block.
+    // The codewords of the FIC blocks which were found in the cache aren't updated.
+    const uint64_t* get_codewords() const;
+
+    const FicBlockCache& get_fic_block_cache() const;
+
+    // Returns the number of Viterbi decodings and how many of them were escalated to the full trellis in the adaptive mode.
+    int64_t get_number_of_viterbi_runs() const;
+    int64_t get_number_of_viterbi_escalations() const;
+
+    // Prints the hit rate of the cache and the escalation rate of the adaptive Viterbi decoding if they are used.
+    void print_statistics() const;
+
+    static constexpr int N_CODEWORD_WORDS = PackedBits::get_number_of_words(Mode::L_CONV_CODEWORD);
 
 private:
-    FicHandler(const Viterbi& viterbi, const Eigen::VectorX<uint8_t>& puncturing_mask);
+    FicHandler(TaskScheduler& task_scheduler, const Viterbi& viterbi, const Eigen::VectorX<uint64_t>& puncturing_mask, int fic_block_cache_capacity, bool is_viterbi_adaptive, SharedMemoryPublisher* publisher);
+
+    // The duration of a DAB frame in nanoseconds which is a whole number in all transmission modes.
+    static constexpr int64_t FRAME_DURATION = int64_t(Mode::T_F) * 1'000'000'000 / DabConstants::SAMPLE_RATE;
+
+    // The number of words of the packed raw bits of a FIC block.
+    static constexpr int N_RAW_FIC_BLOCK_WORDS = PackedBits::get_number_of_words(Mode::N_RAW_FIC_BLOCK_BITS);
 
     static std::shared_ptr<ConvolutionalCodeConfig> get_convolutional_code_config();
-    static void depuncture(const Eigen::VectorX<uint8_t>& raw_bits, Eigen::VectorX<uint8_t>& depunctured_bits);
+    static void depuncture(const uint64_t raw_bits[], Eigen::Ref<Eigen::VectorX<uint64_t>> depunctured_bits);
+
+    // Runs the Viterbi algorithm for the codeword of one FIC block by the Viterbi decoder of the thread.
+    void decode_codeword(int fic_block_index, int thread_index);
 
-    void update_raw_hard_bits_per_fic_block(Eigen::MatrixX<uint8_t>& hard_bits);
+    // Writes the FIBs of the FIC block packed into bytes directly into the next entry of the shared memory.
+    void publish_fic_block(const FicBlock& fic_block);
 
-    std::vector<Eigen::VectorX<uint8_t>> m_raw_hard_bits_per_fic_block;
+    TaskScheduler& m_task_scheduler;
     std::vector<Eigen::VectorX<uint8_t>> m_decoded_hard_bits_per_fic_block;
-    Eigen::VectorX<uint8_t> m_puncturing_mask;
-    Eigen::VectorX<uint8_t> m_depunctured_hard_bits_buffer;
-    Viterbi m_viterbi;
+    std::vector<int> m_number_of_error_bits_per_fic_block;
+
+    // Points to the data of the decoded bits of each FIC block.
+    // The Viterbi decoder resizes the decoded bits by the tail bits, so the pointers are updated after each decoding.
+    std::vector<const uint8_t*> m_fib_bits_per_fic_block;
+    Eigen::VectorX<uint64_t> m_puncturing_mask;
+
+    // The depunctured bits of each FIC block are kept so that they can be recorded.
+    // Each column is the codeword of one FIC block.
+    Eigen::Matrix<uint64_t, Eigen::Dynamic, Eigen::Dynamic> m_codewords;
+
+    // The Viterbi decoders are per thread of the task scheduler.
+    std::vector<Viterbi> m_viterbis;
+    bool m_is_viterbi_adaptive;
+
+    FicBlockCache m_fic_block_cache;
+    std::vector<bool> m_is_cached_per_fic_block;
+
+    // The indices of the FIC blocks of the current frame which weren't found in the cache.
+    std::vector<int> m_decoded_fic_block_indices;
+
+    SharedMemoryPublisher* m_publisher;
 };
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "FicSampler.h"
+
+#include "fmt/printf.h"
+
+#include <algorithm>
+#include <cstring>
+
+// The number of bytes of a FIB which carry FIGs, i.e. without the CRC.
+static constexpr int N_FIG_BYTES = 30;
+
+// The header of the end marker which fills the rest of the FIG bytes, see section 5.2.2 of ETSI EN 300 401 V2.1.1.
+static constexpr uint8_t END_MARKER = 0xFF;
+
+// See section 10 of ETSI EN 300 401 V2.1.1.
+// The PRBS is generated by the polynomial x^9 + x^5 + 1 whose register is initialised to all ones
+// at the start of the FIBs of each CIF, i.e. of each FIC block.
+static std::vector<uint8_t> create_energy_dispersal_bits(int n_bits)
+{
+    auto bits{ std::vector<uint8_t>(n_bits) };
+    auto shift_register = 0x1FF;
+    for (int i = 0; i < n_bits; i++)
+    {
+        auto bit = ((shift_register >> 8) ^ (shift_register >> 4)) & 1;
+        shift_register = ((shift_register << 1) | bit) & 0x1FF;
+        bits[i] = static_cast<uint8_t>(bit);
+    }
+    return bits;
+}
+
+FicSampler::FicSampler(std::optional<int> interval, bool detect_changes, int n_raw_fic_words, int n_fic_blocks, int n_fib_bits) :
+    m_interval(interval),
+    m_detect_changes(detect_changes),
+    m_n_fic_blocks(n_fic_blocks),
+    m_n_fib_bits(n_fib_bits),
+    m_energy_dispersal_bits(create_energy_dispersal_bits(n_fib_bits)),
+    m_ignored_bits(n_fib_bits),
+    m_last_decoded_frame_number(std::nullopt),
+    m_reference_raw_fic_bits(n_raw_fic_words),
+    m_reference_fib_bits(static_cast<size_t>(n_fic_blocks) * n_fib_bits),
+    m_number_of_frames(0),
+    m_number_of_decoded_frames(0),
+    m_number_of_detected_changes(0)
+{
+
+}
+
+FicSampler::Decision FicSampler::decide(int frame_number)
+{
+    m_number_of_frames++;
+    if (!m_interval.has_value() || !m_last_decoded_frame_number.has_value() ||
+        frame_number - m_last_decoded_frame_number.value() >= m_interval.value())
+    {
+        return Decision::DECODE;
+    }
+
+    return m_detect_changes ? Decision::DETECT_CHANGE : Decision::SKIP;
+}
+
+bool FicSampler::have_raw_fic_bits_changed(const uint64_t raw_fic_bits[]) const
+{
+    return !std::equal(m_reference_raw_fic_bits.begin(), m_reference_raw_fic_bits.end(), raw_fic_bits);
+}
+
+bool FicSampler::have_fibs_changed(const uint8_t* const fib_bits_per_fic_block[])
+{
+    for (int i = 0; i < m_n_fic_blocks; i++)
+    {
+        auto fib_bits = fib_bits_per_fic_block[i];
+        auto reference_fib_bits = m_reference_fib_bits.data() + static_cast<size_t>(i) * m_n_fib_bits;
+        update_ignored_bits(fib_bits);
+        for (int j = 0; j < m_n_fib_bits; j++)
+        {
+            if (fib_bits[j] != reference_fib_bits[j] && m_ignored_bits[j] == 0)
+            {
+                m_number_of_detected_changes++;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// The FIGs are found by their headers after the energy dispersal is removed.
+// The FIG 0/0 consists of the header, the type 0 field, the EId (2 bytes) and
+// the change flags, the alarm flag and the CIF count (2 bytes), see section 6.4 of ETSI EN 300 401 V2.1.1.
+// Bit errors may break the FIG structure, but then the bits differ outside of the ignored bits anyway.
+void FicSampler::update_ignored_bits(const uint8_t fib_bits[])
+{
+    std::fill(m_ignored_bits.begin(), m_ignored_bits.end(), uint8_t(0));
+
+    auto get_byte = [&](int bit_index)
+    {
+        auto byte = 0;
+        for (int k = 0; k < 8; k++)
+        {
+            byte = (byte << 1) | (fib_bits[bit_index + k] ^ m_energy_dispersal_bits[bit_index + k]);
+        }
+        return byte;
+    };
+
+    for (int fib_start = 0; fib_start + N_BITS_PER_FIB <= m_n_fib_bits; fib_start = fib_start + N_BITS_PER_FIB)
+    {
+        auto crc_start = fib_start + N_BITS_PER_FIB - N_CRC_BITS;
+        std::fill(m_ignored_bits.begin() + crc_start, m_ignored_bits.begin() + crc_start + N_CRC_BITS, uint8_t(1));
+
+        auto position = 0;
+        while (position < N_FIG_BYTES)
+        {
+            auto header = get_byte(fib_start + 8 * position);
+            auto length = header & 0x1F;
+            if (header == END_MARKER || position + 1 + length > N_FIG_BYTES)
+            {
+                break;
+            }
+
+            auto type = header >> 5;
+            auto is_fig_0_0 = type == 0 && length >= 5 && (get_byte(fib_start + 8 * (position + 1)) & 0x1F) == 0;
+            if (is_fig_0_0)
+            {
+                // The 13 bits of the CIF count are the lowest 5 bits of the fourth byte after the header and the fifth byte.
+                auto cif_count_start = fib_start + 8 * (position + 4) + 3;
+                std::fill(m_ignored_bits.begin() + cif_count_start, m_ignored_bits.begin() + cif_count_start + 13, uint8_t(1));
+            }
+
+            position = position + 1 + length;
+        }
+    }
+}
+
+void FicSampler::set_decoded(int frame_number, const uint64_t raw_fic_bits[], const uint8_t* const fib_bits_per_fic_block[])
+{
+    m_last_decoded_frame_number = frame_number;
+    std::copy(raw_fic_bits, raw_fic_bits + m_reference_raw_fic_bits.size(), m_reference_raw_fic_bits.begin());
+    for (int i = 0; i < m_n_fic_blocks; i++)
+    {
+        std::memcpy(m_reference_fib_bits.data() + static_cast<size_t>(i) * m_n_fib_bits, fib_bits_per_fic_block[i], m_n_fib_bits);
+    }
+    m_number_of_decoded_frames++;
+}
+
+void FicSampler::print_statistics() const
+{
+    if (!m_interval.has_value())
+    {
+        return;
+    }
+
+    fmt::println("The FIC was decoded in {} of {} frames ({} by a detected change).", m_number_of_decoded_frames, m_number_of_frames, m_number_of_detected_changes);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Decides for which frames the FIC is fully decoded in the sampling mode.
+// Since the ensemble organisation changes rarely, it is enough to decode the FIC every N frames
+// and, optionally, whenever the decoded FIBs differ from the ones of the last decoded frame.
+class FicSampler final
+{
+public:
+    enum class Decision
+    {
+        // Neither the FIC symbols are demodulated nor the FIC is decoded.
+        SKIP,
+
+        // The FIC symbols are demodulated to compare the FIC with the last decoded frame.
+        DETECT_CHANGE,
+
+        // The FIC is decoded.
+        DECODE
+    };
+
+    // Without an interval, the FIC of every frame is decoded.
+    // A frame has n_fic_blocks FIC blocks of n_fib_bits decoded bits each.
+    FicSampler(std::optional<int> interval, bool detect_changes, int n_raw_fic_words, int n_fic_blocks, int n_fib_bits);
+
+    // Is called once for every frame.
+    Decision decide(int frame_number);
+
+    // Returns whether the raw FIC bits differ from the ones of the last decoded frame in any bit.
+    // Equal raw bits are decoded to equal FIBs, so the FIC only needs to be decoded to detect a change otherwise.
+    bool have_raw_fic_bits_changed(const uint64_t raw_fic_bits[]) const;
+
+    // Returns whether the decoded bits of any FIB differ from the ones of the last decoded frame.
+    // The decoded bits of the FIC block i are given by fib_bits_per_fic_block[i], one bit per byte.
+    // The FIBs are compared exactly except for the CIF count of the FIG 0/0 and the CRC which covers it,
+    // since both change in every frame.
+    bool have_fibs_changed(const uint8_t* const fib_bits_per_fic_block[]);
+
+    // Is called for every frame of which the FIC is decoded.
+    void set_decoded(int frame_number, const uint64_t raw_fic_bits[], const uint8_t* const fib_bits_per_fic_block[]);
+
+    void print_statistics() const;
+
+private:
+    // The number of bits of a FIB and of the CRC at its end, see section 5.2.1 of ETSI EN 300 401 V2.1.1.
+    static constexpr int N_BITS_PER_FIB = 256;
+    static constexpr int N_CRC_BITS = 16;
+
+    // Sets the ignored bits of the FIBs of the FIC block in the mask, see have_fibs_changed.
+    void update_ignored_bits(const uint8_t fib_bits[]);
+
+    std::optional<int> m_interval;
+    bool m_detect_changes;
+    int m_n_fic_blocks;
+    int m_n_fib_bits;
+
+    // The PRBS of the energy dispersal of a FIC block which is needed to find the FIGs in the decoded bits.
+    std::vector<uint8_t> m_energy_dispersal_bits;
+
+    // One byte per decoded bit of the FIC blocks which is 1 if the bit isn't compared.
+    std::vector<uint8_t> m_ignored_bits;
+
+    std::optional<int> m_last_decoded_frame_number;
+    std::vector<uint64_t> m_reference_raw_fic_bits;
+    std::vector<uint8_t> m_reference_fib_bits;
+
+    int m_number_of_frames;
+    int m_number_of_decoded_frames;
+    int m_number_of_detected_changes;
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "FilterDesign.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <algorithm>
+
+// The beta of the Kaiser window which results in a stopband attenuation of about 80 dB.
+static constexpr double KAISER_BETA = 8.0;
+
+// The zeroth order modified Bessel function of the first kind which is needed for the Kaiser window.
+static double bessel_i0(double x)
+{
+    auto sum = 1.0;
+    auto term = 1.0;
+    for (int k = 1; k < 50; k++)
+    {
+        term = term * (x / (2.0 * k)) * (x / (2.0 * k));
+        sum = sum + term;
+    }
+    return sum;
+}
+
+Eigen::VectorXd FilterDesign::create_kaiser_lowpass(int length, double cutoff)
+{
+    auto center = (length - 1) / 2.0;
+
+    auto coefficients{ Eigen::VectorXd(length) };
+    for (int i = 0; i < length; i++)
+    {
+        auto x = i - center;
+        auto sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+        auto window_argument = 2.0 * x / (length - 1);
+        auto window = bessel_i0(KAISER_BETA * std::sqrt(std::max(0.0, 1.0 - window_argument * window_argument))) / bessel_i0(KAISER_BETA);
+        coefficients[i] = sinc * window;
+    }
+
+    return coefficients;
+}
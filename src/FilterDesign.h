@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Eigen/Dense"
+
+namespace FilterDesign
+{
+    // Returns the coefficients of a lowpass filter with a linear phase by windowing a sinc with a Kaiser window.
+    // The cutoff frequency is relative to the sample rate of the filter.
+    // The gain isn't normalized since the callers need different gains.
+    Eigen::VectorXd create_kaiser_lowpass(int length, double cutoff);
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "FrameIndex.h"
+
+#include <fstream>
+
+using namespace DabConstants;
+
+// The index is a small text file with a header of the capture metadata followed by one line per frame.
+static const char* const HEADER = "DabReceiverFrameIndex";
+
+FrameIndex::FrameIndex(const CaptureMetadata& metadata) :
+    m_metadata(metadata),
+    m_entries()
+{
+
+}
+
+std::string FrameIndex::get_index_file_path(const std::string& file_path)
+{
+    return file_path + ".idx";
+}
+
+std::optional<FrameIndex> FrameIndex::load(const std::string& file_path, const CaptureMetadata& metadata)
+{
+    auto ifstream{ std::ifstream(get_index_file_path(file_path)) };
+    if (!ifstream.is_open())
+    {
+        return std::nullopt;
+    }
+
+    auto header{ std::string() };
+    auto version = 0;
+    auto transmission_mode_id = 0;
+    auto sample_rate = 0;
+    auto sample_format = 0;
+    auto file_size = int64_t(0);
+    auto number_of_frames = 0;
+    ifstream >> header >> version >> transmission_mode_id >> sample_rate >> sample_format >> file_size >> number_of_frames;
+    if (!ifstream || header != HEADER || version != VERSION)
+    {
+        return std::nullopt;
+    }
+
+    if (transmission_mode_id != static_cast<int>(metadata.transmission_mode_id) ||
+        sample_rate != metadata.sample_rate ||
+        sample_format != static_cast<int>(metadata.sample_format) ||
+        file_size != metadata.file_size)
+    {
+        return std::nullopt;
+    }
+
+    auto frame_index{ FrameIndex(metadata) };
+    frame_index.m_entries.reserve(number_of_frames);
+    for (int i = 0; i < number_of_frames; i++)
+    {
+        auto entry{ FrameIndexEntry() };
+        ifstream >> entry.global_prs_start_index >> entry.coarse_frequency_offset >> entry.fine_frequency_offset >> entry.sample_clock_offset
+            >> entry.input_prs_start_position.input_sample_index >> entry.input_prs_start_position.fraction;
+        if (!ifstream)
+        {
+            return std::nullopt;
+        }
+
+        frame_index.m_entries.push_back(entry);
+    }
+
+    return frame_index;
+}
+
+bool FrameIndex::save(const std::string& file_path) const
+{
+    auto ofstream{ std::ofstream(get_index_file_path(file_path)) };
+    if (!ofstream.is_open())
+    {
+        return false;
+    }
+
+    ofstream << HEADER << ' ' << VERSION << '\n';
+    ofstream << static_cast<int>(m_metadata.transmission_mode_id) << ' ' << m_metadata.sample_rate << ' ' << static_cast<int>(m_metadata.sample_format) << ' ' << m_metadata.file_size << '\n';
+    ofstream << m_entries.size() << '\n';
+
+    ofstream.precision(17);
+    for (const auto& entry : m_entries)
+    {
+        ofstream << entry.global_prs_start_index << ' ' << entry.coarse_frequency_offset << ' ' << entry.fine_frequency_offset << ' ' << entry.sample_clock_offset << ' '
+            << entry.input_prs_start_position.input_sample_index << ' ' << entry.input_prs_start_position.fraction << '\n';
+    }
+
+    return static_cast<bool>(ofstream);
+}
+
+void FrameIndex::reserve(int number_of_frames)
+{
+    m_entries.reserve(number_of_frames);
+}
+
+void FrameIndex::add(const FrameIndexEntry& entry)
+{
+    m_entries.push_back(entry);
+}
+
+const std::vector<FrameIndexEntry>& FrameIndex::get_entries() const
+{
+    return m_entries;
+}
+
+std::vector<std::pair<int, int>> FrameIndex::split(int number_of_chunks) const
+{
+    auto chunks{ std::vector<std::pair<int, int>>() };
+    auto number_of_frames = static_cast<int>(m_entries.size());
+
+    auto first_frame = 0;
+    for (int i = 0; i < number_of_chunks; i++)
+    {
+        auto last_frame = static_cast<int>((static_cast<int64_t>(i + 1) * number_of_frames) / number_of_chunks);
+        if (last_frame > first_frame)
+        {
+            chunks.emplace_back(first_frame, last_frame - first_frame);
+        }
+        first_frame = last_frame;
+    }
+
+    return chunks;
+}
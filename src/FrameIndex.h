@@ -0,0 +1,78 @@
+#pragma once
+
+#include "DabConstants.h"
+#include "RawFileHandler.h"
+#include "Resampler.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Describes the capture which a frame index belongs to.
+// An index is only used if all of these values match the current run.
+struct CaptureMetadata
+{
+    DabConstants::TransmissionModeId transmission_mode_id;
+    int sample_rate;
+    SampleFormat sample_format;
+    int64_t file_size;
+};
+
+// Describes one DAB frame which was found during the first pass over a capture.
+struct FrameIndexEntry
+{
+    // The index of the first sample of the PRS symbol at the sample rate of the receiver.
+    int64_t global_prs_start_index;
+
+    // The integer part of the frequency offset in carriers.
+    int coarse_frequency_offset;
+
+    // The fractional part of the frequency offset in carriers.
+    float fine_frequency_offset;
+
+    // The relative deviation of the sample clock which the resampler compensated for this frame.
+    double sample_clock_offset;
+
+    // The position of the first sample of the PRS symbol in the samples of the file if they are resampled.
+    // Since the resampling ratio was fine-tuned frame by frame, it can't be derived from the index above.
+    ResamplerPosition input_prs_start_position;
+};
+
+// A sidecar index next to a raw IQ file which stores the start of every DAB frame.
+// It lets later runs skip the time synchronization, seek to any frame and
+// split the capture into chunks of frames.
+class FrameIndex final
+{
+public:
+    FrameIndex(const CaptureMetadata& metadata);
+
+    // Returns the file path of the index which belongs to the given raw IQ file.
+    static std::string get_index_file_path(const std::string& file_path);
+
+    // Loads the index of the given raw IQ file.
+    // It has no value if there is no index or if it doesn't match the metadata.
+    static std::optional<FrameIndex> load(const std::string& file_path, const CaptureMetadata& metadata);
+
+    // Returns whether the index could be written.
+    bool save(const std::string& file_path) const;
+
+    // Reserves the memory for the given number of entries.
+    void reserve(int number_of_frames);
+
+    void add(const FrameIndexEntry& entry);
+
+    const std::vector<FrameIndexEntry>& get_entries() const;
+
+    // Splits the frames into the given number of chunks of about the same size.
+    // Each chunk is described by its first frame and its number of frames.
+    std::vector<std::pair<int, int>> split(int number_of_chunks) const;
+
+private:
+    // Is increased whenever the layout of the index file changes.
+    static constexpr int VERSION = 3;
+
+    CaptureMetadata m_metadata;
+    std::vector<FrameIndexEntry> m_entries;
+};
\ No newline at end of file
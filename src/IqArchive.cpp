@@ -0,0 +1,441 @@
+#include "IqArchive.h"
+#include "Kernels.h"
+#include "RawFileHandler.h"
+#include "Tracing.h"
+
+#include "fmt/printf.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace IqArchive;
+
+// The header consists of the magic number, the version, the number of kept bits and the number of samples per chunk.
+static constexpr int HEADER_SIZE = 24;
+
+// Every chunk starts with its number of samples and its number of plane bytes,
+// which are followed by the width of every block and the planes.
+static constexpr int CHUNK_HEADER_SIZE = 8;
+
+// The trailer consists of the number of samples, the number of chunks and the magic number.
+static constexpr int TRAILER_SIZE = 24;
+
+static constexpr int N_BLOCKS_PER_CHUNK = N_SAMPLES_PER_CHUNK / N_SAMPLES_PER_BLOCK;
+
+// All numbers are stored as little-endian.
+static void put_uint32(uint8_t bytes[], uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static void put_uint64(uint8_t bytes[], uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint32_t get_uint32(const uint8_t bytes[])
+{
+    auto value = uint32_t(0);
+    for (int i = 0; i < 4; i++)
+    {
+        value = value | (static_cast<uint32_t>(bytes[i]) << (8 * i));
+    }
+    return value;
+}
+
+static uint64_t get_uint64(const uint8_t bytes[])
+{
+    auto value = uint64_t(0);
+    for (int i = 0; i < 8; i++)
+    {
+        value = value | (static_cast<uint64_t>(bytes[i]) << (8 * i));
+    }
+    return value;
+}
+
+static int get_number_of_blocks(int number_of_samples)
+{
+    return (number_of_samples + N_SAMPLES_PER_BLOCK - 1) / N_SAMPLES_PER_BLOCK;
+}
+
+// Writes the bit planes of the 64 values of a block and returns their number.
+// The number of planes is the number of bits of the largest zigzag encoded difference.
+static int encode_block(const uint8_t values[], int n_dropped_bits, uint8_t planes[])
+{
+    auto center = 128 >> n_dropped_bits;
+    uint8_t zigzags[64];
+    auto all_bits = 0;
+    for (int j = 0; j < 64; j++)
+    {
+        auto difference = (values[j] >> n_dropped_bits) - center;
+        zigzags[j] = static_cast<uint8_t>(difference >= 0 ? 2 * difference : -2 * difference - 1);
+        all_bits = all_bits | zigzags[j];
+    }
+
+    auto width = 0;
+    while ((all_bits >> width) != 0)
+    {
+        width++;
+    }
+
+    for (int p = 0; p < width; p++)
+    {
+        auto plane = uint64_t(0);
+        for (int j = 0; j < 64; j++)
+        {
+            plane = plane | (static_cast<uint64_t>((zigzags[j] >> p) & 1) << j);
+        }
+        put_uint64(planes + 8 * p, plane);
+    }
+
+    return width;
+}
+
+bool IqArchive::is_archive(const std::string& file_path)
+{
+    auto ifstream{ std::ifstream(file_path, std::ios_base::binary) };
+    char magic[sizeof(MAGIC)];
+    ifstream.read(magic, sizeof(magic));
+    return ifstream && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+// The planes of a chunk take at most 8 bytes per plane and 8 planes per block.
+IqArchiveWriter::IqArchiveWriter(const std::string& file_path, int n_kept_bits) :
+    m_n_dropped_bits(8 - std::clamp(n_kept_bits, 1, 8)),
+    m_ofstream(std::ofstream(file_path, std::ios_base::binary)),
+    m_raw_samples(2 * N_SAMPLES_PER_CHUNK),
+    m_number_of_chunk_samples(0),
+    m_widths(N_BLOCKS_PER_CHUNK),
+    m_planes(64 * N_BLOCKS_PER_CHUNK),
+    m_chunk_offsets(),
+    m_number_of_samples(0),
+    m_number_of_bytes(HEADER_SIZE)
+{
+    uint8_t header[HEADER_SIZE] = {};
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    put_uint32(header + 8, VERSION);
+    put_uint32(header + 12, 8 - m_n_dropped_bits);
+    put_uint32(header + 16, N_SAMPLES_PER_CHUNK);
+    m_ofstream.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+bool IqArchiveWriter::is_open() const
+{
+    return m_ofstream.is_open();
+}
+
+void IqArchiveWriter::write(const uint8_t raw_samples[], int number_of_samples)
+{
+    while (number_of_samples > 0)
+    {
+        auto length = std::min(number_of_samples, N_SAMPLES_PER_CHUNK - m_number_of_chunk_samples);
+        std::memcpy(m_raw_samples.data() + 2 * m_number_of_chunk_samples, raw_samples, 2 * length);
+        m_number_of_chunk_samples = m_number_of_chunk_samples + length;
+        m_number_of_samples = m_number_of_samples + length;
+        raw_samples = raw_samples + 2 * length;
+        number_of_samples = number_of_samples - length;
+
+        if (m_number_of_chunk_samples == N_SAMPLES_PER_CHUNK)
+        {
+            write_chunk();
+        }
+    }
+}
+
+// The last block of the last chunk is padded by the center value.
+void IqArchiveWriter::write_chunk()
+{
+    auto n_blocks = get_number_of_blocks(m_number_of_chunk_samples);
+    std::fill(m_raw_samples.begin() + 2 * m_number_of_chunk_samples, m_raw_samples.begin() + 2 * N_SAMPLES_PER_BLOCK * n_blocks, uint8_t(128));
+
+    auto n_plane_bytes = 0;
+    for (int block_index = 0; block_index < n_blocks; block_index++)
+    {
+        auto width = encode_block(m_raw_samples.data() + 2 * N_SAMPLES_PER_BLOCK * block_index, m_n_dropped_bits, m_planes.data() + n_plane_bytes);
+        m_widths[block_index] = static_cast<uint8_t>(width);
+        n_plane_bytes = n_plane_bytes + 8 * width;
+    }
+
+    uint8_t chunk_header[CHUNK_HEADER_SIZE];
+    put_uint32(chunk_header, m_number_of_chunk_samples);
+    put_uint32(chunk_header + 4, n_plane_bytes);
+    m_ofstream.write(reinterpret_cast<const char*>(chunk_header), sizeof(chunk_header));
+    m_ofstream.write(reinterpret_cast<const char*>(m_widths.data()), n_blocks);
+    m_ofstream.write(reinterpret_cast<const char*>(m_planes.data()), n_plane_bytes);
+
+    m_chunk_offsets.push_back(m_number_of_bytes);
+    m_number_of_bytes = m_number_of_bytes + CHUNK_HEADER_SIZE + n_blocks + n_plane_bytes;
+    m_number_of_chunk_samples = 0;
+}
+
+bool IqArchiveWriter::finish()
+{
+    if (m_number_of_chunk_samples > 0)
+    {
+        write_chunk();
+    }
+
+    auto index{ std::vector<uint8_t>(8 * m_chunk_offsets.size() + TRAILER_SIZE) };
+    for (int i = 0; i < static_cast<int>(m_chunk_offsets.size()); i++)
+    {
+        put_uint64(index.data() + 8 * i, m_chunk_offsets[i]);
+    }
+    auto trailer = index.data() + 8 * m_chunk_offsets.size();
+    put_uint64(trailer, m_number_of_samples);
+    put_uint64(trailer + 8, m_chunk_offsets.size());
+    std::memcpy(trailer + 16, MAGIC, sizeof(MAGIC));
+    m_ofstream.write(reinterpret_cast<const char*>(index.data()), index.size());
+    m_number_of_bytes = m_number_of_bytes + index.size();
+
+    m_ofstream.close();
+    return !m_ofstream.fail();
+}
+
+int64_t IqArchiveWriter::get_number_of_samples() const
+{
+    return m_number_of_samples;
+}
+
+int64_t IqArchiveWriter::get_number_of_bytes() const
+{
+    return m_number_of_bytes;
+}
+
+// The buffers are allocated for the largest chunk, so reading doesn't allocate.
+IqArchiveReader::IqArchiveReader(const std::string& file_path) :
+    m_n_dropped_bits(0),
+    m_ifstream(std::ifstream(file_path, std::ios_base::binary)),
+    m_chunk_offsets(),
+    m_number_of_samples(-1),
+    m_chunk_bytes(N_BLOCKS_PER_CHUNK + 64 * N_BLOCKS_PER_CHUNK),
+    m_raw_samples(2 * N_SAMPLES_PER_CHUNK),
+    m_next_chunk_index(0),
+    m_number_of_chunk_samples(0),
+    m_sample_index(0),
+    m_file_end_reached(false)
+{
+    uint8_t header[HEADER_SIZE];
+    m_ifstream.read(reinterpret_cast<char*>(header), sizeof(header));
+    auto n_kept_bits = static_cast<int>(get_uint32(header + 12));
+    if (!m_ifstream || std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 || get_uint32(header + 8) != VERSION ||
+        n_kept_bits < 1 || n_kept_bits > 8 || get_uint32(header + 16) != N_SAMPLES_PER_CHUNK)
+    {
+        fmt::println("{} isn't an IQ archive of the version {}.", file_path, VERSION);
+        m_file_end_reached = true;
+        return;
+    }
+    m_n_dropped_bits = 8 - n_kept_bits;
+
+    if (!read_trailer())
+    {
+        fmt::println("The IQ archive {} has no trailer. It can only be read from its start.", file_path);
+    }
+    m_ifstream.clear();
+    m_ifstream.seekg(HEADER_SIZE);
+}
+
+// The offsets must lie between the header and the chunk offsets in increasing order.
+bool IqArchiveReader::read_trailer()
+{
+    m_ifstream.seekg(0, std::ios_base::end);
+    auto file_size = static_cast<int64_t>(m_ifstream.tellg());
+    if (file_size < HEADER_SIZE + TRAILER_SIZE)
+    {
+        return false;
+    }
+
+    uint8_t trailer[TRAILER_SIZE];
+    m_ifstream.seekg(file_size - TRAILER_SIZE);
+    m_ifstream.read(reinterpret_cast<char*>(trailer), sizeof(trailer));
+    auto number_of_chunks = get_uint64(trailer + 8);
+    if (!m_ifstream || std::memcmp(trailer + 16, MAGIC, sizeof(MAGIC)) != 0 ||
+        number_of_chunks > static_cast<uint64_t>(file_size - HEADER_SIZE - TRAILER_SIZE) / 8)
+    {
+        return false;
+    }
+
+    auto index_offset = file_size - TRAILER_SIZE - 8 * static_cast<int64_t>(number_of_chunks);
+    auto index{ std::vector<uint8_t>(8 * number_of_chunks) };
+    m_ifstream.seekg(index_offset);
+    m_ifstream.read(reinterpret_cast<char*>(index.data()), index.size());
+    if (!m_ifstream)
+    {
+        return false;
+    }
+
+    auto chunk_offsets{ std::vector<int64_t>(number_of_chunks) };
+    for (int i = 0; i < static_cast<int>(number_of_chunks); i++)
+    {
+        chunk_offsets[i] = static_cast<int64_t>(get_uint64(index.data() + 8 * i));
+        auto previous_offset = i == 0 ? HEADER_SIZE - 1 : chunk_offsets[i - 1];
+        if (chunk_offsets[i] <= previous_offset || chunk_offsets[i] >= index_offset)
+        {
+            return false;
+        }
+    }
+
+    m_chunk_offsets = std::move(chunk_offsets);
+    m_number_of_samples = static_cast<int64_t>(get_uint64(trailer));
+    return true;
+}
+
+// The widths are checked so that a damaged chunk can't make the kernel read beyond the planes.
+bool IqArchiveReader::load_chunk()
+{
+    auto span{ Tracing::ScopedSpan("IqArchiveReader::load_chunk") };
+
+    if (!m_chunk_offsets.empty() && m_next_chunk_index >= static_cast<int>(m_chunk_offsets.size()))
+    {
+        return false;
+    }
+
+    uint8_t chunk_header[CHUNK_HEADER_SIZE];
+    m_ifstream.read(reinterpret_cast<char*>(chunk_header), sizeof(chunk_header));
+    if (!m_ifstream)
+    {
+        return false;
+    }
+
+    auto number_of_samples = static_cast<int>(std::min<uint32_t>(get_uint32(chunk_header), N_SAMPLES_PER_CHUNK + 1));
+    auto n_plane_bytes = static_cast<int>(std::min<uint32_t>(get_uint32(chunk_header + 4), 64 * N_BLOCKS_PER_CHUNK + 1));
+    auto n_blocks = get_number_of_blocks(number_of_samples);
+    if (number_of_samples == 0 || number_of_samples > N_SAMPLES_PER_CHUNK || n_plane_bytes > 64 * n_blocks)
+    {
+        return false;
+    }
+
+    m_ifstream.read(reinterpret_cast<char*>(m_chunk_bytes.data()), n_blocks + n_plane_bytes);
+    if (!m_ifstream)
+    {
+        return false;
+    }
+
+    auto n_planes = 0;
+    for (int i = 0; i < n_blocks; i++)
+    {
+        if (m_chunk_bytes[i] > 8 - m_n_dropped_bits)
+        {
+            return false;
+        }
+        n_planes = n_planes + m_chunk_bytes[i];
+    }
+    if (8 * n_planes != n_plane_bytes)
+    {
+        return false;
+    }
+
+    Kernels::get().unpack_iq_blocks(m_chunk_bytes.data(), m_chunk_bytes.data() + n_blocks, n_blocks, m_n_dropped_bits, m_raw_samples.data());
+    m_number_of_chunk_samples = number_of_samples;
+    m_sample_index = 0;
+    m_next_chunk_index++;
+    return true;
+}
+
+void IqArchiveReader::read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index)
+{
+    auto span{ Tracing::ScopedSpan("IqArchiveReader::read") };
+
+    if (start_index > stop_index)
+    {
+        return;
+    }
+
+    if (m_file_end_reached)
+    {
+        return;
+    }
+
+    // The samples are converted in runs up to the end of the chunk.
+    auto i = start_index;
+    while (i <= stop_index)
+    {
+        if (m_sample_index >= m_number_of_chunk_samples && !load_chunk())
+        {
+            m_file_end_reached = true;
+            return;
+        }
+
+        auto length = std::min(stop_index - i + 1, m_number_of_chunk_samples - m_sample_index);
+        convert_samples(SampleFormat::CU8, m_raw_samples.data() + 2 * m_sample_index, output.data() + i, length);
+
+        i = i + length;
+        m_sample_index = m_sample_index + length;
+    }
+}
+
+int IqArchiveReader::read_raw(uint8_t raw_samples[], int max_number_of_samples)
+{
+    auto number_of_samples = 0;
+    while (number_of_samples < max_number_of_samples && !m_file_end_reached)
+    {
+        if (m_sample_index >= m_number_of_chunk_samples && !load_chunk())
+        {
+            m_file_end_reached = true;
+            break;
+        }
+
+        auto length = std::min(max_number_of_samples - number_of_samples, m_number_of_chunk_samples - m_sample_index);
+        std::memcpy(raw_samples + 2 * number_of_samples, m_raw_samples.data() + 2 * m_sample_index, 2 * length);
+
+        number_of_samples = number_of_samples + length;
+        m_sample_index = m_sample_index + length;
+    }
+
+    return number_of_samples;
+}
+
+bool IqArchiveReader::get_file_end_reached()
+{
+    return m_file_end_reached;
+}
+
+// Every chunk but the last one has the same number of samples, so the chunk of a sample follows from its index.
+void IqArchiveReader::skip(int64_t number_of_samples)
+{
+    if (m_file_end_reached || number_of_samples <= 0)
+    {
+        return;
+    }
+
+    // The samples which are left in the chunk are skipped first.
+    auto number_of_chunk_samples = m_number_of_chunk_samples - m_sample_index;
+    if (number_of_samples <= number_of_chunk_samples)
+    {
+        m_sample_index = m_sample_index + static_cast<int>(number_of_samples);
+        return;
+    }
+
+    if (m_chunk_offsets.empty())
+    {
+        SampleSource::skip(number_of_samples);
+        return;
+    }
+
+    auto sample_index = static_cast<int64_t>(m_next_chunk_index) * N_SAMPLES_PER_CHUNK + number_of_samples - number_of_chunk_samples;
+    auto chunk_index = sample_index / N_SAMPLES_PER_CHUNK;
+    if (chunk_index >= static_cast<int64_t>(m_chunk_offsets.size()))
+    {
+        m_file_end_reached = true;
+        return;
+    }
+
+    m_ifstream.seekg(m_chunk_offsets[chunk_index]);
+    m_next_chunk_index = static_cast<int>(chunk_index);
+    if (!load_chunk())
+    {
+        m_file_end_reached = true;
+        return;
+    }
+    m_sample_index = static_cast<int>(sample_index % N_SAMPLES_PER_CHUNK);
+}
+
+int64_t IqArchiveReader::get_number_of_samples() const
+{
+    return m_number_of_samples;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "SampleSource.h"
+
+#include "Eigen/Dense"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A compressed archive of cu8 samples which is read much faster than the raw IQ file from disk.
+// The values of I and Q are coded in blocks of 64 values, i.e. 32 samples.
+// The difference of each value to the center 128 is zigzag encoded, so that small magnitudes give small numbers,
+// and stored as bit planes: a block only needs as many planes of 8 bytes as the largest number of the block has bits.
+// In the lossy mode, the low bits of every value are dropped before and restored by the middle of their range.
+//
+// The blocks are grouped into chunks which can be decoded independently of each other.
+// The file starts with a header and ends with the offsets of all chunks followed by a trailer,
+// so that a reader can seek to any sample. A file whose trailer is missing, e.g. because the capture was aborted,
+// can still be read from its start.
+namespace IqArchive
+{
+    // The magic number at the start of every archive.
+    constexpr char MAGIC[8] = { 'D', 'A', 'B', 'I', 'Q', 'A', 'R', 'C' };
+
+    // Is increased whenever the layout of the archive changes.
+    constexpr int VERSION = 1;
+
+    constexpr int N_SAMPLES_PER_BLOCK = 32;
+
+    // The number of samples of every chunk but the last one.
+    constexpr int N_SAMPLES_PER_CHUNK = 65'536;
+
+    static_assert(N_SAMPLES_PER_CHUNK % N_SAMPLES_PER_BLOCK == 0);
+
+    // Returns whether the file starts with the magic number of an archive.
+    bool is_archive(const std::string& file_path);
+}
+
+class IqArchiveWriter final
+{
+public:
+    // 8 kept bits are lossless. Fewer bits drop the low bits of every value.
+    IqArchiveWriter(const std::string& file_path, int n_kept_bits = 8);
+
+    // Returns whether the file could be opened.
+    bool is_open() const;
+
+    // Appends cu8 samples where I and Q are of the type uint8_t.
+    void write(const uint8_t raw_samples[], int number_of_samples);
+
+    // Writes the last chunk and the chunk offsets. Returns whether the whole archive could be written.
+    bool finish();
+
+    int64_t get_number_of_samples() const;
+
+    // Returns the number of bytes which are written so far.
+    int64_t get_number_of_bytes() const;
+
+private:
+    void write_chunk();
+
+    int m_n_dropped_bits;
+    std::ofstream m_ofstream;
+
+    // The samples of the chunk which isn't written yet.
+    std::vector<uint8_t> m_raw_samples;
+    int m_number_of_chunk_samples;
+
+    std::vector<uint8_t> m_widths;
+    std::vector<uint8_t> m_planes;
+    std::vector<int64_t> m_chunk_offsets;
+    int64_t m_number_of_samples;
+    int64_t m_number_of_bytes;
+};
+
+class IqArchiveReader final : public SampleSource
+{
+public:
+    IqArchiveReader(const std::string& file_path);
+
+    void read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index) override;
+
+    // Copies up to the given number of the next samples as cu8 samples and returns how many were copied.
+    int read_raw(uint8_t raw_samples[], int max_number_of_samples);
+
+    bool get_file_end_reached() override;
+
+    // Skips the next samples by seeking to their chunk if the archive has a trailer.
+    void skip(int64_t number_of_samples) override;
+
+    // Returns the number of samples of the archive or -1 if the trailer is missing.
+    int64_t get_number_of_samples() const;
+
+private:
+    // Reads and decodes the chunk at the current position of the file. Returns whether there was one.
+    bool load_chunk();
+
+    bool read_trailer();
+
+    int m_n_dropped_bits;
+    std::ifstream m_ifstream;
+
+    // The offsets of the chunks in the file, which are only known if the archive has a trailer.
+    std::vector<int64_t> m_chunk_offsets;
+    int64_t m_number_of_samples;
+
+    std::vector<uint8_t> m_chunk_bytes;
+    std::vector<uint8_t> m_raw_samples;
+    int m_next_chunk_index;
+    int m_number_of_chunk_samples;
+    int m_sample_index;
+
+    bool m_file_end_reached;
+};
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "Kernels.h"
+#include "PackedBits.h"
+
+#include "fmt/printf.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using CpuFeatures::IsaLevel;
+
+namespace Kernels
+{
+    // The IQ data of the type uint8_t contains a DC which is removed.
+    static void convert_cu8_samples(const uint8_t input[], std::complex<float> output[], int length)
+    {
+        for (int i = 0; i < length; i++)
+        {
+            output[i] = std::complex<float>((input[2 * i] - 128.0f) / 128.0f, (input[2 * i + 1] - 128.0f) / 128.0f);
+        }
+    }
+
+    // The products are written out so that they don't depend on how std::complex handles infinite values.
+    static void multiply_complex(std::complex<float> values[], const std::complex<float> factors[], int length)
+    {
+        for (int i = 0; i < length; i++)
+        {
+            auto real = values[i].real() * factors[i].real() - values[i].imag() * factors[i].imag();
+            auto imag = values[i].real() * factors[i].imag() + values[i].imag() * factors[i].real();
+            values[i] = std::complex<float>(real, imag);
+        }
+    }
+
+    static void extract_sign_bits(const float values[], int number_of_words, uint64_t real_bits[], uint64_t imag_bits[])
+    {
+        for (int word_index = 0; word_index < number_of_words; word_index++)
+        {
+            auto word_values = values + 2 * 64 * word_index;
+            real_bits[word_index] = 0;
+            imag_bits[word_index] = 0;
+            for (int i = 0; i < 64; i++)
+            {
+                uint32_t real;
+                uint32_t imag;
+                std::memcpy(&real, &word_values[2 * i], sizeof(real));
+                std::memcpy(&imag, &word_values[2 * i + 1], sizeof(imag));
+                real_bits[word_index] = real_bits[word_index] | (static_cast<uint64_t>(real >> 31) << i);
+                imag_bits[word_index] = imag_bits[word_index] | (static_cast<uint64_t>(imag >> 31) << i);
+            }
+        }
+    }
+
+    static void add_compare_select(
+        const int previous_metrics[],
+        int metrics[],
+        const uint8_t previous_states[],
+        const uint8_t previous_outputs[],
+        const int branch_metrics[],
+        int n_states)
+    {
+        for (int state_index = 0; state_index < n_states; state_index++)
+        {
+            auto distance = INT_MAX;
+            for (int i = 0; i < 2; i++)
+            {
+                auto previous_distance = previous_metrics[previous_states[i * n_states + state_index]];
+                if (previous_distance < INT_MAX)
+                {
+                    auto possible_distance = previous_distance + branch_metrics[previous_outputs[i * n_states + state_index]];
+                    if (possible_distance < distance)
+                    {
+                        distance = possible_distance;
+                    }
+                }
+            }
+            metrics[state_index] = distance;
+        }
+    }
+
+    // The multiplication by a constant is linear over GF(2), so the products of both nibbles are added.
+    static void compute_syndromes(
+        const uint8_t interleaved[],
+        int depth,
+        int length,
+        const uint8_t multiplication_tables[],
+        int n_syndromes,
+        uint8_t syndromes[])
+    {
+        for (int i = 0; i < n_syndromes; i++)
+        {
+            auto table = multiplication_tables + 32 * i;
+            for (int j = 0; j < depth; j++)
+            {
+                auto syndrome = uint8_t(0);
+                for (int k = 0; k < length; k++)
+                {
+                    syndrome = table[syndrome & 0x0F] ^ table[16 + (syndrome >> 4)] ^ interleaved[k * depth + j];
+                }
+                syndromes[i * depth + j] = syndrome;
+            }
+        }
+    }
+
+    static void unpack_iq_blocks(const uint8_t widths[], const uint8_t planes[], int n_blocks, int n_dropped_bits, uint8_t output[])
+    {
+        auto center = 128 >> n_dropped_bits;
+        auto rounding = n_dropped_bits > 0 ? 1 << (n_dropped_bits - 1) : 0;
+        for (int block_index = 0; block_index < n_blocks; block_index++)
+        {
+            auto width = static_cast<int>(widths[block_index]);
+            for (int j = 0; j < 64; j++)
+            {
+                auto zigzag = 0;
+                for (int p = 0; p < width; p++)
+                {
+                    zigzag = zigzag | (((planes[8 * p + j / 8] >> (j % 8)) & 1) << p);
+                }
+                auto difference = (zigzag >> 1) ^ -(zigzag & 1);
+                output[j] = static_cast<uint8_t>(((difference + center) << n_dropped_bits) + rounding);
+            }
+            planes = planes + 8 * width;
+            output = output + 64;
+        }
+    }
+
+    // Only the set bits of the mask are iterated instead of all 64 bit positions.
+    static uint64_t deposit_bits(uint64_t source, uint64_t mask)
+    {
+        auto result = uint64_t(0);
+        for (auto source_bit = uint64_t(1); mask != 0; source_bit = source_bit << 1)
+        {
+            if ((source & source_bit) != 0)
+            {
+                result = result | (mask & (~mask + 1));
+            }
+            mask = mask & (mask - 1);
+        }
+        return result;
+    }
+
+    void bind_scalar_kernels(KernelTable& kernel_table)
+    {
+        kernel_table.isa_level = IsaLevel::SCALAR;
+        kernel_table.convert_cu8_samples = convert_cu8_samples;
+        kernel_table.multiply_complex = multiply_complex;
+        kernel_table.extract_sign_bits = extract_sign_bits;
+        kernel_table.add_compare_select = add_compare_select;
+        kernel_table.compute_syndromes = compute_syndromes;
+        kernel_table.unpack_iq_blocks = unpack_iq_blocks;
+        kernel_table.deposit_bits = deposit_bits;
+    }
+
+    KernelTable create(IsaLevel isa_level)
+    {
+        auto kernel_table{ KernelTable() };
+        bind_scalar_kernels(kernel_table);
+        if (isa_level >= IsaLevel::SSE4_2)
+        {
+            bind_sse4_2_kernels(kernel_table);
+        }
+        if (isa_level >= IsaLevel::AVX2)
+        {
+            bind_avx2_kernels(kernel_table);
+        }
+
+        // There are no AVX-512 implementations yet, so that level uses the AVX2 kernels and reports their level.
+        kernel_table.isa_level = std::min(isa_level, HIGHEST_ISA_LEVEL);
+        return kernel_table;
+    }
+
+    // The forced instruction set level can only lower the detected one.
+    static IsaLevel get_isa_level()
+    {
+        auto detected_isa_level = CpuFeatures::detect();
+
+        auto forced_isa_value = std::getenv(CpuFeatures::FORCE_ISA_VARIABLE);
+        if (forced_isa_value == nullptr)
+        {
+            return detected_isa_level;
+        }
+
+        auto forced_isa_level = CpuFeatures::parse(forced_isa_value);
+        if (!forced_isa_level.has_value())
+        {
+            fmt::println("{} must be one of scalar, sse4.2, avx2 or avx512.", CpuFeatures::FORCE_ISA_VARIABLE);
+            return detected_isa_level;
+        }
+
+        if (forced_isa_level.value() > detected_isa_level)
+        {
+            fmt::println("The CPU doesn't support {}.", CpuFeatures::get_name(forced_isa_level.value()));
+            return detected_isa_level;
+        }
+
+        return forced_isa_level.value();
+    }
+
+    const KernelTable& get()
+    {
+        static const auto kernel_table = []()
+        {
+            auto kernel_table = create(get_isa_level());
+            fmt::println("Using the {} kernels.", CpuFeatures::get_name(kernel_table.isa_level));
+            return kernel_table;
+        }();
+        return kernel_table;
+    }
+
+    // The lengths aren't multiples of the vector widths so that the remainder loops are tested, too.
+    static constexpr int SELF_TEST_LENGTHS[] = { 0, 1, 3, 7, 1'001, 4'099 };
+
+    static constexpr int SELF_TEST_N_WORDS = 24;
+
+    static constexpr int SELF_TEST_N_STATES = 64;
+
+    // The depths of the DAB+ superframes from 8 to 192 kbit/s which aren't all multiples of the vector widths.
+    static constexpr int SELF_TEST_DEPTHS[] = { 1, 5, 16, 21, 24 };
+
+    static constexpr int SELF_TEST_CODEWORD_LENGTH = 120;
+
+    static constexpr int SELF_TEST_N_SYNDROMES = 10;
+
+    static constexpr int SELF_TEST_N_BLOCKS = 37;
+
+    static bool print_result(const char* kernel_name, IsaLevel isa_level, bool is_bit_exact)
+    {
+        fmt::println("{} ({}): {}", kernel_name, CpuFeatures::get_name(isa_level), is_bit_exact ? "bit-exact" : "MISMATCH");
+        return is_bit_exact;
+    }
+
+    static bool test_convert_cu8_samples(const KernelTable& reference, const KernelTable& candidate, std::mt19937& random_engine)
+    {
+        auto byte_distribution{ std::uniform_int_distribution<int>(0, 255) };
+        for (auto length : SELF_TEST_LENGTHS)
+        {
+            auto input{ std::vector<uint8_t>(2 * length) };
+            for (auto& value : input)
+            {
+                value = static_cast<uint8_t>(byte_distribution(random_engine));
+            }
+
+            auto expected{ std::vector<std::complex<float>>(length) };
+            auto actual{ std::vector<std::complex<float>>(length) };
+            reference.convert_cu8_samples(input.data(), expected.data(), length);
+            candidate.convert_cu8_samples(input.data(), actual.data(), length);
+            if (std::memcmp(expected.data(), actual.data(), length * sizeof(std::complex<float>)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool test_multiply_complex(const KernelTable& reference, const KernelTable& candidate, std::mt19937& random_engine)
+    {
+        auto value_distribution{ std::uniform_real_distribution<float>(-2.0f, 2.0f) };
+        for (auto length : SELF_TEST_LENGTHS)
+        {
+            auto values{ std::vector<std::complex<float>>(length) };
+            auto factors{ std::vector<std::complex<float>>(length) };
+            for (int i = 0; i < length; i++)
+            {
+                values[i] = std::complex<float>(value_distribution(random_engine), value_distribution(random_engine));
+                factors[i] = std::polar(1.0f, value_distribution(random_engine));
+            }
+
+            auto expected{ values };
+            auto actual{ values };
+            reference.multiply_complex(expected.data(), factors.data(), length);
+            candidate.multiply_complex(actual.data(), factors.data(), length);
+            if (std::memcmp(expected.data(), actual.data(), length * sizeof(std::complex<float>)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Signed zeros are included because only their sign bits distinguish them.
+    static bool test_extract_sign_bits(const KernelTable& reference, const KernelTable& candidate, std::mt19937& random_engine)
+    {
+        auto value_distribution{ std::uniform_real_distribution<float>(-1.0f, 1.0f) };
+        auto values{ std::vector<float>(2 * 64 * SELF_TEST_N_WORDS) };
+        for (int i = 0; i < static_cast<int>(values.size()); i++)
+        {
+            values[i] = i % 17 == 0 ? (i % 2 == 0 ? 0.0f : -0.0f) : value_distribution(random_engine);
+        }
+
+        auto expected_real_bits{ std::vector<uint64_t>(SELF_TEST_N_WORDS) };
+        auto expected_imag_bits{ std::vector<uint64_t>(SELF_TEST_N_WORDS) };
+        auto actual_real_bits{ std::vector<uint64_t>(SELF_TEST_N_WORDS) };
+        auto actual_imag_bits{ std::vector<uint64_t>(SELF_TEST_N_WORDS) };
+        reference.extract_sign_bits(values.data(), SELF_TEST_N_WORDS, expected_real_bits.data(), expected_imag_bits.data());
+        candidate.extract_sign_bits(values.data(), SELF_TEST_N_WORDS, actual_real_bits.data(), actual_imag_bits.data());
+        return expected_real_bits == actual_real_bits && expected_imag_bits == actual_imag_bits;
+    }
+
+    // Some previous metrics are INT_MAX because the unreachable states at the beginning of a codeword must stay unreachable.
+    static bool test_add_compare_select(const KernelTable& reference, const KernelTable& candidate, std::mt19937& random_engine)
+    {
+        auto state_distribution{ std::uniform_int_distribution<int>(0, SELF_TEST_N_STATES - 1) };
+        auto output_distribution{ std::uniform_int_distribution<int>(0, 15) };
+        auto metric_distribution{ std::uniform_int_distribution<int>(0, 1'000) };
+
+        for (int round = 0; round < 16; round++)
+        {
+            auto previous_metrics{ std::vector<int>(SELF_TEST_N_STATES) };
+            auto previous_states{ std::vector<uint8_t>(2 * SELF_TEST_N_STATES) };
+            auto previous_outputs{ std::vector<uint8_t>(2 * SELF_TEST_N_STATES) };
+            auto branch_metrics{ std::vector<int>(16) };
+            for (int i = 0; i < SELF_TEST_N_STATES; i++)
+            {
+                previous_metrics[i] = metric_distribution(random_engine) < 200 ? INT_MAX : metric_distribution(random_engine);
+            }
+            for (int i = 0; i < 2 * SELF_TEST_N_STATES; i++)
+            {
+                previous_states[i] = static_cast<uint8_t>(state_distribution(random_engine));
+                previous_outputs[i] = static_cast<uint8_t>(output_distribution(random_engine));
+            }
+            for (auto& branch_metric : branch_metrics)
+            {
+                branch_metric = output_distribution(random_engine) % 5;
+            }
+
+            auto expected{ std::vector<int>(SELF_TEST_N_STATES) };
+            auto actual{ std::vector<int>(SELF_TEST_N_STATES) };
+            reference.add_compare_select(previous_metrics.data(), expected.data(), previous_states.data(), previous_outputs.data(), branch_metrics.data(), SELF_TEST_N_STATES);
+            candidate.add_compare_select(previous_metrics.data(), actual.data(), previous_states.data(), previous_outputs.data(), branch_metrics.data(), SELF_TEST_N_STATES);
+            if (expected != actual)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The multiplication tables are random instead of the ones of a field because the kernels must only agree on the table lookups.
+    static bool test_compute_syndromes(const KernelTable& reference, const KernelTable& candidate, std::mt19937& random_engine)
+    {
+        auto byte_distribution{ std::uniform_int_distribution<int>(0, 255) };
+        auto multiplication_tables{ std::vector<uint8_t>(32 * SELF_TEST_N_SYNDROMES) };
+        for (auto& value : multiplication_tables)
+        {
+            value = static_cast<uint8_t>(byte_distribution(random_engine));
+        }
+
+        for (auto depth : SELF_TEST_DEPTHS)
+        {
+            auto interleaved{ std::vector<uint8_t>(SELF_TEST_CODEWORD_LENGTH * depth) };
+            for (auto& value : interleaved)
+            {
+                value = static_cast<uint8_t>(byte_distribution(random_engine));
+            }
+
+            auto expected{ std::vector<uint8_t>(SELF_TEST_N_SYNDROMES * depth) };
+            auto actual{ std::vector<uint8_t>(SELF_TEST_N_SYNDROMES * depth) };
+            reference.compute_syndromes(interleaved.data(), depth, SELF_TEST_CODEWORD_LENGTH, multiplication_tables.data(), SELF_TEST_N_SYNDROMES, expected.data());
+            candidate.compute_syndromes(interleaved.data(), depth, SELF_TEST_CODEWORD_LENGTH, multiplication_tables.data(), SELF_TEST_N_SYNDROMES, actual.data());
+            if (expected != actual)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Every width from 0 to the maximum of the number of dropped bits occurs, and the planes are random
+    // because the kernels must also agree on values which no encoder produces.
+    static bool test_unpack_iq_blocks(const KernelTable& reference, const KernelTable& candidate, std::mt19937& random_engine)
+    {
+        auto byte_distribution{ std::uniform_int_distribution<int>(0, 255) };
+        for (int n_dropped_bits = 0; n_dropped_bits < 8; n_dropped_bits++)
+        {
+            auto widths{ std::vector<uint8_t>(SELF_TEST_N_BLOCKS) };
+            auto n_planes = 0;
+            for (int i = 0; i < SELF_TEST_N_BLOCKS; i++)
+            {
+                widths[i] = static_cast<uint8_t>(i % (9 - n_dropped_bits));
+                n_planes = n_planes + widths[i];
+            }
+
+            auto planes{ std::vector<uint8_t>(8 * n_planes) };
+            for (auto& value : planes)
+            {
+                value = static_cast<uint8_t>(byte_distribution(random_engine));
+            }
+
+            auto expected{ std::vector<uint8_t>(64 * SELF_TEST_N_BLOCKS) };
+            auto actual{ std::vector<uint8_t>(64 * SELF_TEST_N_BLOCKS) };
+            reference.unpack_iq_blocks(widths.data(), planes.data(), SELF_TEST_N_BLOCKS, n_dropped_bits, expected.data());
+            candidate.unpack_iq_blocks(widths.data(), planes.data(), SELF_TEST_N_BLOCKS, n_dropped_bits, actual.data());
+            if (expected != actual)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The masks have every number of set bits from 0 to 64.
+    static bool test_deposit_bits(const KernelTable& reference, const KernelTable& candidate, std::mt19937& random_engine)
+    {
+        auto word_distribution{ std::uniform_int_distribution<uint64_t>() };
+        for (int n_set_bits = 0; n_set_bits <= 64; n_set_bits++)
+        {
+            auto mask = uint64_t(0);
+            while (PackedBits::popcount(mask) < n_set_bits)
+            {
+                mask = mask | (uint64_t(1) << (word_distribution(random_engine) % 64));
+            }
+
+            auto source = word_distribution(random_engine);
+            if (reference.deposit_bits(source, mask) != candidate.deposit_bits(source, mask))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool run_self_test()
+    {
+        auto detected_isa_level = CpuFeatures::detect();
+        fmt::println("The CPU supports {}.", CpuFeatures::get_name(detected_isa_level));
+
+        auto reference = create(IsaLevel::SCALAR);
+        auto is_bit_exact = true;
+        // The AVX-512 level has no kernels of its own yet.
+        for (auto isa_level : { IsaLevel::SSE4_2, IsaLevel::AVX2 })
+        {
+            if (isa_level > detected_isa_level)
+            {
+                break;
+            }
+
+            // Every level gets the same inputs.
+            auto random_engine{ std::mt19937(42) };
+            auto candidate = create(isa_level);
+            is_bit_exact = print_result("convert_cu8_samples", isa_level, test_convert_cu8_samples(reference, candidate, random_engine)) && is_bit_exact;
+            is_bit_exact = print_result("multiply_complex", isa_level, test_multiply_complex(reference, candidate, random_engine)) && is_bit_exact;
+            is_bit_exact = print_result("extract_sign_bits", isa_level, test_extract_sign_bits(reference, candidate, random_engine)) && is_bit_exact;
+            is_bit_exact = print_result("add_compare_select", isa_level, test_add_compare_select(reference, candidate, random_engine)) && is_bit_exact;
+            is_bit_exact = print_result("compute_syndromes", isa_level, test_compute_syndromes(reference, candidate, random_engine)) && is_bit_exact;
+            is_bit_exact = print_result("unpack_iq_blocks", isa_level, test_unpack_iq_blocks(reference, candidate, random_engine)) && is_bit_exact;
+            is_bit_exact = print_result("deposit_bits", isa_level, test_deposit_bits(reference, candidate, random_engine)) && is_bit_exact;
+        }
+
+        return is_bit_exact;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CpuFeatures.h"
+
+#include <complex>
+#include <cstdint>
+
+// The hot kernels of the receiver of which an implementation is bound per instruction set level at startup.
+// The scalar implementations are the reference for all others which must produce bit-exact results.
+namespace Kernels
+{
+    // The highest instruction set level which has its own kernels.
+    // A CPU which supports a higher level, i.e. AVX-512, uses the kernels of this level.
+    constexpr CpuFeatures::IsaLevel HIGHEST_ISA_LEVEL = CpuFeatures::IsaLevel::AVX2;
+
+    struct KernelTable
+    {
+        // The instruction set level which the kernels are implemented for, i.e. at most HIGHEST_ISA_LEVEL.
+        CpuFeatures::IsaLevel isa_level;
+
+        // Converts raw IQ samples where I and Q are of the type uint8_t to complex samples in the range [-1, 1).
+        void (*convert_cu8_samples)(const uint8_t input[], std::complex<float> output[], int length);
+
+        // Multiplies the values element-wise by the factors, e.g. to rotate a signal by a phase vector.
+        void (*multiply_complex)(std::complex<float> values[], const std::complex<float> factors[], int length);
+
+        // Extracts the sign bits of the real and imaginary parts of 64 complex values per word.
+        // The values are given as interleaved floats. A negative value results in the bit 1.
+        void (*extract_sign_bits)(const float values[], int number_of_words, uint64_t real_bits[], uint64_t imag_bits[]);
+
+        // Performs one time step of the Viterbi algorithm for a code where each state has 2 previous states.
+        // The previous states and the outputs of the transitions from them are stored column by column,
+        // i.e. the first previous state of every state is followed by the second previous state of every state.
+        // The branch metrics are indexed by the packed output of a transition.
+        // A metric of INT_MAX marks an unreachable state.
+        void (*add_compare_select)(
+            const int previous_metrics[],
+            int metrics[],
+            const uint8_t previous_states[],
+            const uint8_t previous_outputs[],
+            const int branch_metrics[],
+            int n_states);
+
+        // Computes the syndromes of depth codewords over GF(2^8) which are interleaved byte by byte,
+        // i.e. the byte k of the codeword j is interleaved[k * depth + j].
+        // The syndrome i of the codeword j is written to syndromes[i * depth + j].
+        // It is evaluated by Horner's scheme whose multiplication by the i-th root is given by 32 bytes of the multiplication tables:
+        // the products of the root and the 16 values of the low nibble followed by the ones of the high nibble.
+        void (*compute_syndromes)(
+            const uint8_t interleaved[],
+            int depth,
+            int length,
+            const uint8_t multiplication_tables[],
+            int n_syndromes,
+            uint8_t syndromes[]);
+
+        // Deposits the lowest bits of the source at the positions of the bits set in the mask, e.g. to depuncture a codeword.
+        uint64_t (*deposit_bits)(uint64_t source, uint64_t mask);
+
+        // Restores blocks of 64 cu8 values of an IQ archive from their bit planes, see IqArchive.h.
+        // The block k has widths[k] planes of 8 bytes each, the least significant plane first,
+        // where the bit j of the plane p is the bit p of the value j. The planes of all blocks follow each other.
+        // The planes hold the zigzag encoded difference of the value without its n_dropped_bits low bits to the center 128,
+        // and the dropped bits are restored by the middle of their range.
+        void (*unpack_iq_blocks)(const uint8_t widths[], const uint8_t planes[], int n_blocks, int n_dropped_bits, uint8_t output[]);
+    };
+
+    // Returns the kernels which are bound for the CPU on the first call.
+    // The instruction set level can be lowered by the environment variable CpuFeatures::FORCE_ISA_VARIABLE.
+    const KernelTable& get();
+
+    // Returns the best kernels for the given instruction set level.
+    // The level of the kernels is lowered to HIGHEST_ISA_LEVEL.
+    KernelTable create(CpuFeatures::IsaLevel isa_level);
+
+    // Runs every implementation which the CPU supports and the scalar reference on the same random inputs
+    // and returns whether all results are bit-exact.
+    bool run_self_test();
+
+    // The kernels of the individual instruction set levels.
+    // A level without its own implementation of a kernel takes the one of the level below.
+    void bind_scalar_kernels(KernelTable& kernel_table);
+    void bind_sse4_2_kernels(KernelTable& kernel_table);
+    void bind_avx2_kernels(KernelTable& kernel_table);
+}
\ No newline at end of file
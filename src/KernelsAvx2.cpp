@@ -0,0 +1,271 @@
+#include "Kernels.h"
+
+#include <climits>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+
+// The kernels are compiled for AVX2 regardless of the compiler flags
+// because they are only called if the CPU supports it.
+// FMA isn't enabled so that the products are rounded like the ones of the scalar kernels.
+#if defined(__GNUC__)
+#define KERNEL_TARGET __attribute__((target("avx2")))
+#else
+#define KERNEL_TARGET
+#endif
+
+namespace Kernels
+{
+    // 8 samples are converted per step.
+    KERNEL_TARGET static void convert_cu8_samples(const uint8_t input[], std::complex<float> output[], int length)
+    {
+        auto offset = _mm256_set1_ps(128.0f);
+        auto scale = _mm256_set1_ps(1.0f / 128.0f);
+        auto floats = reinterpret_cast<float*>(output);
+
+        auto i = 0;
+        for (; i + 8 <= length; i += 8)
+        {
+            auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 2 * i));
+            auto low = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+            auto high = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+
+            // Dividing by 128 is exact as multiplication by its reciprocal.
+            _mm256_storeu_ps(floats + 2 * i, _mm256_mul_ps(_mm256_sub_ps(low, offset), scale));
+            _mm256_storeu_ps(floats + 2 * i + 8, _mm256_mul_ps(_mm256_sub_ps(high, offset), scale));
+        }
+
+        for (; i < length; i++)
+        {
+            output[i] = std::complex<float>((input[2 * i] - 128.0f) / 128.0f, (input[2 * i + 1] - 128.0f) / 128.0f);
+        }
+    }
+
+    // 4 values are multiplied per step, see the SSE4.2 kernel.
+    KERNEL_TARGET static void multiply_complex(std::complex<float> values[], const std::complex<float> factors[], int length)
+    {
+        auto value_floats = reinterpret_cast<float*>(values);
+        auto factor_floats = reinterpret_cast<const float*>(factors);
+
+        auto i = 0;
+        for (; i + 4 <= length; i += 4)
+        {
+            auto value = _mm256_loadu_ps(value_floats + 2 * i);
+            auto factor = _mm256_loadu_ps(factor_floats + 2 * i);
+            auto factor_real = _mm256_moveldup_ps(factor);
+            auto factor_imag = _mm256_movehdup_ps(factor);
+            auto swapped_value = _mm256_permute_ps(value, _MM_SHUFFLE(2, 3, 0, 1));
+            _mm256_storeu_ps(value_floats + 2 * i, _mm256_addsub_ps(_mm256_mul_ps(value, factor_real), _mm256_mul_ps(swapped_value, factor_imag)));
+        }
+
+        for (; i < length; i++)
+        {
+            auto real = values[i].real() * factors[i].real() - values[i].imag() * factors[i].imag();
+            auto imag = values[i].real() * factors[i].imag() + values[i].imag() * factors[i].real();
+            values[i] = std::complex<float>(real, imag);
+        }
+    }
+
+    // 8 complex values are deinterleaved per step.
+    // The shuffle works within the 128-bit lanes, so the pairs of values are put back in order by a permutation.
+    KERNEL_TARGET static void extract_sign_bits(const float values[], int number_of_words, uint64_t real_bits[], uint64_t imag_bits[])
+    {
+        for (int word_index = 0; word_index < number_of_words; word_index++)
+        {
+            auto word_values = values + 2 * 64 * word_index;
+            auto real_word = uint64_t(0);
+            auto imag_word = uint64_t(0);
+            for (int i = 0; i < 64; i += 8)
+            {
+                auto low = _mm256_loadu_ps(word_values + 2 * i);
+                auto high = _mm256_loadu_ps(word_values + 2 * i + 8);
+                auto real = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+                auto imag = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+                real_word = real_word | (static_cast<uint64_t>(_mm256_movemask_ps(real)) << i);
+                imag_word = imag_word | (static_cast<uint64_t>(_mm256_movemask_ps(imag)) << i);
+            }
+            real_bits[word_index] = real_word;
+            imag_bits[word_index] = imag_word;
+        }
+    }
+
+    // 8 states are processed per step with the metrics gathered by the state indices, see the SSE4.2 kernel.
+    KERNEL_TARGET static void add_compare_select(
+        const int previous_metrics[],
+        int metrics[],
+        const uint8_t previous_states[],
+        const uint8_t previous_outputs[],
+        const int branch_metrics[],
+        int n_states)
+    {
+        auto unreachable = _mm256_set1_epi32(INT_MAX);
+        auto second_states = previous_states + n_states;
+        auto second_outputs = previous_outputs + n_states;
+
+        for (int state_index = 0; state_index < n_states; state_index += 8)
+        {
+            auto first_state_indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(previous_states + state_index)));
+            auto second_state_indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(second_states + state_index)));
+            auto first_output_indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(previous_outputs + state_index)));
+            auto second_output_indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(second_outputs + state_index)));
+
+            auto first_metrics = _mm256_i32gather_epi32(previous_metrics, first_state_indices, 4);
+            auto second_metrics = _mm256_i32gather_epi32(previous_metrics, second_state_indices, 4);
+            auto first_branch_metrics = _mm256_i32gather_epi32(branch_metrics, first_output_indices, 4);
+            auto second_branch_metrics = _mm256_i32gather_epi32(branch_metrics, second_output_indices, 4);
+
+            auto first_distances = _mm256_blendv_epi8(
+                _mm256_add_epi32(first_metrics, first_branch_metrics), unreachable, _mm256_cmpeq_epi32(first_metrics, unreachable));
+            auto second_distances = _mm256_blendv_epi8(
+                _mm256_add_epi32(second_metrics, second_branch_metrics), unreachable, _mm256_cmpeq_epi32(second_metrics, unreachable));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(metrics + state_index), _mm256_min_epi32(first_distances, second_distances));
+        }
+    }
+
+    // 32 codewords are processed per step, see the SSE4.2 kernel.
+    // The byte shuffle works within the 128-bit lanes, so the tables are broadcast to both lanes.
+    KERNEL_TARGET static void compute_syndromes(
+        const uint8_t interleaved[],
+        int depth,
+        int length,
+        const uint8_t multiplication_tables[],
+        int n_syndromes,
+        uint8_t syndromes[])
+    {
+        auto nibble_mask = _mm256_set1_epi8(0x0F);
+        auto narrow_nibble_mask = _mm_set1_epi8(0x0F);
+
+        auto j = 0;
+        for (; j + 32 <= depth; j += 32)
+        {
+            for (int i = 0; i < n_syndromes; i++)
+            {
+                auto low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(multiplication_tables + 32 * i)));
+                auto high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(multiplication_tables + 32 * i + 16)));
+                auto syndrome = _mm256_setzero_si256();
+                for (int k = 0; k < length; k++)
+                {
+                    auto low_product = _mm256_shuffle_epi8(low_table, _mm256_and_si256(syndrome, nibble_mask));
+                    auto high_product = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(syndrome, 4), nibble_mask));
+                    auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(interleaved + k * depth + j));
+                    syndrome = _mm256_xor_si256(_mm256_xor_si256(low_product, high_product), bytes);
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(syndromes + i * depth + j), syndrome);
+            }
+        }
+
+        // The depth of most superframes isn't a multiple of 32, so 16 codewords are processed by the 128-bit shuffle.
+        for (; j + 16 <= depth; j += 16)
+        {
+            for (int i = 0; i < n_syndromes; i++)
+            {
+                auto low_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(multiplication_tables + 32 * i));
+                auto high_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(multiplication_tables + 32 * i + 16));
+                auto syndrome = _mm_setzero_si128();
+                for (int k = 0; k < length; k++)
+                {
+                    auto low_product = _mm_shuffle_epi8(low_table, _mm_and_si128(syndrome, narrow_nibble_mask));
+                    auto high_product = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(syndrome, 4), narrow_nibble_mask));
+                    auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleaved + k * depth + j));
+                    syndrome = _mm_xor_si128(_mm_xor_si128(low_product, high_product), bytes);
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(syndromes + i * depth + j), syndrome);
+            }
+        }
+
+        for (; j < depth; j++)
+        {
+            for (int i = 0; i < n_syndromes; i++)
+            {
+                auto table = multiplication_tables + 32 * i;
+                auto syndrome = uint8_t(0);
+                for (int k = 0; k < length; k++)
+                {
+                    syndrome = table[syndrome & 0x0F] ^ table[16 + (syndrome >> 4)] ^ interleaved[k * depth + j];
+                }
+                syndromes[i * depth + j] = syndrome;
+            }
+        }
+    }
+
+    // 32 values are restored per step from 4 bytes of every plane, see the SSE4.2 kernel.
+    // The bytes are broadcast to both 128-bit lanes, so the upper lane spreads the bytes 2 and 3.
+    KERNEL_TARGET static void unpack_iq_blocks(const uint8_t widths[], const uint8_t planes[], int n_blocks, int n_dropped_bits, uint8_t output[])
+    {
+        auto spread = _mm256_setr_epi8(
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+        auto bit_mask = _mm256_set1_epi64x(static_cast<int64_t>(0x8040201008040201));
+        auto one = _mm256_set1_epi8(1);
+        auto half_mask = _mm256_set1_epi8(0x7F);
+        auto center = _mm256_set1_epi8(static_cast<char>(128 >> n_dropped_bits));
+        auto shift = _mm_cvtsi32_si128(n_dropped_bits);
+        auto shift_mask = _mm256_set1_epi8(static_cast<char>(0xFF << n_dropped_bits));
+        auto rounding = _mm256_set1_epi8(static_cast<char>(n_dropped_bits > 0 ? 1 << (n_dropped_bits - 1) : 0));
+
+        for (int block_index = 0; block_index < n_blocks; block_index++)
+        {
+            auto width = static_cast<int>(widths[block_index]);
+            for (int j = 0; j < 64; j += 32)
+            {
+                auto zigzag = _mm256_setzero_si256();
+                for (int p = width - 1; p >= 0; p--)
+                {
+                    int32_t plane_bytes;
+                    std::memcpy(&plane_bytes, planes + 8 * p + j / 8, sizeof(plane_bytes));
+                    auto bytes = _mm256_shuffle_epi8(_mm256_set1_epi32(plane_bytes), spread);
+                    auto bits = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bit_mask), bit_mask);
+                    zigzag = _mm256_sub_epi8(_mm256_add_epi8(zigzag, zigzag), bits);
+                }
+
+                auto difference = _mm256_xor_si256(_mm256_and_si256(_mm256_srli_epi16(zigzag, 1), half_mask), _mm256_cmpeq_epi8(_mm256_and_si256(zigzag, one), one));
+                auto values = _mm256_and_si256(_mm256_sll_epi16(_mm256_add_epi8(difference, center), shift), shift_mask);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + j), _mm256_or_si256(values, rounding));
+            }
+            planes = planes + 8 * width;
+            output = output + 64;
+        }
+    }
+
+#if defined(__x86_64__) || defined(_M_X64)
+    // PDEP is part of BMI2 which is checked separately since it doesn't belong to the instruction set levels.
+    // Every known CPU with AVX2 has it, but it is microcoded and slow on AMD CPUs before Zen 3.
+#if defined(__GNUC__)
+    __attribute__((target("bmi2")))
+#endif
+    static uint64_t deposit_bits(uint64_t source, uint64_t mask)
+    {
+        return _pdep_u64(source, mask);
+    }
+#endif
+
+    void bind_avx2_kernels(KernelTable& kernel_table)
+    {
+        kernel_table.convert_cu8_samples = convert_cu8_samples;
+        kernel_table.multiply_complex = multiply_complex;
+        kernel_table.extract_sign_bits = extract_sign_bits;
+
+        // The number of states must be a multiple of 8.
+        kernel_table.add_compare_select = add_compare_select;
+        kernel_table.compute_syndromes = compute_syndromes;
+        kernel_table.unpack_iq_blocks = unpack_iq_blocks;
+
+#if defined(__x86_64__) || defined(_M_X64)
+        if (CpuFeatures::has_bmi2())
+        {
+            kernel_table.deposit_bits = deposit_bits;
+        }
+#endif
+    }
+}
+#else
+namespace Kernels
+{
+    // There are no AVX2 kernels on other architectures.
+    void bind_avx2_kernels(KernelTable& kernel_table)
+    {
+
+    }
+}
+#endif
@@ -0,0 +1,234 @@
+#include "Kernels.h"
+
+#include <climits>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+
+// The kernels are compiled for SSE4.2 regardless of the compiler flags
+// because they are only called if the CPU supports it.
+#if defined(__GNUC__)
+#define KERNEL_TARGET __attribute__((target("sse4.2")))
+#else
+#define KERNEL_TARGET
+#endif
+
+namespace Kernels
+{
+    // 4 samples are converted per step.
+    KERNEL_TARGET static void convert_cu8_samples(const uint8_t input[], std::complex<float> output[], int length)
+    {
+        auto offset = _mm_set1_ps(128.0f);
+        auto scale = _mm_set1_ps(1.0f / 128.0f);
+        auto floats = reinterpret_cast<float*>(output);
+
+        auto i = 0;
+        for (; i + 4 <= length; i += 4)
+        {
+            auto bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + 2 * i));
+            auto low = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes));
+            auto high = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)));
+
+            // Dividing by 128 is exact as multiplication by its reciprocal.
+            _mm_storeu_ps(floats + 2 * i, _mm_mul_ps(_mm_sub_ps(low, offset), scale));
+            _mm_storeu_ps(floats + 2 * i + 4, _mm_mul_ps(_mm_sub_ps(high, offset), scale));
+        }
+
+        for (; i < length; i++)
+        {
+            output[i] = std::complex<float>((input[2 * i] - 128.0f) / 128.0f, (input[2 * i + 1] - 128.0f) / 128.0f);
+        }
+    }
+
+    // 2 values are multiplied per step.
+    // addsub subtracts the products of the imaginary parts in the real lanes and adds the mixed products in the imaginary lanes.
+    KERNEL_TARGET static void multiply_complex(std::complex<float> values[], const std::complex<float> factors[], int length)
+    {
+        auto value_floats = reinterpret_cast<float*>(values);
+        auto factor_floats = reinterpret_cast<const float*>(factors);
+
+        auto i = 0;
+        for (; i + 2 <= length; i += 2)
+        {
+            auto value = _mm_loadu_ps(value_floats + 2 * i);
+            auto factor = _mm_loadu_ps(factor_floats + 2 * i);
+            auto factor_real = _mm_moveldup_ps(factor);
+            auto factor_imag = _mm_movehdup_ps(factor);
+            auto swapped_value = _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+            _mm_storeu_ps(value_floats + 2 * i, _mm_addsub_ps(_mm_mul_ps(value, factor_real), _mm_mul_ps(swapped_value, factor_imag)));
+        }
+
+        for (; i < length; i++)
+        {
+            auto real = values[i].real() * factors[i].real() - values[i].imag() * factors[i].imag();
+            auto imag = values[i].real() * factors[i].imag() + values[i].imag() * factors[i].real();
+            values[i] = std::complex<float>(real, imag);
+        }
+    }
+
+    // 4 complex values are deinterleaved per step.
+    KERNEL_TARGET static void extract_sign_bits(const float values[], int number_of_words, uint64_t real_bits[], uint64_t imag_bits[])
+    {
+        for (int word_index = 0; word_index < number_of_words; word_index++)
+        {
+            auto word_values = values + 2 * 64 * word_index;
+            auto real_word = uint64_t(0);
+            auto imag_word = uint64_t(0);
+            for (int i = 0; i < 64; i += 4)
+            {
+                auto low = _mm_loadu_ps(word_values + 2 * i);
+                auto high = _mm_loadu_ps(word_values + 2 * i + 4);
+                auto real = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+                auto imag = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+                real_word = real_word | (static_cast<uint64_t>(_mm_movemask_ps(real)) << i);
+                imag_word = imag_word | (static_cast<uint64_t>(_mm_movemask_ps(imag)) << i);
+            }
+            real_bits[word_index] = real_word;
+            imag_bits[word_index] = imag_word;
+        }
+    }
+
+    // 4 states are processed per step.
+    // The sum of an unreachable previous state is replaced by INT_MAX instead of overflowing.
+    KERNEL_TARGET static void add_compare_select(
+        const int previous_metrics[],
+        int metrics[],
+        const uint8_t previous_states[],
+        const uint8_t previous_outputs[],
+        const int branch_metrics[],
+        int n_states)
+    {
+        auto unreachable = _mm_set1_epi32(INT_MAX);
+        auto second_states = previous_states + n_states;
+        auto second_outputs = previous_outputs + n_states;
+
+        for (int state_index = 0; state_index < n_states; state_index += 4)
+        {
+            auto first_metrics = _mm_setr_epi32(
+                previous_metrics[previous_states[state_index]], previous_metrics[previous_states[state_index + 1]],
+                previous_metrics[previous_states[state_index + 2]], previous_metrics[previous_states[state_index + 3]]);
+            auto second_metrics = _mm_setr_epi32(
+                previous_metrics[second_states[state_index]], previous_metrics[second_states[state_index + 1]],
+                previous_metrics[second_states[state_index + 2]], previous_metrics[second_states[state_index + 3]]);
+            auto first_branch_metrics = _mm_setr_epi32(
+                branch_metrics[previous_outputs[state_index]], branch_metrics[previous_outputs[state_index + 1]],
+                branch_metrics[previous_outputs[state_index + 2]], branch_metrics[previous_outputs[state_index + 3]]);
+            auto second_branch_metrics = _mm_setr_epi32(
+                branch_metrics[second_outputs[state_index]], branch_metrics[second_outputs[state_index + 1]],
+                branch_metrics[second_outputs[state_index + 2]], branch_metrics[second_outputs[state_index + 3]]);
+
+            auto first_distances = _mm_blendv_epi8(
+                _mm_add_epi32(first_metrics, first_branch_metrics), unreachable, _mm_cmpeq_epi32(first_metrics, unreachable));
+            auto second_distances = _mm_blendv_epi8(
+                _mm_add_epi32(second_metrics, second_branch_metrics), unreachable, _mm_cmpeq_epi32(second_metrics, unreachable));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(metrics + state_index), _mm_min_epi32(first_distances, second_distances));
+        }
+    }
+
+    // 16 codewords are processed per step with each byte lane holding the syndrome of one codeword.
+    // The table lookups of both nibbles are done by byte shuffles, which are part of SSSE3.
+    KERNEL_TARGET static void compute_syndromes(
+        const uint8_t interleaved[],
+        int depth,
+        int length,
+        const uint8_t multiplication_tables[],
+        int n_syndromes,
+        uint8_t syndromes[])
+    {
+        auto nibble_mask = _mm_set1_epi8(0x0F);
+
+        auto j = 0;
+        for (; j + 16 <= depth; j += 16)
+        {
+            for (int i = 0; i < n_syndromes; i++)
+            {
+                auto low_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(multiplication_tables + 32 * i));
+                auto high_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(multiplication_tables + 32 * i + 16));
+                auto syndrome = _mm_setzero_si128();
+                for (int k = 0; k < length; k++)
+                {
+                    auto low_product = _mm_shuffle_epi8(low_table, _mm_and_si128(syndrome, nibble_mask));
+                    auto high_product = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(syndrome, 4), nibble_mask));
+                    auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(interleaved + k * depth + j));
+                    syndrome = _mm_xor_si128(_mm_xor_si128(low_product, high_product), bytes);
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(syndromes + i * depth + j), syndrome);
+            }
+        }
+
+        for (; j < depth; j++)
+        {
+            for (int i = 0; i < n_syndromes; i++)
+            {
+                auto table = multiplication_tables + 32 * i;
+                auto syndrome = uint8_t(0);
+                for (int k = 0; k < length; k++)
+                {
+                    syndrome = table[syndrome & 0x0F] ^ table[16 + (syndrome >> 4)] ^ interleaved[k * depth + j];
+                }
+                syndromes[i * depth + j] = syndrome;
+            }
+        }
+    }
+
+    // 16 values are restored per step from 2 bytes of every plane.
+    // The bytes are spread over 8 lanes each whose bit is tested, and the planes are added from the most significant one
+    // by doubling the values and subtracting the test result of -1.
+    KERNEL_TARGET static void unpack_iq_blocks(const uint8_t widths[], const uint8_t planes[], int n_blocks, int n_dropped_bits, uint8_t output[])
+    {
+        auto spread = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+        auto bit_mask = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        auto one = _mm_set1_epi8(1);
+        auto half_mask = _mm_set1_epi8(0x7F);
+        auto center = _mm_set1_epi8(static_cast<char>(128 >> n_dropped_bits));
+        auto shift = _mm_cvtsi32_si128(n_dropped_bits);
+        auto shift_mask = _mm_set1_epi8(static_cast<char>(0xFF << n_dropped_bits));
+        auto rounding = _mm_set1_epi8(static_cast<char>(n_dropped_bits > 0 ? 1 << (n_dropped_bits - 1) : 0));
+
+        for (int block_index = 0; block_index < n_blocks; block_index++)
+        {
+            auto width = static_cast<int>(widths[block_index]);
+            for (int j = 0; j < 64; j += 16)
+            {
+                auto zigzag = _mm_setzero_si128();
+                for (int p = width - 1; p >= 0; p--)
+                {
+                    uint16_t plane_bytes;
+                    std::memcpy(&plane_bytes, planes + 8 * p + j / 8, sizeof(plane_bytes));
+                    auto bytes = _mm_shuffle_epi8(_mm_cvtsi32_si128(plane_bytes), spread);
+                    auto bits = _mm_cmpeq_epi8(_mm_and_si128(bytes, bit_mask), bit_mask);
+                    zigzag = _mm_sub_epi8(_mm_add_epi8(zigzag, zigzag), bits);
+                }
+
+                auto difference = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(zigzag, 1), half_mask), _mm_cmpeq_epi8(_mm_and_si128(zigzag, one), one));
+                auto values = _mm_and_si128(_mm_sll_epi16(_mm_add_epi8(difference, center), shift), shift_mask);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + j), _mm_or_si128(values, rounding));
+            }
+            planes = planes + 8 * width;
+            output = output + 64;
+        }
+    }
+
+    void bind_sse4_2_kernels(KernelTable& kernel_table)
+    {
+        kernel_table.convert_cu8_samples = convert_cu8_samples;
+        kernel_table.multiply_complex = multiply_complex;
+        kernel_table.extract_sign_bits = extract_sign_bits;
+
+        // The number of states must be a multiple of 4.
+        kernel_table.add_compare_select = add_compare_select;
+        kernel_table.compute_syndromes = compute_syndromes;
+        kernel_table.unpack_iq_blocks = unpack_iq_blocks;
+    }
+}
+#else
+namespace Kernels
+{
+    // There are no SSE4.2 kernels on other architectures.
+    void bind_sse4_2_kernels(KernelTable& kernel_table)
+    {
+
+    }
+}
+#endif
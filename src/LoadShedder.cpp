@@ -0,0 +1,98 @@
+#include "LoadShedder.h"
+
+#include "fmt/format.h"
+
+#include <cmath>
+#include <thread>
+
+LoadShedder::LoadShedder(double frame_duration, double speed) :
+    m_frame_period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frame_duration / speed))),
+    m_is_started(false),
+    m_start_time(),
+    m_is_msc_shed(false),
+    m_number_of_relaxed_frames(0),
+    m_number_of_frames(0),
+    m_number_of_late_frames(0),
+    m_number_of_msc_shed_frames(0),
+    m_number_of_dropped_frames(0),
+    m_maximum_lateness(Clock::duration::zero())
+{
+
+}
+
+void LoadShedder::wait_for_arrival(int frame_number)
+{
+    if (!m_is_started)
+    {
+        return;
+    }
+
+    std::this_thread::sleep_until(m_start_time + (frame_number + 1) * m_frame_period);
+}
+
+bool LoadShedder::is_msc_shed() const
+{
+    return m_is_msc_shed;
+}
+
+// A late frame sheds the MSC at once, while it is only resumed after several relaxed frames
+// so that the load doesn't oscillate.
+// The schedule begins once the first frame is done because its acquisition of the signal isn't done in real time.
+int LoadShedder::finish_frame(int frame_number)
+{
+    if (!m_is_started)
+    {
+        m_is_started = true;
+        m_start_time = Clock::now() - (frame_number + 2) * m_frame_period;
+        return 0;
+    }
+
+    m_number_of_frames++;
+    if (m_is_msc_shed)
+    {
+        m_number_of_msc_shed_frames++;
+    }
+
+    auto deadline = m_start_time + (frame_number + 2) * m_frame_period;
+    auto lateness = Clock::now() - deadline;
+    m_maximum_lateness = std::max(m_maximum_lateness, lateness);
+
+    if (lateness <= -std::chrono::duration_cast<Clock::duration>(RECOVERY_SLACK * m_frame_period))
+    {
+        m_number_of_relaxed_frames++;
+        if (m_number_of_relaxed_frames >= N_RECOVERY_FRAMES)
+        {
+            m_is_msc_shed = false;
+        }
+    }
+    else
+    {
+        m_number_of_relaxed_frames = 0;
+    }
+
+    if (lateness <= Clock::duration::zero())
+    {
+        return 0;
+    }
+
+    m_number_of_late_frames++;
+    m_is_msc_shed = true;
+
+    auto lateness_in_frames = std::chrono::duration<double>(lateness) / std::chrono::duration<double>(m_frame_period);
+    if (lateness_in_frames <= MAX_LATENESS)
+    {
+        return 0;
+    }
+
+    // The frames which have arrived in the meantime are dropped, so that the next frame is due one frame duration from now.
+    auto number_of_dropped_frames = static_cast<int>(std::ceil(lateness_in_frames));
+    m_number_of_dropped_frames = m_number_of_dropped_frames + number_of_dropped_frames;
+    return number_of_dropped_frames;
+}
+
+void LoadShedder::print_statistics() const
+{
+    fmt::println("{} of {} frames missed their deadline by up to {:.1f} ms.",
+        m_number_of_late_frames, m_number_of_frames, std::chrono::duration<double, std::milli>(m_maximum_lateness).count());
+    fmt::println("The MSC demodulation was shed in {} frames and {} frames were dropped.", m_number_of_msc_shed_frames, m_number_of_dropped_frames);
+}
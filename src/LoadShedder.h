@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+
+// Tracks every frame against its deadline in real time and sheds work under overload.
+// The samples of a frame arrive one frame duration after the ones of the frame before
+// and the frame must be done before the next one has arrived.
+// The work is shed in this order:
+// 1. The demodulation of the MSC symbols, which no subchannel decoder needs yet.
+// 2. Whole frames including their FIC, but only if the receiver is so far behind that it must resynchronize.
+// The FIC of the processed frames is never shed.
+class LoadShedder final
+{
+public:
+    // The speed is the number of frame durations per real frame duration at which the samples arrive,
+    // e.g. 1 for a live stream or more to find the load at which a CPU sheds work.
+    LoadShedder(double frame_duration, double speed);
+
+    // Waits until the samples of the frame have arrived if they are read faster than in real time, e.g. from a file.
+    void wait_for_arrival(int frame_number);
+
+    // Returns whether the demodulation of the MSC symbols is shed.
+    bool is_msc_shed() const;
+
+    // Is called once the frame is done.
+    // Returns the number of following frames which are dropped to catch up with real time.
+    int finish_frame(int frame_number);
+
+    void print_statistics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // The lateness in frame durations beyond which frames are dropped instead of building a backlog.
+    static constexpr double MAX_LATENESS = 2.0;
+
+    // The fraction of the frame duration which must be left before the deadline so that a frame counts as relaxed.
+    static constexpr double RECOVERY_SLACK = 0.5;
+
+    // The number of consecutive relaxed frames after which the shed work is resumed.
+    static constexpr int N_RECOVERY_FRAMES = 8;
+
+    Clock::duration m_frame_period;
+
+    // The arrival time of the frame 0 which is set once the first frame is done.
+    bool m_is_started;
+    Clock::time_point m_start_time;
+
+    bool m_is_msc_shed;
+    int m_number_of_relaxed_frames;
+
+    int m_number_of_frames;
+    int m_number_of_late_frames;
+    int m_number_of_msc_shed_frames;
+    int m_number_of_dropped_frames;
+    Clock::duration m_maximum_lateness;
+};
\ No newline at end of file
@@ -4,83 +4,937 @@
 #include "TimeSynchronizer.h"
 #include "OfdmDemodulator.h"
 #include "FicHandler.h"
+#include "TransmissionModeDetection.h"
+#include "AllocationCounter.h"
+#include "Tracing.h"
+#include "PerfCounters.h"
 
 #include "fmt/printf.h"
 
-MainController::MainController() :
-    m_signal_buffer(DabConstants::T_F_FFT),
-    m_frame_buffer(DabConstants::T_F_U),
-    m_hard_bits(DabConstants::N_DATA_SYMBOLS, DabConstants::N_RAW_FIC_SYMBOL_BITS)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <new>
+
+using namespace DabConstants;
+
+MainController::MainController(const ReceiverOptions& options, FicBlockCallback fic_block_callback) :
+    m_options(options),
+    m_fic_block_callback(std::move(fic_block_callback)),
+    m_resampler(nullptr),
+    m_allocation_counter(std::make_unique<AllocationCounter::Counter>()),
+    m_task_scheduler(std::make_unique<TaskScheduler>(options.number_of_threads, m_allocation_counter.get())),
+    m_arena(nullptr),
+    m_signal_buffer(nullptr, 0),
+    m_frame_buffer(nullptr, 0),
+    m_hard_bits(nullptr, 0, 0),
+    m_number_of_buffered_samples(0),
+    m_number_of_steady_state_allocations(0),
+    m_checkpoint_writer(nullptr),
+    m_publisher(nullptr)
+{
+
+}
+
+bool MainController::run(const std::string& file_path)
+{
+    auto transmission_mode_id = m_options.transmission_mode_id;
+    if (!transmission_mode_id.has_value())
+    {
+        transmission_mode_id = detect_transmission_mode(file_path);
+        if (!transmission_mode_id.has_value())
+        {
+            fmt::println("The transmission mode couldn't be detected.");
+            return false;
+        }
+    }
+
+    fmt::println("Using the transmission mode {}.", get_transmission_mode_name(transmission_mode_id.value()));
+    if (!open_checkpoint_writer(transmission_mode_id.value()) || !open_publisher())
+    {
+        return false;
+    }
+
+    switch (transmission_mode_id.value())
+    {
+    case TransmissionModeId::I:
+        run<TransmissionModeI>(file_path);
+        break;
+    case TransmissionModeId::II:
+        run<TransmissionModeII>(file_path);
+        break;
+    case TransmissionModeId::III:
+        run<TransmissionModeIII>(file_path);
+        break;
+    case TransmissionModeId::IV:
+        run<TransmissionModeIV>(file_path);
+        break;
+    }
+
+    auto is_recorded = close_checkpoint_writer();
+    close_publisher();
+    return check_run_allocations() && is_recorded;
+}
+
+bool MainController::run(SampleSource& sample_source, Resampler* resampler)
+{
+    m_resampler = resampler;
+
+    auto transmission_mode_id = m_options.transmission_mode_id.value_or(TransmissionModeId::I);
+    fmt::println("Using the transmission mode {}.", get_transmission_mode_name(transmission_mode_id));
+    if (!open_checkpoint_writer(transmission_mode_id) || !open_publisher())
+    {
+        return false;
+    }
+
+    switch (transmission_mode_id)
+    {
+    case TransmissionModeId::I:
+        run_stream<TransmissionModeI>(sample_source);
+        break;
+    case TransmissionModeId::II:
+        run_stream<TransmissionModeII>(sample_source);
+        break;
+    case TransmissionModeId::III:
+        run_stream<TransmissionModeIII>(sample_source);
+        break;
+    case TransmissionModeId::IV:
+        run_stream<TransmissionModeIV>(sample_source);
+        break;
+    }
+
+    auto is_recorded = close_checkpoint_writer();
+    close_publisher();
+    return check_run_allocations() && is_recorded;
+}
+
+bool MainController::replay(const std::string& checkpoint_file_path)
+{
+    auto checkpoint_reader{ CheckpointReader(checkpoint_file_path) };
+    if (!checkpoint_reader.is_valid())
+    {
+        fmt::println("{} isn't a checkpoint of this version of the receiver.", checkpoint_file_path);
+        return false;
+    }
+
+    fmt::println("Replaying the stage {} of the transmission mode {}.", get_checkpoint_stage_name(checkpoint_reader.get_stage()), get_transmission_mode_name(checkpoint_reader.get_transmission_mode_id()));
+    switch (checkpoint_reader.get_transmission_mode_id())
+    {
+    case TransmissionModeId::I:
+        replay<TransmissionModeI>(checkpoint_reader);
+        break;
+    case TransmissionModeId::II:
+        replay<TransmissionModeII>(checkpoint_reader);
+        break;
+    case TransmissionModeId::III:
+        replay<TransmissionModeIII>(checkpoint_reader);
+        break;
+    case TransmissionModeId::IV:
+        replay<TransmissionModeIV>(checkpoint_reader);
+        break;
+    }
+
+    return check_run_allocations();
+}
+
+bool MainController::open_checkpoint_writer(TransmissionModeId transmission_mode_id)
+{
+    if (!m_options.checkpoint_file_path.has_value())
+    {
+        return true;
+    }
+
+    m_checkpoint_writer = std::make_unique<CheckpointWriter>(m_options.checkpoint_file_path.value(), transmission_mode_id, m_options.checkpoint_stage);
+    if (!m_checkpoint_writer->is_open())
+    {
+        fmt::println("The checkpoint {} couldn't be opened.", m_options.checkpoint_file_path.value());
+        return false;
+    }
+
+    return true;
+}
+
+bool MainController::close_checkpoint_writer()
+{
+    if (m_checkpoint_writer == nullptr)
+    {
+        return true;
+    }
+
+    auto is_written = m_checkpoint_writer->close();
+    if (is_written)
+    {
+        fmt::println("{} frames at the stage {} recorded to {}.", m_checkpoint_writer->get_number_of_records(), get_checkpoint_stage_name(m_checkpoint_writer->get_stage()), m_options.checkpoint_file_path.value());
+    }
+    else
+    {
+        fmt::println("The checkpoint {} couldn't be written.", m_options.checkpoint_file_path.value());
+    }
+
+    m_checkpoint_writer = nullptr;
+    return is_written;
+}
+
+bool MainController::open_publisher()
+{
+    if (!m_options.shared_memory_name.has_value())
+    {
+        return true;
+    }
+
+    m_publisher = std::make_unique<SharedMemoryPublisher>(m_options.shared_memory_name.value(), SharedMemoryPublisher::DEFAULT_NUMBER_OF_SLOTS);
+    if (!m_publisher->is_open())
+    {
+        fmt::println("The shared memory {} couldn't be created.", m_options.shared_memory_name.value());
+        m_publisher = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void MainController::close_publisher()
+{
+    if (m_publisher == nullptr)
+    {
+        return;
+    }
+
+    fmt::println("{} entries published to the shared memory {}.", m_publisher->get_number_of_entries(), m_options.shared_memory_name.value());
+    m_publisher = nullptr;
+}
+
+// The detection uses as many samples as the time synchronizer of the transmission mode I
+// because this is enough to comprise at least one DAB frame of every transmission mode.
+std::optional<TransmissionModeId> MainController::detect_transmission_mode(const std::string& file_path)
+{
+    auto sample_source = create_sample_source(file_path);
+    auto signal_buffer{ Eigen::VectorXcf(TransmissionModeI::T_F_FFT) };
+
+    sample_source->read(signal_buffer, 0, signal_buffer.size() - 1);
+    if (sample_source->get_file_end_reached())
+    {
+        return std::nullopt;
+    }
+
+    return TransmissionModeDetection::detect(signal_buffer);
+}
+
+std::unique_ptr<SampleSource> MainController::create_sample_source(const std::string& file_path)
+{
+    m_resampler = nullptr;
+
+    auto file_sample_source = open_sample_file(file_path, m_options.sample_format);
+    if (m_options.sample_rate == SAMPLE_RATE)
+    {
+        return file_sample_source;
+    }
+
+    auto resampler = std::make_unique<Resampler>(std::move(file_sample_source), m_options.sample_rate, SAMPLE_RATE);
+    m_resampler = resampler.get();
+    return resampler;
+}
+
+static int64_t get_file_size(const std::string& file_path)
 {
+    auto error_code{ std::error_code() };
+    auto file_size = std::filesystem::file_size(file_path, error_code);
+    return error_code ? -1 : static_cast<int64_t>(file_size);
+}
+
+// Eigen::Map has no way to change its data pointer, so the maps are constructed again in place.
+template <typename Mode>
+void MainController::initialize_buffers()
+{
+    // Each buffer may need additional bytes for the alignment.
+    constexpr size_t ALIGNMENT_RESERVE = 64;
+    constexpr int N_RAW_FIC_SYMBOL_WORDS = PackedBits::get_number_of_words(Mode::N_RAW_FIC_SYMBOL_BITS);
+    constexpr size_t CAPACITY =
+        sizeof(std::complex<float>) * (Mode::T_F_FFT + Mode::T_F_U) +
+        sizeof(uint64_t) * Mode::N_DATA_SYMBOLS * N_RAW_FIC_SYMBOL_WORDS +
+        3 * ALIGNMENT_RESERVE;
 
+    m_arena = std::make_unique<Arena>(CAPACITY, m_options.use_huge_pages);
+    new (&m_signal_buffer) Eigen::Map<Eigen::VectorXcf>(m_arena->allocate<std::complex<float>>(Mode::T_F_FFT), Mode::T_F_FFT);
+    new (&m_frame_buffer) Eigen::Map<Eigen::VectorXcf>(m_arena->allocate<std::complex<float>>(Mode::T_F_U), Mode::T_F_U);
+    new (&m_hard_bits) Eigen::Map<PackedBits::Matrix>(
+        m_arena->allocate<uint64_t>(Mode::N_DATA_SYMBOLS * N_RAW_FIC_SYMBOL_WORDS),
+        Mode::N_DATA_SYMBOLS,
+        N_RAW_FIC_SYMBOL_WORDS);
+
+    if (m_options.use_huge_pages && m_arena->get_transparent_huge_pages_requested())
+    {
+        fmt::println("Huge pages aren't reserved. The buffers request transparent huge pages instead.");
+    }
+    else if (m_options.use_huge_pages && !m_arena->get_huge_pages_used())
+    {
+        fmt::println("Huge pages aren't available. The buffers use normal pages.");
+    }
 }
 
+template <typename Mode>
 void MainController::run(const std::string& file_path)
 {
-    auto raw_file_handler{ RawFileHandler(file_path) };
-    auto time_synchronizer = TimeSynchronizer::create();
-    auto ofdm_demodulator{ OfdmDemodulator() };
-    auto fic_handler = FicHandler::create();
+    initialize_buffers<Mode>();
+
+    auto metadata{ CaptureMetadata{ Mode::ID, m_options.sample_rate, m_options.sample_format, get_file_size(file_path) } };
+    // Frames which are dropped in real time would be missing in the frame index.
+    auto use_frame_index = m_options.use_frame_index && !m_options.real_time_speed.has_value();
+    auto frame_index{ std::optional<FrameIndex>() };
+    if (use_frame_index)
+    {
+        frame_index = FrameIndex::load(file_path, metadata);
+    }
+
+    if (m_options.number_of_chunks.has_value())
+    {
+        if (!frame_index.has_value())
+        {
+            fmt::println("There is no frame index yet. Run the receiver once over the whole file to write it.");
+            return;
+        }
+
+        print_chunks(frame_index.value());
+        return;
+    }
+
+    if (frame_index.has_value())
+    {
+        fmt::println("Using the frame index {}.", FrameIndex::get_index_file_path(file_path));
+        run_indexed<Mode>(file_path, frame_index.value());
+        return;
+    }
+
+    // The entries are reserved so that the frame index doesn't grow in the frame loop.
+    auto new_frame_index{ FrameIndex(metadata) };
+    // The number of samples of an IQ archive without trailer is unknown, so its frame index may grow.
+    auto number_of_file_samples = std::max<int64_t>(get_number_of_file_samples(file_path, m_options.sample_format), 0);
+    auto number_of_samples = static_cast<double>(number_of_file_samples) * SAMPLE_RATE / metadata.sample_rate;
+    new_frame_index.reserve(static_cast<int>(number_of_samples / Mode::T_F) + 2);
+
+    auto sample_source = create_sample_source(file_path);
+    run_synchronized<Mode>(*sample_source, &new_frame_index);
+
+    if (use_frame_index)
+    {
+        if (new_frame_index.save(file_path))
+        {
+            fmt::println("Frame index of {} frames written to {}.", new_frame_index.get_entries().size(), FrameIndex::get_index_file_path(file_path));
+        }
+        else
+        {
+            fmt::println("Frame index couldn't be written to {}.", FrameIndex::get_index_file_path(file_path));
+        }
+    }
+}
+
+template <typename Mode>
+void MainController::run_stream(SampleSource& sample_source)
+{
+    initialize_buffers<Mode>();
+    run_synchronized<Mode>(sample_source, nullptr);
+}
+
+template <typename Mode>
+void MainController::run_synchronized(SampleSource& sample_source, FrameIndex* frame_index)
+{
+    auto allocation_counter{ AllocationCounter::ScopedThreadCounter(m_allocation_counter.get()) };
+    auto time_synchronizer = TimeSynchronizer<Mode>::create();
+    auto ofdm_demodulator{ OfdmDemodulator<Mode>(*m_task_scheduler) };
+    auto fic_handler = create_fic_handler<Mode>();
+    auto fic_sampler{ create_fic_sampler<Mode>() };
+    auto load_shedder = create_load_shedder<Mode>();
 
-    raw_file_handler.read(m_signal_buffer, 0, m_signal_buffer.size() - 1);
-    if (raw_file_handler.get_file_end_reached())
+    m_number_of_buffered_samples = 0;
+    fill_signal_buffer(sample_source, static_cast<int>(m_signal_buffer.size()));
+    if (sample_source.get_file_end_reached())
     {
         fmt::println("File doesn't contain enough data.");
         return;
     }
 
-    auto global_prs_start_index = -DabConstants::T_F_U;
+    auto frame_number = 0;
+    auto global_prs_start_index = int64_t(-Mode::T_F_U);
+
+    // The start of the PRS symbol of the frame before in samples including the fraction of the timing offset.
+    auto previous_prs_start_time = 0.0;
+    auto has_previous_prs_start_time = false;
+    auto predicted_prs_start_index = std::optional<int>();
     while (true)
     {
-        auto prs_start_index = time_synchronizer.get_prs_start_index(m_signal_buffer);
-        global_prs_start_index = global_prs_start_index + DabConstants::T_F_U + prs_start_index;
+        if (load_shedder.has_value())
+        {
+            load_shedder->wait_for_arrival(frame_number);
+        }
+
+        auto span{ Tracing::ScopedSpan("MainController::frame") };
+        auto number_of_allocations = AllocationCounter::get_number_of_allocations(*m_allocation_counter);
+
+        // With --low-latency, the PRS symbol is searched only around the prediction first,
+        // so that the stream is read just up to the PRS symbol and the frame is demodulated while it arrives.
+        // Only if this fails, the signal buffer is filled up for the search over a whole frame.
+        auto tracked_prs_start_index = std::optional<int>();
+        if (m_options.stream_symbols && predicted_prs_start_index.has_value())
+        {
+            fill_signal_buffer(sample_source, TimeSynchronizer<Mode>::get_tracking_length(predicted_prs_start_index.value()));
+            if (sample_source.get_file_end_reached())
+            {
+                break;
+            }
+            tracked_prs_start_index = time_synchronizer.track_prs_start_index(m_signal_buffer.head(m_number_of_buffered_samples), ofdm_demodulator.get_coarse_frequency_offset(), predicted_prs_start_index.value());
+        }
+
+        if (!tracked_prs_start_index.has_value())
+        {
+            fill_signal_buffer(sample_source, static_cast<int>(m_signal_buffer.size()));
+            if (sample_source.get_file_end_reached())
+            {
+                break;
+            }
+        }
+
+        auto prs_start_index = tracked_prs_start_index.has_value() ? tracked_prs_start_index.value() : time_synchronizer.get_prs_start_index(m_signal_buffer, ofdm_demodulator.get_coarse_frequency_offset(), predicted_prs_start_index);
+        global_prs_start_index = global_prs_start_index + Mode::T_F_U + prs_start_index;
         fmt::println("PRS start index found at sample {}.", global_prs_start_index);
 
-        update_frame_buffer(raw_file_handler, prs_start_index);
-        if (raw_file_handler.get_file_end_reached())
+        // The OFDM demodulator also processes the frames which aren't selected
+        // because it tracks the coarse frequency offset for the frame index.
+        auto is_msc_shed = load_shedder.has_value() && load_shedder->is_msc_shed();
+        if (m_options.stream_symbols)
+        {
+            stream_frame<Mode>(sample_source, prs_start_index, ofdm_demodulator, fic_handler, fic_sampler, frame_number, is_frame_selected(frame_number), is_msc_shed);
+            if (sample_source.get_file_end_reached())
+            {
+                break;
+            }
+        }
+        else
+        {
+            update_frame_buffer(sample_source, prs_start_index, 0, static_cast<int>(m_frame_buffer.size()) - 1);
+            if (sample_source.get_file_end_reached())
+            {
+                break;
+            }
+        }
+
+        update_signal_buffer<Mode>(sample_source, prs_start_index);
+        if (sample_source.get_file_end_reached())
         {
             break;
         }
 
-        update_signal_buffer(raw_file_handler, prs_start_index);
-        if (raw_file_handler.get_file_end_reached())
+        if (!m_options.stream_symbols)
+        {
+            process_frame<Mode>(ofdm_demodulator, fic_handler, fic_sampler, frame_number, is_frame_selected(frame_number), is_msc_shed);
+        }
+
+        // The timing offset is only known once the PRS symbol is demodulated.
+        auto prs_start_time = static_cast<double>(global_prs_start_index) - ofdm_demodulator.get_timing_offset();
+        if (has_previous_prs_start_time)
+        {
+            update_sample_clock_offset<Mode>(prs_start_time - previous_prs_start_time, ofdm_demodulator);
+        }
+        previous_prs_start_time = prs_start_time;
+        has_previous_prs_start_time = true;
+
+        // The signal buffer starts at the end of the frame, so the next PRS symbol is expected after the Null symbol
+        // plus the drift by the sample clock offset which isn't compensated by a resampler.
+        predicted_prs_start_index = Mode::T_NULL + static_cast<int>(std::lround(Mode::T_F * ofdm_demodulator.get_sample_clock_offset()));
+
+        if (frame_index != nullptr)
+        {
+            auto sample_clock_offset = m_resampler != nullptr ? m_resampler->get_sample_clock_offset() : ofdm_demodulator.get_sample_clock_offset();
+            auto input_prs_start_position = m_resampler != nullptr ? m_resampler->get_input_position(global_prs_start_index) : ResamplerPosition{ global_prs_start_index, 0 };
+            frame_index->add(FrameIndexEntry{ global_prs_start_index, ofdm_demodulator.get_coarse_frequency_offset().value_or(0), ofdm_demodulator.get_fine_frequency_offset(), sample_clock_offset, input_prs_start_position });
+        }
+
+        check_allocations(frame_number, AllocationCounter::get_number_of_allocations(*m_allocation_counter) - number_of_allocations);
+        update_perf_counters(frame_number, Mode::T_F);
+        frame_number++;
+
+        // The dropped frames are skipped as a whole, so the time synchronization finds the next PRS symbol as usual.
+        // Their distance doesn't tell anything about the sample clock offset.
+        auto number_of_dropped_frames = load_shedder.has_value() ? load_shedder->finish_frame(frame_number - 1) : 0;
+        if (number_of_dropped_frames > 0)
+        {
+            fmt::println("{} frames dropped to catch up with real time.", number_of_dropped_frames);
+            advance_signal_buffer(sample_source, static_cast<int64_t>(number_of_dropped_frames) * Mode::T_F);
+            if (sample_source.get_file_end_reached())
+            {
+                break;
+            }
+            global_prs_start_index = global_prs_start_index + static_cast<int64_t>(number_of_dropped_frames) * Mode::T_F;
+            frame_number = frame_number + number_of_dropped_frames;
+            has_previous_prs_start_time = false;
+            predicted_prs_start_index = std::nullopt;
+        }
+    }
+
+    fmt::println("File ended.");
+    fmt::println("Sample clock offset: {:.2f} ppm.", 1e6 * (m_resampler != nullptr ? m_resampler->get_sample_clock_offset() : ofdm_demodulator.get_sample_clock_offset()));
+    fic_sampler.print_statistics();
+    fic_handler.print_statistics();
+    if (load_shedder.has_value())
+    {
+        load_shedder->print_statistics();
+    }
+}
+
+// Reads only the frames of the selected range, so neither the time synchronizer
+// nor the estimation of the coarse frequency offset is needed.
+// If the samples are resampled, the resampler seeks to the input position of every frame
+// and reuses the resampling ratio of the first pass.
+template <typename Mode>
+void MainController::run_indexed(const std::string& file_path, const FrameIndex& frame_index)
+{
+    auto allocation_counter{ AllocationCounter::ScopedThreadCounter(m_allocation_counter.get()) };
+    auto sample_source = create_sample_source(file_path);
+    auto ofdm_demodulator{ OfdmDemodulator<Mode>(*m_task_scheduler) };
+    auto fic_handler = create_fic_handler<Mode>();
+    auto fic_sampler{ create_fic_sampler<Mode>() };
+
+    const auto& entries = frame_index.get_entries();
+    auto number_of_entries = static_cast<int>(entries.size());
+    auto first_frame = std::min(m_options.first_frame, number_of_entries);
+    auto last_frame = number_of_entries;
+    if (m_options.number_of_frames.has_value())
+    {
+        last_frame = std::min(first_frame + m_options.number_of_frames.value(), number_of_entries);
+    }
+
+    if (first_frame < last_frame)
+    {
+        ofdm_demodulator.set_coarse_frequency_offset(entries[first_frame].coarse_frequency_offset);
+    }
+
+    auto sample_index = int64_t(0);
+    for (int i = first_frame; i < last_frame; i++)
+    {
+        auto span{ Tracing::ScopedSpan("MainController::frame") };
+        auto number_of_allocations = AllocationCounter::get_number_of_allocations(*m_allocation_counter);
+
+        const auto& entry = entries[i];
+        if (m_resampler != nullptr)
+        {
+            m_resampler->set_sample_clock_offset(entry.sample_clock_offset);
+        }
+        else if (entry.sample_clock_offset != ofdm_demodulator.get_sample_clock_offset())
+        {
+            ofdm_demodulator.set_sample_clock_offset(entry.sample_clock_offset);
+        }
+
+        // The resampler continues at the input position of the frame, so the drift of the resampling ratio
+        // between the frames of the first pass isn't accumulated.
+        if (m_resampler != nullptr)
+        {
+            m_resampler->seek(entry.global_prs_start_index, entry.input_prs_start_position);
+        }
+        else
+        {
+            sample_source->skip(entry.global_prs_start_index - sample_index);
+        }
+        sample_source->read(m_frame_buffer, 0, m_frame_buffer.size() - 1);
+        if (sample_source->get_file_end_reached())
         {
             break;
         }
+        sample_index = entry.global_prs_start_index + Mode::T_F_U;
 
-        ofdm_demodulator.update_hard_bits(m_frame_buffer, m_hard_bits);
+        fmt::println("Frame {} starts at sample {}.", i, entry.global_prs_start_index);
 
-        fic_handler.update_fib_blocks(m_hard_bits);
+        process_frame<Mode>(ofdm_demodulator, fic_handler, fic_sampler, i, true, false);
+
+        check_allocations(i - first_frame, AllocationCounter::get_number_of_allocations(*m_allocation_counter) - number_of_allocations);
+        update_perf_counters(i - first_frame, Mode::T_F);
     }
 
     fmt::println("File ended.");
+    fic_sampler.print_statistics();
+    fic_handler.print_statistics();
+}
+
+template <typename Mode>
+FicSampler MainController::create_fic_sampler() const
+{
+    return FicSampler(m_options.fic_interval, m_options.detect_fic_changes, Mode::N_FIC_SYMBOLS * static_cast<int>(m_hard_bits.cols()), Mode::N_CIFS, Mode::N_FIB_BITS);
+}
+
+// The codewords of every decoded frame are recorded, so they must not be skipped by the cache.
+template <typename Mode>
+FicHandler<Mode> MainController::create_fic_handler() const
+{
+    auto is_recording_codewords = m_checkpoint_writer != nullptr && m_checkpoint_writer->get_stage() == CheckpointStage::CODEWORDS;
+    return FicHandler<Mode>::create(*m_task_scheduler, is_recording_codewords ? 0 : m_options.fic_block_cache_capacity, m_options.use_adaptive_viterbi, m_publisher.get());
+}
+
+template <typename Mode>
+std::optional<LoadShedder> MainController::create_load_shedder() const
+{
+    if (!m_options.real_time_speed.has_value())
+    {
+        return std::nullopt;
+    }
+
+    return LoadShedder(static_cast<double>(Mode::T_F) / SAMPLE_RATE, m_options.real_time_speed.value());
+}
+
+// Frames of which the FIC isn't decoded only demodulate the PRS symbol to track the frequency offsets
+// or, to detect a change, the FIC symbols.
+template <typename Mode>
+static int get_number_of_data_symbols(FicSampler::Decision decision, bool is_msc_shed)
+{
+    if (decision == FicSampler::Decision::SKIP)
+    {
+        return 0;
+    }
+
+    if (decision == FicSampler::Decision::DETECT_CHANGE || is_msc_shed)
+    {
+        return Mode::N_FIC_SYMBOLS;
+    }
+
+    return Mode::N_DATA_SYMBOLS;
+}
+
+template <typename Mode>
+void MainController::process_frame(OfdmDemodulator<Mode>& ofdm_demodulator, FicHandler<Mode>& fic_handler, FicSampler& fic_sampler, int frame_number, bool is_selected, bool is_msc_shed)
+{
+    auto decision = is_selected ? fic_sampler.decide(frame_number) : FicSampler::Decision::SKIP;
+    auto n_data_symbols = get_number_of_data_symbols<Mode>(decision, is_msc_shed);
+
+    // The OFDM demodulator corrects the frame buffer in place.
+    if (m_checkpoint_writer != nullptr && m_checkpoint_writer->get_stage() == CheckpointStage::FRAMES)
+    {
+        m_checkpoint_writer->write(frame_number, n_data_symbols, ofdm_demodulator.get_sample_clock_offset(), m_frame_buffer.data(), m_frame_buffer.size() * sizeof(std::complex<float>));
+    }
+
+    ofdm_demodulator.update_hard_bits(m_frame_buffer, m_hard_bits, n_data_symbols);
+    if (decode_fic<Mode>(fic_handler, fic_sampler, decision, frame_number))
+    {
+        record_checkpoint<Mode>(ofdm_demodulator, fic_handler, frame_number);
+    }
+}
+
+// The samples of the remaining symbols are read one symbol after another, e.g. from a live stream,
+// and the rest of the frame is read once no more symbols are demodulated.
+template <typename Mode>
+void MainController::stream_frame(SampleSource& sample_source, int prs_start_index, OfdmDemodulator<Mode>& ofdm_demodulator, FicHandler<Mode>& fic_handler, FicSampler& fic_sampler, int frame_number, bool is_selected, bool is_msc_shed)
+{
+    auto decision = is_selected ? fic_sampler.decide(frame_number) : FicSampler::Decision::SKIP;
+    auto n_data_symbols = get_number_of_data_symbols<Mode>(decision, is_msc_shed);
+    auto n_fic_data_symbols = std::min(n_data_symbols, Mode::N_FIC_SYMBOLS);
+
+    auto length = (1 + n_fic_data_symbols) * Mode::T_S;
+    update_frame_buffer(sample_source, prs_start_index, 0, length - 1);
+    if (sample_source.get_file_end_reached())
+    {
+        return;
+    }
+
+    ofdm_demodulator.update_hard_bits(m_frame_buffer, m_hard_bits, n_fic_data_symbols);
+    if (decode_fic<Mode>(fic_handler, fic_sampler, decision, frame_number))
+    {
+        record_checkpoint<Mode>(ofdm_demodulator, fic_handler, frame_number);
+    }
+
+    for (int i = n_fic_data_symbols; i < n_data_symbols; i++)
+    {
+        update_frame_buffer(sample_source, prs_start_index, length, length + Mode::T_S - 1);
+        if (sample_source.get_file_end_reached())
+        {
+            return;
+        }
+        length = length + Mode::T_S;
+
+        ofdm_demodulator.update_remaining_hard_bits(m_frame_buffer, m_hard_bits, i, i + 1);
+    }
+
+    update_frame_buffer(sample_source, prs_start_index, length, static_cast<int>(m_frame_buffer.size()) - 1);
+}
+
+template <typename Mode>
+bool MainController::decode_fic(FicHandler<Mode>& fic_handler, FicSampler& fic_sampler, FicSampler::Decision decision, int frame_number)
+{
+    // The rows of the FIC symbols are contiguous.
+    const auto raw_fic_bits = m_hard_bits.data();
+    if (decision == FicSampler::Decision::SKIP)
+    {
+        return false;
+    }
+
+    // A change is detected by the decoded FIBs, so that a FIG whose content changed only in a few bits isn't missed.
+    // Equal raw bits result in equal FIBs, so the FIC is only decoded for the comparison if the raw bits differ at all.
+    if (decision == FicSampler::Decision::DETECT_CHANGE && !fic_sampler.have_raw_fic_bits_changed(raw_fic_bits))
+    {
+        return false;
+    }
+
+    fic_handler.decode_fib_blocks(m_hard_bits);
+    if (decision == FicSampler::Decision::DETECT_CHANGE && !fic_sampler.have_fibs_changed(fic_handler.get_fib_bits_per_fic_block()))
+    {
+        return false;
+    }
+
+    fic_handler.pass_fic_blocks(frame_number, m_fic_block_callback);
+    fic_sampler.set_decoded(frame_number, raw_fic_bits, fic_handler.get_fib_bits_per_fic_block());
+    return true;
 }
 
-void MainController::update_frame_buffer(RawFileHandler& raw_file_handler, int prs_start_index)
+template <typename Mode>
+void MainController::record_checkpoint(const OfdmDemodulator<Mode>& ofdm_demodulator, const FicHandler<Mode>& fic_handler, int frame_number)
 {
-    auto current_signal_index = prs_start_index;
-    for (int i = 0; i < m_frame_buffer.size(); i++)
+    if (m_checkpoint_writer == nullptr)
+    {
+        return;
+    }
+
+    switch (m_checkpoint_writer->get_stage())
+    {
+    case CheckpointStage::CARRIER_VALUES:
+        m_checkpoint_writer->write(frame_number, Mode::N_FIC_SYMBOLS, ofdm_demodulator.get_sample_clock_offset(), ofdm_demodulator.get_carrier_values(), (Mode::N_FIC_SYMBOLS + 1) * Mode::N_CARRIERS * sizeof(std::complex<float>));
+        break;
+    case CheckpointStage::HARD_BITS:
+        m_checkpoint_writer->write(frame_number, Mode::N_FIC_SYMBOLS, ofdm_demodulator.get_sample_clock_offset(), m_hard_bits.data(), Mode::N_FIC_SYMBOLS * m_hard_bits.cols() * sizeof(uint64_t));
+        break;
+    case CheckpointStage::CODEWORDS:
+        m_checkpoint_writer->write(frame_number, Mode::N_FIC_SYMBOLS, ofdm_demodulator.get_sample_clock_offset(), fic_handler.get_codewords(), Mode::N_CIFS * FicHandler<Mode>::N_CODEWORD_WORDS * sizeof(uint64_t));
+        break;
+    default:
+        break;
+    }
+}
+
+// The size of every record is checked against the buffers of the transmission mode before its data are copied.
+// Only the stages themselves are timed and the FIC blocks aren't cached, so that every record is fully decoded.
+template <typename Mode>
+void MainController::replay(CheckpointReader& checkpoint_reader)
+{
+    auto allocation_counter{ AllocationCounter::ScopedThreadCounter(m_allocation_counter.get()) };
+    initialize_buffers<Mode>();
+    auto ofdm_demodulator{ OfdmDemodulator<Mode>(*m_task_scheduler) };
+    auto fic_handler = FicHandler<Mode>::create(*m_task_scheduler, 0, m_options.use_adaptive_viterbi);
+
+    auto stage = checkpoint_reader.get_stage();
+    auto expected_size = size_t(0);
+    switch (stage)
     {
-        m_frame_buffer[i] = m_signal_buffer[current_signal_index++];
+    case CheckpointStage::FRAMES:
+        expected_size = m_frame_buffer.size() * sizeof(std::complex<float>);
+        break;
+    case CheckpointStage::CARRIER_VALUES:
+        expected_size = (Mode::N_FIC_SYMBOLS + 1) * Mode::N_CARRIERS * sizeof(std::complex<float>);
+        break;
+    case CheckpointStage::HARD_BITS:
+        expected_size = Mode::N_FIC_SYMBOLS * m_hard_bits.cols() * sizeof(uint64_t);
+        break;
+    case CheckpointStage::CODEWORDS:
+        expected_size = Mode::N_CIFS * FicHandler<Mode>::N_CODEWORD_WORDS * sizeof(uint64_t);
+        break;
+    }
 
-        if (current_signal_index >= m_signal_buffer.size())
+    auto record{ CheckpointRecord() };
+    auto number_of_records = 0;
+    auto duration = std::chrono::steady_clock::duration::zero();
+    while (checkpoint_reader.read(record))
+    {
+        auto number_of_allocations = AllocationCounter::get_number_of_allocations(*m_allocation_counter);
+        if (record.data.size() != expected_size || record.n_data_symbols < 0 || record.n_data_symbols > Mode::N_DATA_SYMBOLS)
         {
-            raw_file_handler.read(m_frame_buffer, i + 1, m_frame_buffer.size() - 1);
+            fmt::println("The record of the frame {} doesn't match the transmission mode.", record.frame_number);
             break;
         }
+
+        // The phases of the carriers are corrected by the sample clock offset of the recorded run.
+        if (record.sample_clock_offset != ofdm_demodulator.get_sample_clock_offset())
+        {
+            ofdm_demodulator.set_sample_clock_offset(record.sample_clock_offset);
+        }
+
+        auto start_time = std::chrono::steady_clock::now();
+        switch (stage)
+        {
+        case CheckpointStage::FRAMES:
+            std::memcpy(m_frame_buffer.data(), record.data.data(), expected_size);
+            ofdm_demodulator.update_hard_bits(m_frame_buffer, m_hard_bits, record.n_data_symbols);
+            if (record.n_data_symbols >= Mode::N_FIC_SYMBOLS)
+            {
+                fic_handler.update_fib_blocks(m_hard_bits, record.frame_number, m_fic_block_callback);
+            }
+            break;
+        case CheckpointStage::CARRIER_VALUES:
+            ofdm_demodulator.update_hard_bits_from_carrier_values(reinterpret_cast<const std::complex<float>*>(record.data.data()), m_hard_bits, Mode::N_FIC_SYMBOLS);
+            fic_handler.update_fib_blocks(m_hard_bits, record.frame_number, m_fic_block_callback);
+            break;
+        case CheckpointStage::HARD_BITS:
+            std::memcpy(m_hard_bits.data(), record.data.data(), expected_size);
+            fic_handler.update_fib_blocks(m_hard_bits, record.frame_number, m_fic_block_callback);
+            break;
+        case CheckpointStage::CODEWORDS:
+            fic_handler.update_fib_blocks_from_codewords(reinterpret_cast<const uint64_t*>(record.data.data()), record.frame_number, m_fic_block_callback);
+            break;
+        }
+        duration = duration + (std::chrono::steady_clock::now() - start_time);
+
+        check_allocations(number_of_records, AllocationCounter::get_number_of_allocations(*m_allocation_counter) - number_of_allocations);
+        number_of_records++;
+    }
+
+    auto seconds = std::chrono::duration<double>(duration).count();
+    fmt::println("{} frames replayed in {:.1f} ms, i.e. {:.0f} frames per second.", number_of_records, 1e3 * seconds, seconds > 0.0 ? number_of_records / seconds : 0.0);
+    fic_handler.print_statistics();
+}
+
+// Returns whether the run succeeded, i.e. whether there was no allocation after the warm-up if they are checked.
+bool MainController::check_run_allocations() const
+{
+    if (m_options.check_allocations)
+    {
+        fmt::println("{} heap allocations after the warm-up of {} frames.", m_number_of_steady_state_allocations, N_WARM_UP_FRAMES);
+        return m_number_of_steady_state_allocations == 0;
+    }
+
+    return true;
+}
+
+// The frame number counts the processed frames of the current run.
+void MainController::check_allocations(int frame_number, uint64_t number_of_allocations)
+{
+    if (!m_options.check_allocations || frame_number < N_WARM_UP_FRAMES || number_of_allocations == 0)
+    {
+        return;
+    }
+
+    fmt::println("{} heap allocations in the frame {}.", number_of_allocations, frame_number);
+    m_number_of_steady_state_allocations = m_number_of_steady_state_allocations + number_of_allocations;
+}
+
+// The frame number counts the processed frames of the current run.
+void MainController::update_perf_counters(int frame_number, int number_of_samples) const
+{
+    if (!PerfCounters::is_enabled())
+    {
+        return;
+    }
+
+    PerfCounters::add_samples(number_of_samples);
+    if (m_options.perf_report_interval.has_value() && (frame_number + 1) % m_options.perf_report_interval.value() == 0)
+    {
+        PerfCounters::print_report();
+    }
+}
+
+// Each chunk can be decoded by a separate process by the options --first-frame and --frame-count.
+void MainController::print_chunks(const FrameIndex& frame_index) const
+{
+    for (const auto& [first_frame, number_of_frames] : frame_index.split(m_options.number_of_chunks.value()))
+    {
+        fmt::println("--first-frame {} --frame-count {}", first_frame, number_of_frames);
+    }
+}
+
+bool MainController::is_frame_selected(int frame_number) const
+{
+    if (frame_number < m_options.first_frame)
+    {
+        return false;
+    }
+
+    return !m_options.number_of_frames.has_value() || frame_number < m_options.first_frame + m_options.number_of_frames.value();
+}
+
+// The distance between two consecutive PRS symbols is T_F samples
+// if the signal has exactly the sample rate of the receiver.
+// A deviation of the input sample clock lets this distance drift.
+// It is measured to a fraction of a sample since the start of each PRS symbol is refined by its timing offset.
+// If the signal is resampled, the drift fine-tunes the resampling ratio, so the PRS symbols stay T_F samples apart.
+// Otherwise, the samples aren't delayed and the drift is compensated by the OFDM demodulator within each frame,
+// so the distance keeps the whole sample clock offset.
+// Distances which are far away from T_F (e.g. because of a lost frame) are ignored.
+template <typename Mode>
+void MainController::update_sample_clock_offset(double frame_length, OfdmDemodulator<Mode>& ofdm_demodulator)
+{
+    if (std::abs(frame_length - Mode::T_F) > Mode::T_G / 4)
+    {
+        return;
+    }
+
+    if (m_resampler != nullptr)
+    {
+        auto deviation = frame_length - Mode::T_F;
+        auto sample_clock_offset = m_resampler->get_sample_clock_offset() + SAMPLE_CLOCK_OFFSET_GAIN * deviation / Mode::T_F;
+        m_resampler->set_sample_clock_offset(sample_clock_offset);
+    }
+    else
+    {
+        auto deviation = frame_length - Mode::T_F * (1.0 + ofdm_demodulator.get_sample_clock_offset());
+        auto sample_clock_offset = ofdm_demodulator.get_sample_clock_offset() + SAMPLE_CLOCK_OFFSET_GAIN * deviation / Mode::T_F;
+        ofdm_demodulator.set_sample_clock_offset(sample_clock_offset);
+    }
+}
+
+void MainController::update_frame_buffer(SampleSource& sample_source, int prs_start_index, int start_index, int stop_index)
+{
+    auto number_of_buffered_samples = m_number_of_buffered_samples - prs_start_index;
+    auto copy_stop_index = std::min(stop_index, number_of_buffered_samples - 1);
+    if (start_index <= copy_stop_index)
+    {
+        auto length = copy_stop_index - start_index + 1;
+        m_frame_buffer.segment(start_index, length) = m_signal_buffer.segment(prs_start_index + start_index, length);
+    }
+
+    auto read_start_index = std::max(start_index, number_of_buffered_samples);
+    if (read_start_index <= stop_index)
+    {
+        sample_source.read(m_frame_buffer, read_start_index, stop_index);
     }
 }
 
-void MainController::update_signal_buffer(RawFileHandler& raw_file_handler, int prs_start_index)
+void MainController::advance_signal_buffer(SampleSource& sample_source, int64_t number_of_samples)
 {
-    auto number_of_left_points = m_signal_buffer.size() - (prs_start_index + DabConstants::T_F_U);
+    auto size = static_cast<int64_t>(m_number_of_buffered_samples);
+    if (number_of_samples < size)
+    {
+        auto number_of_kept_samples = static_cast<int>(size - number_of_samples);
+        std::copy(m_signal_buffer.data() + number_of_samples, m_signal_buffer.data() + size, m_signal_buffer.data());
+        m_number_of_buffered_samples = number_of_kept_samples;
+    }
+    else
+    {
+        sample_source.skip(number_of_samples - size);
+        m_number_of_buffered_samples = 0;
+    }
+
+    fill_signal_buffer(sample_source, static_cast<int>(m_signal_buffer.size()));
+}
+
+void MainController::fill_signal_buffer(SampleSource& sample_source, int number_of_samples)
+{
+    if (m_number_of_buffered_samples < number_of_samples)
+    {
+        sample_source.read(m_signal_buffer, m_number_of_buffered_samples, number_of_samples - 1);
+        m_number_of_buffered_samples = number_of_samples;
+    }
+}
+
+template <typename Mode>
+void MainController::update_signal_buffer(SampleSource& sample_source, int prs_start_index)
+{
+    auto number_of_left_points = m_number_of_buffered_samples - (prs_start_index + Mode::T_F_U);
     if (number_of_left_points > 0)
     {
-        m_signal_buffer.head(number_of_left_points) = m_signal_buffer.tail(number_of_left_points);
-        raw_file_handler.read(m_signal_buffer, number_of_left_points, m_signal_buffer.size() - 1);
+        m_signal_buffer.head(number_of_left_points) = m_signal_buffer.segment(prs_start_index + Mode::T_F_U, number_of_left_points);
+        m_number_of_buffered_samples = number_of_left_points;
     }
     else
     {
-        raw_file_handler.read(m_signal_buffer, 0, m_signal_buffer.size() - 1);
+        m_number_of_buffered_samples = 0;
+    }
+
+    // With --low-latency, the samples after the frame are only read once the next PRS symbol is searched.
+    if (!m_options.stream_symbols)
+    {
+        fill_signal_buffer(sample_source, static_cast<int>(m_signal_buffer.size()));
     }
 }
@@ -1,24 +1,252 @@
 #pragma once
 
 #include "MainController.h"
+#include "DabConstants.h"
+#include "AllocationCounter.h"
+#include "SampleSource.h"
 #include "RawFileHandler.h"
+#include "Resampler.h"
+#include "FrameIndex.h"
+#include "FicHandler.h"
+#include "FicSampler.h"
+#include "LoadShedder.h"
+#include "OfdmDemodulator.h"
+#include "TaskScheduler.h"
+#include "Arena.h"
+#include "Checkpoint.h"
+#include "PackedBits.h"
+#include "SharedMemoryRing.h"
 
 #include "Eigen/Dense"
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
+
+// The options of the receiver which can be passed by the command line.
+struct ReceiverOptions
+{
+    // If no transmission mode is given, it is detected from the beginning of the file.
+    std::optional<DabConstants::TransmissionModeId> transmission_mode_id;
+
+    // The sample rate of the raw IQ file in samples per second.
+    // If it differs from the sample rate of the receiver, the samples are resampled.
+    int sample_rate = DabConstants::SAMPLE_RATE;
+
+    SampleFormat sample_format = SampleFormat::CU8;
+
+    // If given, the raw IQ file is a wideband capture which is split into DAB channels
+    // of these center frequencies in Hz relative to the center frequency of the capture.
+    std::vector<int> channel_frequencies;
+
+    // Whether the frame index next to the raw IQ file is used and written.
+    bool use_frame_index = true;
+
+    // The range of frames which are decoded.
+    // The frames before are still synchronized if there is no frame index yet.
+    int first_frame = 0;
+    std::optional<int> number_of_frames;
+
+    // If given, the frames of the frame index are only split into this number of chunks and printed.
+    std::optional<int> number_of_chunks;
+
+    // If given, the FIC is only decoded every this number of frames.
+    std::optional<int> fic_interval;
+
+    // Whether the FIC is additionally decoded if its raw bits change (only together with fic_interval).
+    bool detect_fic_changes = false;
+
+    // The number of recently decoded FIC blocks which are cached, so that repeated FIC blocks aren't decoded again.
+    // 0 disables the cache.
+    int fic_block_cache_capacity = 32;
+
+    // Whether the Viterbi decoding first follows a single path and only escalates to the full trellis
+    // if the FIC block has too many error bits.
+    bool use_adaptive_viterbi = false;
+
+    // If given, every frame is tracked against its deadline as if the samples arrived at this multiple of real time
+    // and work is shed under overload, see LoadShedder. The frame index isn't used then.
+    std::optional<double> real_time_speed;
+
+    // Whether each frame is demodulated symbol by symbol as its samples arrive,
+    // so that its FIC is decoded before the rest of the frame has been read.
+    bool stream_symbols = false;
+
+    // The file to which the data of the frames at the checkpoint stage are recorded, see Checkpoint.h.
+    std::optional<std::string> checkpoint_file_path;
+    CheckpointStage checkpoint_stage = CheckpointStage::HARD_BITS;
+
+    // The number of threads including the receiver thread which share the independent work within a frame.
+    int number_of_threads = 1;
+
+    // If given, the decoded FIC blocks are also published to the shared memory of this name, e.g. /dab,
+    // see SharedMemoryRing.h.
+    std::optional<std::string> shared_memory_name;
+
+    // Whether the buffers of the receiver are tried to be backed by huge pages.
+    bool use_huge_pages = false;
+
+    // Whether the heap allocations of every frame after the warm-up are counted.
+    // The run fails if there is any.
+    bool check_allocations = false;
+
+    // If given, the events of the performance counters are printed every this number of frames
+    // if they are enabled, see PerfCounters.h.
+    std::optional<int> perf_report_interval;
+};
 
 class MainController final
 {
 public:
-    MainController();
+    // The callback is called for every decoded FIC block.
+    MainController(const ReceiverOptions& options, FicBlockCallback fic_block_callback);
 
-    void run(const std::string& file_path);
+    // Returns whether the run succeeded.
+    bool run(const std::string& file_path);
+
+    // Runs the receiver for a stream of samples at the sample rate of the receiver, e.g. a channel of the channelizer.
+    // Since a stream can only be read once, the transmission mode isn't detected but taken from the options (I by default)
+    // and no frame index is used.
+    // If the stream is resampled, the given resampler is fine-tuned.
+    bool run(SampleSource& sample_source, Resampler* resampler);
+
+    // Runs the stages after the stage of the checkpoint for each of its records and prints their throughput.
+    // The samples aren't read, so the stages run at full speed.
+    // Returns whether the checkpoint could be read.
+    bool replay(const std::string& checkpoint_file_path);
 
 private:
-    Eigen::VectorXcf m_signal_buffer;
-    Eigen::VectorXcf m_frame_buffer;
-    Eigen::MatrixX<uint8_t> m_hard_bits;
+    // The gain by which the measured drift of the PRS symbols fine-tunes the sample clock offset per frame.
+    static constexpr double SAMPLE_CLOCK_OFFSET_GAIN = 0.1;
 
-    void MainController::update_signal_buffer(RawFileHandler& raw_file_handler, int prs_start_index);
-    void MainController::update_frame_buffer(RawFileHandler& raw_file_handler, int prs_start_index);
-};
+    // The number of frames during which allocations are allowed,
+    // e.g. for the acquisition of the coarse frequency offset or the buffer of the standard output.
+    static constexpr int N_WARM_UP_FRAMES = 2;
+
+    ReceiverOptions m_options;
+    FicBlockCallback m_fic_block_callback;
+    Resampler* m_resampler;
+
+    // Counts the allocations of the thread which runs the receiver and of the threads of its task scheduler,
+    // so that the other receivers in the process, e.g. of the other channels of a wideband capture, aren't counted.
+    std::unique_ptr<AllocationCounter::Counter> m_allocation_counter;
+    std::unique_ptr<TaskScheduler> m_task_scheduler;
+
+    // The buffers below are views into the arena.
+    std::unique_ptr<Arena> m_arena;
+    Eigen::Map<Eigen::VectorXcf> m_signal_buffer;
+    Eigen::Map<Eigen::VectorXcf> m_frame_buffer;
+    Eigen::Map<PackedBits::Matrix> m_hard_bits;
+
+    // The number of samples at the head of the signal buffer which are already read.
+    // Only with --low-latency, the signal buffer is filled no further than needed for the next PRS symbol.
+    int m_number_of_buffered_samples;
+
+    uint64_t m_number_of_steady_state_allocations;
+
+    // Records the frames if a checkpoint file is given.
+    std::unique_ptr<CheckpointWriter> m_checkpoint_writer;
+
+    // Publishes the decoded FIC blocks if a shared memory name is given.
+    std::unique_ptr<SharedMemoryPublisher> m_publisher;
+
+    std::optional<DabConstants::TransmissionModeId> detect_transmission_mode(const std::string& file_path);
+
+    // Creates the source of the samples at the sample rate of the receiver.
+    std::unique_ptr<SampleSource> create_sample_source(const std::string& file_path);
+
+    template <typename Mode>
+    FicHandler<Mode> create_fic_handler() const;
+
+    template <typename Mode>
+    void run(const std::string& file_path);
+
+    // Creates the arena for the given transmission mode and places the buffers in it.
+    // Only the signal buffer, the frame buffer and the hard bits, which are the largest buffers, are taken from the arena.
+    // The scratch buffers of the OFDM demodulator, the FIC handler, the Viterbi decoders and the time synchronizer
+    // are still allocated individually, but only once when they are created, so the frame loop doesn't allocate either.
+    template <typename Mode>
+    void initialize_buffers();
+
+    template <typename Mode>
+    void run_stream(SampleSource& sample_source);
+
+    // Synchronizes every frame and adds it to the frame index if there is one.
+    template <typename Mode>
+    void run_synchronized(SampleSource& sample_source, FrameIndex* frame_index);
+
+    // Seeks to the frames of the frame index without synchronizing them.
+    template <typename Mode>
+    void run_indexed(const std::string& file_path, const FrameIndex& frame_index);
+
+    template <typename Mode>
+    FicSampler create_fic_sampler() const;
+
+    template <typename Mode>
+    std::optional<LoadShedder> create_load_shedder() const;
+
+    // Demodulates the frame in the frame buffer and decodes its FIC if the FIC sampler decides so.
+    // The FIC of frames which aren't selected isn't decoded at all.
+    // If the MSC is shed, only the FIC symbols are demodulated.
+    template <typename Mode>
+    void process_frame(OfdmDemodulator<Mode>& ofdm_demodulator, FicHandler<Mode>& fic_handler, FicSampler& fic_sampler, int frame_number, bool is_selected, bool is_msc_shed);
+
+    // Like process_frame, but reads the frame buffer symbol by symbol from the sample source.
+    // The PRS and FIC symbols are demodulated and the FIC is decoded as soon as they have arrived.
+    template <typename Mode>
+    void stream_frame(SampleSource& sample_source, int prs_start_index, OfdmDemodulator<Mode>& ofdm_demodulator, FicHandler<Mode>& fic_handler, FicSampler& fic_sampler, int frame_number, bool is_selected, bool is_msc_shed);
+
+    // Decodes the FIC of the demodulated FIC symbols if the decision of the FIC sampler says so
+    // or if it detects a change.
+    // Returns whether the FIC was decoded.
+    template <typename Mode>
+    bool decode_fic(FicHandler<Mode>& fic_handler, FicSampler& fic_sampler, FicSampler::Decision decision, int frame_number);
+
+    // Returns whether the file could be opened or whether no checkpoint is recorded.
+    bool open_checkpoint_writer(DabConstants::TransmissionModeId transmission_mode_id);
+
+    // Returns whether all records could be written or whether no checkpoint is recorded.
+    bool close_checkpoint_writer();
+
+    // Returns whether the shared memory could be created or whether nothing is published.
+    bool open_publisher();
+
+    void close_publisher();
+
+    // Records the FIC of a frame after it is decoded unless the checkpoint stage is FRAMES, which is recorded before.
+    template <typename Mode>
+    void record_checkpoint(const OfdmDemodulator<Mode>& ofdm_demodulator, const FicHandler<Mode>& fic_handler, int frame_number);
+
+    template <typename Mode>
+    void replay(CheckpointReader& checkpoint_reader);
+
+    void print_chunks(const FrameIndex& frame_index) const;
+
+    bool is_frame_selected(int frame_number) const;
+
+    void check_allocations(int frame_number, uint64_t number_of_allocations);
+
+    bool check_run_allocations() const;
+
+    // Counts the samples of a processed frame for the performance counters and prints their report periodically.
+    void update_perf_counters(int frame_number, int number_of_samples) const;
+
+    template <typename Mode>
+    void update_sample_clock_offset(double frame_length, OfdmDemodulator<Mode>& ofdm_demodulator);
+
+    // Keeps the samples of the signal buffer after the frame of the given PRS symbol.
+    // Without --low-latency, the signal buffer is filled up again.
+    template <typename Mode>
+    void update_signal_buffer(SampleSource& sample_source, int prs_start_index);
+
+    // Reads the next samples into the signal buffer until it holds the given number of samples.
+    void fill_signal_buffer(SampleSource& sample_source, int number_of_samples);
+
+    // Fills the frame buffer from start_index to stop_index (both inclusive).
+    // The samples which are already in the signal buffer are copied and the others are read.
+    void update_frame_buffer(SampleSource& sample_source, int prs_start_index, int start_index, int stop_index);
+
+    // Moves the signal buffer forward by the given number of samples, e.g. to drop frames.
+    void advance_signal_buffer(SampleSource& sample_source, int64_t number_of_samples);
+};
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "NullSymbolDetector.h"
+#include "DabConstants.h"
+
+#include <complex>
+
+using namespace DabConstants;
+
+template <typename Mode>
+NullSymbolDetector<Mode>::NullSymbolDetector() :
+    m_power_history(Mode::T_NULL, 0.0f),
+    m_power_history_index(0),
+    m_window_energy(0.0),
+    m_mean_power(0.0),
+    m_sample_index(0),
+    m_in_null_symbol(false),
+    m_min_window_energy(0.0),
+    m_min_window_end_index(0),
+    m_last_null_symbol_end_index(std::nullopt),
+    m_number_of_consecutive_frames(0)
+{
+
+}
+
+// The energy of a window of T_NULL samples is updated in O(1) per window position.
+template <typename Mode>
+std::optional<int> NullSymbolDetector<Mode>::detect(const Eigen::Ref<const Eigen::VectorXcf>& signal_td, int search_length)
+{
+    auto size = static_cast<int>(signal_td.size());
+    auto last_window_start_index = std::min(search_length, size - Mode::T_NULL);
+    if (last_window_start_index < 0)
+    {
+        return std::nullopt;
+    }
+
+    auto window_energy = static_cast<double>(signal_td.head<Mode::T_NULL>().squaredNorm());
+    auto min_window_energy = window_energy;
+    auto min_window_start_index = 0;
+
+    for (int i = 1; i <= last_window_start_index; i++)
+    {
+        window_energy += std::norm(signal_td[i + Mode::T_NULL - 1]) - std::norm(signal_td[i - 1]);
+        if (window_energy < min_window_energy)
+        {
+            min_window_energy = window_energy;
+            min_window_start_index = i;
+        }
+    }
+
+    auto mean_power = signal_td.squaredNorm() / size;
+    if (min_window_energy > MAX_NULL_TO_SIGNAL_POWER_RATIO * Mode::T_NULL * mean_power)
+    {
+        return std::nullopt;
+    }
+
+    return min_window_start_index + Mode::T_NULL;
+}
+
+// The mean power of the signal is estimated by an exponential moving average over about one frame.
+// A Null symbol is reported when the window energy rises above the threshold again.
+// Its end is given by the window with the lowest energy.
+template <typename Mode>
+void NullSymbolDetector<Mode>::process(const Eigen::VectorXf& power)
+{
+    constexpr double ALPHA = 1.0 / Mode::T_F;
+
+    for (int i = 0; i < power.size(); i++)
+    {
+        m_window_energy += power[i] - m_power_history[m_power_history_index];
+        m_power_history[m_power_history_index] = power[i];
+        m_power_history_index = (m_power_history_index + 1) % Mode::T_NULL;
+        m_mean_power += (power[i] - m_mean_power) * ALPHA;
+        m_sample_index++;
+
+        // Wait until the mean power has settled.
+        if (m_sample_index < Mode::T_F)
+        {
+            continue;
+        }
+
+        if (m_window_energy < MAX_NULL_TO_SIGNAL_POWER_RATIO * Mode::T_NULL * m_mean_power)
+        {
+            if (!m_in_null_symbol || m_window_energy < m_min_window_energy)
+            {
+                m_min_window_energy = m_window_energy;
+                m_min_window_end_index = m_sample_index;
+            }
+            m_in_null_symbol = true;
+        }
+        else if (m_in_null_symbol)
+        {
+            m_in_null_symbol = false;
+            on_null_symbol_end(m_min_window_end_index);
+        }
+    }
+}
+
+template <typename Mode>
+void NullSymbolDetector<Mode>::on_null_symbol_end(long long end_index)
+{
+    if (m_last_null_symbol_end_index.has_value() &&
+        std::abs(end_index - m_last_null_symbol_end_index.value() - Mode::T_F) <= MAX_FRAME_LENGTH_DEVIATION)
+    {
+        m_number_of_consecutive_frames++;
+    }
+    else
+    {
+        m_number_of_consecutive_frames = 0;
+    }
+
+    m_last_null_symbol_end_index = end_index;
+}
+
+template <typename Mode>
+int NullSymbolDetector<Mode>::get_number_of_consecutive_frames() const
+{
+    return m_number_of_consecutive_frames;
+}
+
+template class NullSymbolDetector<TransmissionModeI>;
+template class NullSymbolDetector<TransmissionModeII>;
+template class NullSymbolDetector<TransmissionModeIII>;
+template class NullSymbolDetector<TransmissionModeIV>;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Eigen/Dense"
+
+#include <optional>
+#include <vector>
+
+// Detects the Null symbols by a moving average of the signal power.
+// This only needs O(N) operations and is not affected by frequency offsets.
+template <typename Mode>
+class NullSymbolDetector final
+{
+public:
+    NullSymbolDetector();
+
+    // Returns the index of the first sample after the Null symbol with the lowest energy
+    // which starts within the first search_length samples of the signal.
+    // This index is a coarse estimation of the start of the PRS symbol.
+    static std::optional<int> detect(const Eigen::Ref<const Eigen::VectorXcf>& signal_td, int search_length);
+
+    // Processes the next samples of a continuous stream given by their power.
+    // Afterwards, get_number_of_consecutive_frames returns the number of Null symbols in a row
+    // which were found exactly one frame apart from each other.
+    void process(const Eigen::VectorXf& power);
+
+    int get_number_of_consecutive_frames() const;
+
+private:
+    // The maximum ratio between the mean power of the Null symbol and the mean power of the signal.
+    static constexpr float MAX_NULL_TO_SIGNAL_POWER_RATIO = 0.3f;
+
+    // The maximum deviation in samples between the distance of two Null symbols and the length of a frame.
+    static constexpr int MAX_FRAME_LENGTH_DEVIATION = Mode::T_G / 4;
+
+    void on_null_symbol_end(long long end_index);
+
+    // The power of the last T_NULL samples.
+    std::vector<float> m_power_history;
+    int m_power_history_index;
+    double m_window_energy;
+    double m_mean_power;
+    long long m_sample_index;
+
+    bool m_in_null_symbol;
+    double m_min_window_energy;
+    long long m_min_window_end_index;
+    std::optional<long long> m_last_null_symbol_end_index;
+    int m_number_of_consecutive_frames;
+};
\ No newline at end of file
@@ -1,46 +1,77 @@
 #include "OfdmDemodulator.h"
 #include "DabConstants.h"
+#include "PrsCreation.h"
+#include "Tracing.h"
+
+#include "fmt/printf.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <algorithm>
 #include <complex>
 #include <iostream>
 
 using namespace DabConstants;
 using namespace std::complex_literals;
 
-OfdmDemodulator::OfdmDemodulator() :
-    m_time_buffer(T_F_U),
-    m_fft_calculator(T_U),
-    m_symbol_without_cp_td(T_U),
-    m_symbol_without_cp_fd(T_U),
-    m_carrier_values(N_OFDM_SYMBOLS, N_CARRIERS),
-    m_phase_corrected_carrier_values(N_DATA_SYMBOLS, N_CARRIERS),
-    m_k_by_n(N_CARRIERS),
-    m_frequency_deinterleaved_values(N_DATA_SYMBOLS, N_CARRIERS)
-{
-    m_time_buffer.setLinSpaced(0, T_F_U - 1);
+template <typename Mode>
+OfdmDemodulator<Mode>::OfdmDemodulator(TaskScheduler& task_scheduler) :
+    m_kernels(Kernels::get()),
+    m_task_scheduler(task_scheduler),
+    m_time_buffer(Mode::T_F_U),
+    m_phasors(Mode::T_F_U),
+    m_fft_calculators(),
+    m_symbols_without_cp_td(Mode::T_U, task_scheduler.get_number_of_threads()),
+    m_symbols_without_cp_fd(Mode::T_U, task_scheduler.get_number_of_threads()),
+    m_prs_symbol_fd(Mode::T_U),
+    m_carrier_values(Mode::N_OFDM_SYMBOLS, Mode::N_CARRIERS),
+    m_phase_corrected_carrier_values(Mode::N_DATA_SYMBOLS, Mode::N_CARRIERS),
+    m_k_by_n(Mode::N_CARRIERS),
+    m_frequency_deinterleaved_values(Mode::N_DATA_SYMBOLS, Mode::N_CARRIERS),
+    m_coarse_frequency_estimator(CoarseFrequencyEstimator<Mode>::create()),
+    m_coarse_frequency_offset(std::nullopt),
+    m_fine_frequency_offset(0.0f),
+    m_conjugated_prs_carrier_values(Mode::N_CARRIERS),
+    m_timing_offset(0.0f),
+    m_sample_clock_offset(0.0),
+    m_sample_clock_phasors(Eigen::RowVectorXcf::Ones(Mode::N_CARRIERS))
+{
+    m_time_buffer.setLinSpaced(0, Mode::T_F_U - 1);
     initialize_k_by_n();
+
+    Eigen::VectorXcf prs_symbol_fd = PrsCreation::create_fd<Mode>();
+    m_conjugated_prs_carrier_values.head<Mode::N_CARRIERS / 2>() = prs_symbol_fd.tail<Mode::N_CARRIERS / 2>().conjugate();
+    m_conjugated_prs_carrier_values.tail<Mode::N_CARRIERS / 2>() = prs_symbol_fd.segment<Mode::N_CARRIERS / 2>(1).conjugate();
+
+    // The FFT calculators are created one by one because copies would share their buffers.
+    m_fft_calculators.reserve(task_scheduler.get_number_of_threads());
+    for (int i = 0; i < task_scheduler.get_number_of_threads(); i++)
+    {
+        m_fft_calculators.emplace_back(Mode::T_U);
+    }
 }
 
-void OfdmDemodulator::initialize_k_by_n()
+// The formulas of section 14.6 of ETSI EN 300 401 V1.4.1 for the transmission modes I-IV
+// only differ in T_U which is why they are expressed by T_U here.
+template <typename Mode>
+void OfdmDemodulator<Mode>::initialize_k_by_n()
 {
     auto prev_pi = 0;
     auto n = 0;
 
-    for (int i = 0; i < T_U; i++)
+    for (int i = 0; i < Mode::T_U; i++)
     {
-        auto pi = (13 * prev_pi + 511) % 2048; // See first formula of 14.6.1 of ETSI EN 300 401 V2.1.1.
+        auto pi = (13 * prev_pi + Mode::T_U / 4 - 1) % Mode::T_U; // See first formula of 14.6.1 of ETSI EN 300 401 V2.1.1.
 
-        if (256 <= pi && pi <= 1792 && pi != 1024)
+        if (Mode::T_U / 8 <= pi && pi <= 7 * Mode::T_U / 8 && pi != Mode::T_U / 2)
         {
-            auto k = pi - 1024;
+            auto k = pi - Mode::T_U / 2;
             if (k > 0)
             {
                 k = k - 1;
             }
 
-            m_k_by_n[n] = k + 768; // This shifts k to positive numbers which can be used for indexing.
+            m_k_by_n[n] = k + Mode::K_MAX; // This shifts k to positive numbers which can be used for indexing.
             n = n + 1;
         }
 
@@ -48,73 +79,273 @@ void OfdmDemodulator::initialize_k_by_n()
     }
 }
 
-void OfdmDemodulator::update_hard_bits(Eigen::VectorXcf& frame_buffer, Eigen::MatrixX<uint8_t>& hard_bits)
+template <typename Mode>
+void OfdmDemodulator<Mode>::update_hard_bits(Eigen::Ref<Eigen::VectorXcf> frame_buffer, Eigen::Ref<PackedBits::Matrix> hard_bits, int n_data_symbols)
 {
-    correct_frequency_offset(frame_buffer);
-    demodulate_ofdm_symbol(frame_buffer);
-    correct_phase();
-    deinterleave_frequencies();
-    demap_qpsk_symobls(hard_bits);
+    assert(0 <= n_data_symbols && n_data_symbols <= Mode::N_DATA_SYMBOLS);
+
+    // The PRS symbol is always demodulated because it tracks the frequency offsets.
+    auto n_symbols = n_data_symbols + 1;
+    correct_frequency_offset(frame_buffer, 0, n_symbols);
+    correct_coarse_frequency_offset(frame_buffer, n_symbols);
+    demodulate_ofdm_symbol(frame_buffer, 0, n_symbols);
+    estimate_timing_offset();
+    correct_phase(0, n_symbols);
+    deinterleave_frequencies(0, n_symbols);
+    demap_qpsk_symobls(hard_bits, 0, n_symbols);
 }
 
-void OfdmDemodulator::correct_frequency_offset(Eigen::VectorXcf& frame_buffer)
+// The coarse frequency offset was already updated by the PRS symbol,
+// so the frequency correction of the remaining symbols includes it right away.
+// The phase of the first remaining symbol is corrected by the carriers of the symbol before, which are kept.
+template <typename Mode>
+void OfdmDemodulator<Mode>::update_remaining_hard_bits(Eigen::Ref<Eigen::VectorXcf> frame_buffer, Eigen::Ref<PackedBits::Matrix> hard_bits, int first_data_symbol, int end_data_symbol)
 {
-    for (int i = 0; i < N_OFDM_SYMBOLS; i++)
+    assert(0 < first_data_symbol && first_data_symbol <= end_data_symbol && end_data_symbol <= Mode::N_DATA_SYMBOLS);
+
+    auto first_symbol = first_data_symbol + 1;
+    auto end_symbol = end_data_symbol + 1;
+    correct_frequency_offset(frame_buffer, first_symbol, end_symbol);
+    demodulate_ofdm_symbol(frame_buffer, first_symbol, end_symbol);
+    correct_phase(first_symbol, end_symbol);
+    deinterleave_frequencies(first_symbol, end_symbol);
+    demap_qpsk_symobls(hard_bits, first_symbol, end_symbol);
+}
+
+template <typename Mode>
+const std::complex<float>* OfdmDemodulator<Mode>::get_carrier_values() const
+{
+    return m_carrier_values.data();
+}
+
+template <typename Mode>
+void OfdmDemodulator<Mode>::update_hard_bits_from_carrier_values(const std::complex<float> carrier_values[], Eigen::Ref<PackedBits::Matrix> hard_bits, int n_data_symbols)
+{
+    assert(0 <= n_data_symbols && n_data_symbols <= Mode::N_DATA_SYMBOLS);
+
+    auto n_symbols = n_data_symbols + 1;
+    using CarrierMatrix = Eigen::Matrix<std::complex<float>, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    m_carrier_values.topRows(n_symbols) = Eigen::Map<const CarrierMatrix>(carrier_values, n_symbols, Mode::N_CARRIERS);
+    estimate_timing_offset();
+    correct_phase(0, n_symbols);
+    deinterleave_frequencies(0, n_symbols);
+    demap_qpsk_symobls(hard_bits, 0, n_symbols);
+}
+
+template <typename Mode>
+void OfdmDemodulator<Mode>::correct_frequency_offset(Eigen::Ref<Eigen::VectorXcf> frame_buffer, int first_symbol, int end_symbol)
+{
+    auto span{ Tracing::ScopedSpan("OfdmDemodulator::correct_frequency_offset") };
+
+    m_task_scheduler.parallel_for(end_symbol - first_symbol, [&](int task_index, int /*thread_index*/)
     {
+        // The tasks run on all threads of the task scheduler, so each of them is counted by its own span.
+        auto task_span{ Tracing::ScopedSpan("OfdmDemodulator::correct_frequency_offset::symbol") };
+        auto i = first_symbol + task_index;
+
         // Determine an estimator for beta for the current symbol.
-        auto symbol_start_index = i * T_S;
+        auto symbol_start_index = i * Mode::T_S;
 
-        auto cyclic_prefix = frame_buffer.segment(symbol_start_index, T_G);
-        auto symbol_tail = frame_buffer.segment(symbol_start_index + T_U, T_G);
+        auto cyclic_prefix = frame_buffer.segment<Mode::T_G>(symbol_start_index);
+        auto symbol_tail = frame_buffer.segment<Mode::T_G>(symbol_start_index + Mode::T_U);
         auto dot_product = cyclic_prefix.dot(symbol_tail);
 
+        // Only the fractional part of the frequency offset can be determined by the cyclic prefix.
+        // The integer part is added by the coarse frequency offset.
         float pi = M_PI;
-        auto beta_estimator = (1 / (2 * pi)) * std::arg(dot_product);
+        auto fine_frequency_offset = (1 / (2 * pi)) * std::arg(dot_product);
+        auto beta_estimator = fine_frequency_offset + m_coarse_frequency_offset.value_or(0);
+        if (i == 0)
+        {
+            m_fine_frequency_offset = fine_frequency_offset;
+        }
 
         // Apply frequency correction.
-        auto phase_vector = -1if * 2.0f * pi * (beta_estimator / T_U) * m_time_buffer.segment(symbol_start_index, T_S);
-        auto symbol = frame_buffer.segment(symbol_start_index, T_S).array();
-        symbol = symbol.array() * phase_vector.array().exp();
+        auto phase_vector = -1if * 2.0f * pi * (beta_estimator / Mode::T_U) * m_time_buffer.segment<Mode::T_S>(symbol_start_index);
+        m_phasors.segment<Mode::T_S>(symbol_start_index) = phase_vector.array().exp();
+        m_kernels.multiply_complex(frame_buffer.data() + symbol_start_index, m_phasors.data() + symbol_start_index, Mode::T_S);
+    });
+}
+
+template <typename Mode>
+std::optional<int> OfdmDemodulator<Mode>::get_coarse_frequency_offset() const
+{
+    return m_coarse_frequency_offset;
+}
+
+template <typename Mode>
+void OfdmDemodulator<Mode>::set_coarse_frequency_offset(int coarse_frequency_offset)
+{
+    m_coarse_frequency_offset = coarse_frequency_offset;
+}
+
+template <typename Mode>
+float OfdmDemodulator<Mode>::get_fine_frequency_offset() const
+{
+    return m_fine_frequency_offset;
+}
+
+template <typename Mode>
+float OfdmDemodulator<Mode>::get_timing_offset() const
+{
+    return m_timing_offset;
+}
+
+template <typename Mode>
+double OfdmDemodulator<Mode>::get_sample_clock_offset() const
+{
+    return m_sample_clock_offset;
+}
+
+// The start of the OFDM symbol l of a frame lies l * T_S * sample_clock_offset samples behind its FFT window.
+// A delay by d samples turns the phase of the carrier k by -2 * pi * k * d / T_U,
+// so the differential values of two consecutive symbols are turned back by the delay of T_S * sample_clock_offset.
+template <typename Mode>
+void OfdmDemodulator<Mode>::set_sample_clock_offset(double sample_clock_offset)
+{
+    m_sample_clock_offset = sample_clock_offset;
+
+    auto phase_per_carrier = 2.0 * M_PI * Mode::T_S * sample_clock_offset / Mode::T_U;
+    for (int i = 0; i < Mode::N_CARRIERS; i++)
+    {
+        // The carriers range from -N_CARRIERS / 2 to N_CARRIERS / 2 without the center carrier 0.
+        auto k = i < Mode::N_CARRIERS / 2 ? i - Mode::N_CARRIERS / 2 : i - Mode::N_CARRIERS / 2 + 1;
+        m_sample_clock_phasors[i] = std::polar(1.0f, static_cast<float>(phase_per_carrier * k));
     }
 }
 
-void OfdmDemodulator::demodulate_ofdm_symbol(Eigen::VectorXcf& frame_buffer)
+// Determines the integer part of the frequency offset by the PRS symbol
+// of which the fractional part of the frequency offset is already corrected.
+template <typename Mode>
+void OfdmDemodulator<Mode>::correct_coarse_frequency_offset(Eigen::Ref<Eigen::VectorXcf> frame_buffer, int end_symbol)
 {
-    for (int i = 0; i < N_OFDM_SYMBOLS; i++)
+    auto span{ Tracing::ScopedSpan("OfdmDemodulator::correct_coarse_frequency_offset") };
+
+    m_symbols_without_cp_td.col(0) = frame_buffer.segment<Mode::T_U>(Mode::T_G);
+    m_fft_calculators[0].fft(m_symbols_without_cp_td.col(0).data(), m_prs_symbol_fd.data());
+
+    auto residual_offset = 0;
+    if (m_coarse_frequency_offset.has_value())
     {
-        m_symbol_without_cp_td = frame_buffer.segment(i * T_S + T_G, T_U);
-        m_fft_calculator.fft(m_symbol_without_cp_td.data(), m_symbol_without_cp_fd.data());
+        residual_offset = m_coarse_frequency_estimator.track(m_prs_symbol_fd);
+    }
+    else
+    {
+        residual_offset = m_coarse_frequency_estimator.estimate(m_prs_symbol_fd);
+        m_coarse_frequency_offset = 0;
+    }
 
-        m_carrier_values.row(i).head(N_CARRIERS / 2) = m_symbol_without_cp_fd.tail(N_CARRIERS / 2);
-        m_carrier_values.row(i).tail(N_CARRIERS / 2) = m_symbol_without_cp_fd.segment(1, N_CARRIERS / 2);
+    if (residual_offset == 0)
+    {
+        return;
     }
+
+    m_coarse_frequency_offset = m_coarse_frequency_offset.value() + residual_offset;
+    fmt::println("Coarse frequency offset set to {} carriers.", m_coarse_frequency_offset.value());
+
+    // Apply the residual frequency correction to the demodulated symbols.
+    float pi = M_PI;
+    auto length = end_symbol * Mode::T_S;
+    auto phase_vector = -1if * 2.0f * pi * (static_cast<float>(residual_offset) / Mode::T_U) * m_time_buffer.head(length);
+    m_phasors.head(length) = phase_vector.array().exp();
+    m_kernels.multiply_complex(frame_buffer.data(), m_phasors.data(), length);
 }
 
-void OfdmDemodulator::correct_phase()
+template <typename Mode>
+void OfdmDemodulator<Mode>::demodulate_ofdm_symbol(Eigen::Ref<Eigen::VectorXcf> frame_buffer, int first_symbol, int end_symbol)
 {
-    for (int i = 1; i < N_OFDM_SYMBOLS; i++)
+    auto span{ Tracing::ScopedSpan("OfdmDemodulator::demodulate_ofdm_symbol") };
+
+    m_task_scheduler.parallel_for(end_symbol - first_symbol, [&](int task_index, int thread_index)
     {
-        m_phase_corrected_carrier_values.row(i - 1) = m_carrier_values.row(i - 1).conjugate().array() * m_carrier_values.row(i).array();
-    }
+        auto task_span{ Tracing::ScopedSpan("OfdmDemodulator::demodulate_ofdm_symbol::symbol") };
+        auto i = first_symbol + task_index;
+        auto symbol_without_cp_td = m_symbols_without_cp_td.col(thread_index);
+        auto symbol_without_cp_fd = m_symbols_without_cp_fd.col(thread_index);
+        symbol_without_cp_td = frame_buffer.segment<Mode::T_U>(i * Mode::T_S + Mode::T_G);
+        m_fft_calculators[thread_index].fft(symbol_without_cp_td.data(), symbol_without_cp_fd.data());
+
+        m_carrier_values.row(i).head<Mode::N_CARRIERS / 2>() = symbol_without_cp_fd.tail<Mode::N_CARRIERS / 2>();
+        m_carrier_values.row(i).tail<Mode::N_CARRIERS / 2>() = symbol_without_cp_fd.segment<Mode::N_CARRIERS / 2>(1);
+    });
 }
 
-void OfdmDemodulator::deinterleave_frequencies()
+// If the FFT window starts d samples after the PRS symbol, the phase of the carrier k is turned by 2 * pi * k * d / T_U.
+// Removing the reference PRS symbol leaves this slope, which is averaged over all pairs of adjacent carriers.
+// The pair around the center carrier 0 is skipped because it is two carriers apart.
+template <typename Mode>
+void OfdmDemodulator<Mode>::estimate_timing_offset()
 {
-    for (int n = 0; n < N_CARRIERS; n++)
+    auto span{ Tracing::ScopedSpan("OfdmDemodulator::estimate_timing_offset") };
+
+    auto prs_carrier_values = m_carrier_values.row(0);
+    auto sum = std::complex<float>(0.0f, 0.0f);
+    for (int first_carrier : { 0, Mode::N_CARRIERS / 2 })
     {
-        m_frequency_deinterleaved_values.col(n) = m_phase_corrected_carrier_values.col(m_k_by_n[n]);
+        auto previous_value = prs_carrier_values[first_carrier] * m_conjugated_prs_carrier_values[first_carrier];
+        for (int i = first_carrier + 1; i < first_carrier + Mode::N_CARRIERS / 2; i++)
+        {
+            auto value = prs_carrier_values[i] * m_conjugated_prs_carrier_values[i];
+            sum += value * std::conj(previous_value);
+            previous_value = value;
+        }
     }
+
+    float pi = M_PI;
+    m_timing_offset = std::arg(sum) * Mode::T_U / (2 * pi);
 }
 
-void OfdmDemodulator::demap_qpsk_symobls(Eigen::MatrixX<uint8_t>& hard_bits)
+template <typename Mode>
+void OfdmDemodulator<Mode>::correct_phase(int first_symbol, int end_symbol)
 {
-    for (int symbol_index = 0; symbol_index < N_OFDM_SYMBOLS - 1; symbol_index++)
+    auto span{ Tracing::ScopedSpan("OfdmDemodulator::correct_phase") };
+
+    for (int i = std::max(first_symbol, 1); i < end_symbol; i++)
     {
-        for (int carrier_index = 0; carrier_index < N_CARRIERS; carrier_index++)
+        if (m_sample_clock_offset == 0.0)
         {
-            auto complex_value = m_frequency_deinterleaved_values(symbol_index, carrier_index);
-            hard_bits(symbol_index, carrier_index) = complex_value.real() >= 0 ? 0 : 1;
-            hard_bits(symbol_index, carrier_index + N_CARRIERS) = complex_value.imag() >= 0 ? 0 : 1;
+            m_phase_corrected_carrier_values.row(i - 1) = m_carrier_values.row(i - 1).conjugate().array() * m_carrier_values.row(i).array();
         }
+        else
+        {
+            m_phase_corrected_carrier_values.row(i - 1) = m_carrier_values.row(i - 1).conjugate().array() * m_carrier_values.row(i).array() * m_sample_clock_phasors.array();
+        }
+    }
+}
+
+template <typename Mode>
+void OfdmDemodulator<Mode>::deinterleave_frequencies(int first_symbol, int end_symbol)
+{
+    auto span{ Tracing::ScopedSpan("OfdmDemodulator::deinterleave_frequencies") };
+
+    auto first_data_symbol = std::max(first_symbol, 1) - 1;
+    auto n_data_symbols = end_symbol - 1 - first_data_symbol;
+    for (int n = 0; n < Mode::N_CARRIERS; n++)
+    {
+        m_frequency_deinterleaved_values.col(n).segment(first_data_symbol, n_data_symbols) = m_phase_corrected_carrier_values.col(m_k_by_n[n]).segment(first_data_symbol, n_data_symbols);
     }
 }
+
+// The bits of the real parts of all carriers are followed by the bits of the imaginary parts.
+// Since the number of carriers is a multiple of 64 in every transmission mode,
+// the sign bits of 64 carriers form one word.
+template <typename Mode>
+void OfdmDemodulator<Mode>::demap_qpsk_symobls(Eigen::Ref<PackedBits::Matrix> hard_bits, int first_symbol, int end_symbol)
+{
+    auto span{ Tracing::ScopedSpan("OfdmDemodulator::demap_qpsk_symobls") };
+
+    constexpr int N_CARRIER_WORDS = Mode::N_CARRIERS / PackedBits::WORD_BITS;
+    static_assert(Mode::N_CARRIERS % PackedBits::WORD_BITS == 0);
+
+    for (int symbol_index = std::max(first_symbol, 1) - 1; symbol_index < end_symbol - 1; symbol_index++)
+    {
+        auto values = reinterpret_cast<const float*>(m_frequency_deinterleaved_values.row(symbol_index).data());
+        auto real_bits = &hard_bits(symbol_index, 0);
+        m_kernels.extract_sign_bits(values, N_CARRIER_WORDS, real_bits, real_bits + N_CARRIER_WORDS);
+    }
+}
+
+template class OfdmDemodulator<TransmissionModeI>;
+template class OfdmDemodulator<TransmissionModeII>;
+template class OfdmDemodulator<TransmissionModeIII>;
+template class OfdmDemodulator<TransmissionModeIV>;
@@ -1,35 +1,120 @@
 #pragma once
 
+#include "CoarseFrequencyEstimator.h"
 #include "FftCalculator.h"
+#include "PackedBits.h"
+#include "Kernels.h"
+#include "TaskScheduler.h"
 
 #include "Eigen/Dense";
 
+#include <complex>
+#include <optional>
+
+template <typename Mode>
 class OfdmDemodulator final
 {
 public:
-    OfdmDemodulator();
+    // The frequency correction and the FFT of the symbols are run in parallel by the task scheduler.
+    OfdmDemodulator(TaskScheduler& task_scheduler);
+
+    // Each row of the hard bits contains the packed bits of one data symbol.
+    // Only the first data symbols are demodulated, e.g. the FIC symbols, and the other rows are left unchanged.
+    void update_hard_bits(Eigen::Ref<Eigen::VectorXcf> frame_buffer, Eigen::Ref<PackedBits::Matrix> hard_bits, int n_data_symbols = Mode::N_DATA_SYMBOLS);
+
+    // Demodulates the data symbols from first_data_symbol to end_data_symbol - 1 of the same frame,
+    // e.g. as soon as their samples have arrived.
+    // The data symbols before must have been demodulated by update_hard_bits or this method.
+    void update_remaining_hard_bits(Eigen::Ref<Eigen::VectorXcf> frame_buffer, Eigen::Ref<PackedBits::Matrix> hard_bits, int first_data_symbol, int end_data_symbol);
+
+    // Returns the carriers of the last demodulated OFDM symbols, one row of N_CARRIERS values per OFDM symbol
+    // starting with the PRS symbol.
+    const std::complex<float>* get_carrier_values() const;
+
+    // Demodulates the first data symbols from the carriers of the PRS symbol and these data symbols,
+    // e.g. of a checkpoint, instead of from the samples of a frame.
+    // The carriers are given row by row like by get_carrier_values.
+    void update_hard_bits_from_carrier_values(const std::complex<float> carrier_values[], Eigen::Ref<PackedBits::Matrix> hard_bits, int n_data_symbols);
+
+    // Returns the integer part of the frequency offset in carriers.
+    // It has no value until it is determined by the first PRS symbol.
+    std::optional<int> get_coarse_frequency_offset() const;
+
+    // Sets the integer part of the frequency offset in carriers, e.g. from a frame index,
+    // so that it is only tracked instead of estimated by the first PRS symbol.
+    void set_coarse_frequency_offset(int coarse_frequency_offset);
+
+    // Returns the fractional part of the frequency offset in carriers
+    // which was determined by the PRS symbol of the last frame.
+    float get_fine_frequency_offset() const;
+
+    // Returns the offset in samples by which the FFT window of the PRS symbol of the last frame
+    // starts after the PRS symbol. It is determined by the phase slope across the carriers of the PRS symbol
+    // and refines the start index of the time synchronization by a fraction of a sample.
+    float get_timing_offset() const;
+
+    // Returns the relative deviation of the sample clock which is compensated within each frame.
+    double get_sample_clock_offset() const;
 
-    void update_hard_bits(Eigen::VectorXcf& frame_buffer, Eigen::MatrixX<uint8_t>& hard_bits);
+    // Sets the relative deviation of the sample clock, e.g. 1e-5 if a frame is 10 ppm longer than T_F samples.
+    // The OFDM symbols then drift against their FFT windows, which is compensated by a fractional delay,
+    // i.e. by a phase which rises linearly across the carriers of the differentially demodulated values.
+    void set_sample_clock_offset(double sample_clock_offset);
 
 private:
     // Initializes the member variable m_k_by_n.
     void initialize_k_by_n();
 
-    void correct_frequency_offset(Eigen::VectorXcf& frame_buffer);
-    void demodulate_ofdm_symbol(Eigen::VectorXcf& frame_buffer);
-    void correct_phase();
-    void deinterleave_frequencies();
-    void demap_qpsk_symobls(Eigen::MatrixX<uint8_t>& hard_bits);
+    // The steps only process the OFDM symbols from first_symbol to end_symbol - 1 where the PRS symbol is 0.
+    // A data symbol is processed together with the OFDM symbol after the PRS symbol of the same index.
+    void correct_frequency_offset(Eigen::Ref<Eigen::VectorXcf> frame_buffer, int first_symbol, int end_symbol);
+    void correct_coarse_frequency_offset(Eigen::Ref<Eigen::VectorXcf> frame_buffer, int end_symbol);
+    void demodulate_ofdm_symbol(Eigen::Ref<Eigen::VectorXcf> frame_buffer, int first_symbol, int end_symbol);
+    void estimate_timing_offset();
+    void correct_phase(int first_symbol, int end_symbol);
+    void deinterleave_frequencies(int first_symbol, int end_symbol);
+    void demap_qpsk_symobls(Eigen::Ref<PackedBits::Matrix> hard_bits, int first_symbol, int end_symbol);
+
+    const Kernels::KernelTable& m_kernels;
+    TaskScheduler& m_task_scheduler;
 
     Eigen::VectorXcf m_time_buffer;
-    FftCalculator m_fft_calculator;
-    Eigen::VectorXcf m_symbol_without_cp_td;
-    Eigen::VectorXcf m_symbol_without_cp_fd;
-    Eigen::MatrixXcf m_carrier_values;
+
+    // The factors of the frequency correction of the whole frame so that the symbols are corrected independently.
+    Eigen::VectorXcf m_phasors;
+
+    // The FFT calculators and the symbol buffers are per thread of the task scheduler
+    // since an FFT calculator has its own buffers, too.
+    std::vector<FftCalculator> m_fft_calculators;
+    Eigen::MatrixXcf m_symbols_without_cp_td;
+    Eigen::MatrixXcf m_symbols_without_cp_fd;
+    Eigen::VectorXcf m_prs_symbol_fd;
+    // The carriers of each symbol are stored contiguously so that the threads write separate cache lines.
+    Eigen::Matrix<std::complex<float>, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> m_carrier_values;
     Eigen::MatrixXcf m_phase_corrected_carrier_values;
 
     // Represents the mapping between n and k as described in the table 25 of section 14.6 of ETSI EN 300 401 V2.1.1.
-    // Here, k ranges from 0 to 1535.
+    // Here, k ranges from 0 to N_CARRIERS - 1.
     std::vector<int> m_k_by_n;
-    Eigen::MatrixXcf m_frequency_deinterleaved_values;
+
+    // The values of each symbol are stored contiguously for the demapping.
+    Eigen::Matrix<std::complex<float>, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> m_frequency_deinterleaved_values;
+
+    CoarseFrequencyEstimator<Mode> m_coarse_frequency_estimator;
+
+    // The integer part of the frequency offset in carriers.
+    // It is estimated once per acquisition and tracked afterwards.
+    std::optional<int> m_coarse_frequency_offset;
+
+    // The fractional part of the frequency offset in carriers.
+    float m_fine_frequency_offset;
+
+    // The conjugated carriers of the reference PRS symbol in the order of m_carrier_values.
+    Eigen::RowVectorXcf m_conjugated_prs_carrier_values;
+
+    float m_timing_offset;
+    double m_sample_clock_offset;
+
+    // The factors of the fractional delay between two consecutive OFDM symbols, one per carrier.
+    Eigen::RowVectorXcf m_sample_clock_phasors;
 };
\ No newline at end of file
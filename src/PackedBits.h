@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Eigen/Dense"
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Hard bits are packed into 64-bit words.
+// The bit with the index i is stored in the word i / 64 at the bit position i % 64,
+// i.e. the first bit is the least significant bit of the first word.
+namespace PackedBits
+{
+    constexpr int WORD_BITS = 64;
+
+    // Each row contains the packed bits of one OFDM symbol.
+    using Matrix = Eigen::Matrix<uint64_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    constexpr int get_number_of_words(int number_of_bits)
+    {
+        return (number_of_bits + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    inline uint8_t get_bit(const uint64_t words[], int index)
+    {
+        return static_cast<uint8_t>((words[index / WORD_BITS] >> (index % WORD_BITS)) & 1);
+    }
+
+    // Returns the number of bits which are set.
+    inline int popcount(uint64_t word)
+    {
+#if defined(_MSC_VER)
+        return static_cast<int>(__popcnt64(word));
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+
+    // Returns count (at most 64) bits starting at the given bit index in the lowest bits of the result.
+    inline uint64_t read_bits(const uint64_t words[], int index, int count)
+    {
+        auto word_index = index / WORD_BITS;
+        auto shift = index % WORD_BITS;
+
+        auto bits = words[word_index] >> shift;
+        if (shift != 0 && shift + count > WORD_BITS)
+        {
+            bits = bits | (words[word_index + 1] << (WORD_BITS - shift));
+        }
+
+        return count == WORD_BITS ? bits : bits & ((uint64_t(1) << count) - 1);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "PerfCounters.h"
+
+#include "fmt/printf.h"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace PerfCounters
+{
+    // The number of stages per thread. The spans of further stages aren't counted.
+    static constexpr int MAX_STAGES = 64;
+
+    static constexpr const char* EVENT_NAMES[N_EVENTS] = { "cycles", "instructions", "L1D read misses", "LLC misses", "branch misses", "task clock" };
+
+    // The counts are only written by the owning thread, so they are only atomic for a report during the run.
+    struct StageCounts
+    {
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> number_of_calls;
+        std::atomic<uint64_t> values[N_EVENTS];
+    };
+
+    struct ThreadCounters
+    {
+        // The file descriptor of the leader of the group or -1 if no event is available.
+        int group_fd;
+
+        // The file descriptor of each event or -1 if the event is unavailable.
+        int fds[N_EVENTS];
+
+        // The position of each event in the values read from the group or -1 if the event is unavailable.
+        int slots[N_EVENTS];
+
+        std::array<StageCounts, MAX_STAGES> stages;
+        std::atomic<int> number_of_stages;
+    };
+
+    static std::atomic<bool> g_is_enabled{ false };
+    static std::atomic<int64_t> g_number_of_samples{ 0 };
+
+    // The events which are available in any thread as a bit mask.
+    static std::atomic<uint32_t> g_available_events{ 0 };
+
+    // Whether the counts of any thread were scaled because the kernel multiplexed the counters.
+    static std::atomic<bool> g_is_multiplexed{ false };
+
+    // The counters of the threads are kept beyond the lifetime of their threads until the end of the process.
+    static std::mutex g_threads_mutex;
+    static std::vector<std::unique_ptr<ThreadCounters>> g_threads;
+
+    static thread_local ThreadCounters* t_counters = nullptr;
+
+#if defined(__linux__)
+    struct EventConfig
+    {
+        uint32_t type;
+        uint64_t config;
+    };
+
+    static constexpr EventConfig EVENT_CONFIGS[N_EVENTS] =
+    {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK }
+    };
+
+    // Only the user space of the calling thread is counted, which the default permissions allow.
+    // The first event which can be opened leads the group.
+    static void open_counters(ThreadCounters& counters)
+    {
+        auto number_of_slots = 0;
+        for (int event = 0; event < N_EVENTS; event++)
+        {
+            auto attributes{ perf_event_attr() };
+            attributes.size = sizeof(attributes);
+            attributes.type = EVENT_CONFIGS[event].type;
+            attributes.config = EVENT_CONFIGS[event].config;
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+
+            auto fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, counters.group_fd, 0));
+            counters.fds[event] = fd;
+            if (fd < 0)
+            {
+                counters.slots[event] = -1;
+                continue;
+            }
+
+            if (counters.group_fd < 0)
+            {
+                counters.group_fd = fd;
+            }
+            counters.slots[event] = number_of_slots;
+            number_of_slots++;
+            g_available_events.fetch_or(1u << event, std::memory_order_relaxed);
+        }
+    }
+
+    static void close_counters(ThreadCounters& counters)
+    {
+        for (int event = 0; event < N_EVENTS; event++)
+        {
+            if (counters.fds[event] >= 0)
+            {
+                close(counters.fds[event]);
+                counters.fds[event] = -1;
+            }
+        }
+        counters.group_fd = -1;
+    }
+
+    static void read_counters(const ThreadCounters& counters, Counts& counts)
+    {
+        uint64_t values[3 + N_EVENTS] = {};
+        if (counters.group_fd < 0 || ::read(counters.group_fd, values, sizeof(values)) <= 0)
+        {
+            std::memset(counts.values, 0, sizeof(counts.values));
+            return;
+        }
+
+        // The values of a group start with their number and the times during which the group was enabled and running.
+        // If the group only ran for a part of the time, its counts are extrapolated to the whole time.
+        auto time_enabled = values[1];
+        auto time_running = values[2];
+        auto scale = 1.0;
+        if (time_running > 0 && time_running < time_enabled)
+        {
+            scale = static_cast<double>(time_enabled) / time_running;
+            g_is_multiplexed.store(true, std::memory_order_relaxed);
+        }
+
+        for (int event = 0; event < N_EVENTS; event++)
+        {
+            auto value = counters.slots[event] >= 0 ? values[3 + counters.slots[event]] : 0;
+            counts.values[event] = scale == 1.0 ? value : static_cast<uint64_t>(value * scale);
+        }
+    }
+#else
+    static void open_counters(ThreadCounters& counters)
+    {
+        for (int event = 0; event < N_EVENTS; event++)
+        {
+            counters.fds[event] = -1;
+            counters.slots[event] = -1;
+        }
+    }
+
+    static void close_counters(ThreadCounters&)
+    {
+
+    }
+
+    static void read_counters(const ThreadCounters&, Counts& counts)
+    {
+        std::memset(counts.values, 0, sizeof(counts.values));
+    }
+#endif
+
+    void enable()
+    {
+        g_is_enabled.store(true, std::memory_order_release);
+    }
+
+    bool is_enabled()
+    {
+        return g_is_enabled.load(std::memory_order_relaxed);
+    }
+
+    // Closes the counters of its thread when the thread exits, while their counts are kept for the report.
+    struct ThreadCountersCloser
+    {
+        ~ThreadCountersCloser()
+        {
+            if (t_counters != nullptr)
+            {
+                close_counters(*t_counters);
+            }
+        }
+    };
+
+    // The counters of a thread are opened by its first span.
+    void read(Counts& counts)
+    {
+        if (t_counters == nullptr)
+        {
+            auto lock{ std::lock_guard<std::mutex>(g_threads_mutex) };
+            auto counters = std::make_unique<ThreadCounters>();
+            counters->group_fd = -1;
+            counters->number_of_stages.store(0);
+            open_counters(*counters);
+            t_counters = counters.get();
+            g_threads.push_back(std::move(counters));
+
+            // A thread_local variable within a function is constructed when its declaration is reached the first time.
+            static thread_local ThreadCountersCloser closer;
+        }
+
+        read_counters(*t_counters, counts);
+    }
+
+    void add(const char* stage_name, const Counts& start_counts)
+    {
+        auto end_counts{ Counts() };
+        read(end_counts);
+
+        auto number_of_stages = t_counters->number_of_stages.load(std::memory_order_relaxed);
+        auto stage_index = 0;
+        while (stage_index < number_of_stages && t_counters->stages[stage_index].name.load(std::memory_order_relaxed) != stage_name)
+        {
+            stage_index++;
+        }
+
+        if (stage_index == MAX_STAGES)
+        {
+            return;
+        }
+
+        auto& stage = t_counters->stages[stage_index];
+        if (stage_index == number_of_stages)
+        {
+            stage.name.store(stage_name, std::memory_order_relaxed);
+            stage.number_of_calls.store(0, std::memory_order_relaxed);
+            for (auto& value : stage.values)
+            {
+                value.store(0, std::memory_order_relaxed);
+            }
+            t_counters->number_of_stages.store(number_of_stages + 1, std::memory_order_release);
+        }
+
+        stage.number_of_calls.store(stage.number_of_calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        for (int event = 0; event < N_EVENTS; event++)
+        {
+            auto value = stage.values[event].load(std::memory_order_relaxed);
+            stage.values[event].store(value + (end_counts.values[event] - start_counts.values[event]), std::memory_order_relaxed);
+        }
+    }
+
+    void add_samples(int64_t number_of_samples)
+    {
+        g_number_of_samples.fetch_add(number_of_samples, std::memory_order_relaxed);
+    }
+
+    // The stages of all threads are merged by their names, e.g. the FFTs of the task scheduler's threads.
+    // The table is on the stack, so a periodic report doesn't allocate in the frame loop.
+    void print_report()
+    {
+        struct MergedStage
+        {
+            const char* name;
+            uint64_t number_of_calls;
+            uint64_t values[N_EVENTS];
+        };
+
+        auto merged_stages{ std::array<MergedStage, MAX_STAGES>() };
+        auto number_of_merged_stages = 0;
+        {
+            auto lock{ std::lock_guard<std::mutex>(g_threads_mutex) };
+            for (const auto& counters : g_threads)
+            {
+                auto number_of_stages = counters->number_of_stages.load(std::memory_order_acquire);
+                for (int i = 0; i < number_of_stages; i++)
+                {
+                    const auto& stage = counters->stages[i];
+                    auto name = stage.name.load(std::memory_order_relaxed);
+                    auto j = 0;
+                    while (j < number_of_merged_stages && std::strcmp(merged_stages[j].name, name) != 0)
+                    {
+                        j++;
+                    }
+
+                    if (j == MAX_STAGES)
+                    {
+                        continue;
+                    }
+
+                    if (j == number_of_merged_stages)
+                    {
+                        merged_stages[j] = MergedStage{ name, 0, {} };
+                        number_of_merged_stages++;
+                    }
+
+                    merged_stages[j].number_of_calls += stage.number_of_calls.load(std::memory_order_relaxed);
+                    for (int event = 0; event < N_EVENTS; event++)
+                    {
+                        merged_stages[j].values[event] += stage.values[event].load(std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+
+        auto available_events = g_available_events.load(std::memory_order_relaxed);
+        auto is_available = [available_events](int event) { return (available_events & (1u << event)) != 0; };
+        if ((available_events & ((1u << N_EVENTS) - 1)) != (1u << N_EVENTS) - 1)
+        {
+            fmt::print("Unavailable events, e.g. because of /proc/sys/kernel/perf_event_paranoid or a virtual machine:");
+            auto separator = " ";
+            for (int event = 0; event < N_EVENTS; event++)
+            {
+                if (!is_available(event))
+                {
+                    fmt::print("{}{}", separator, EVENT_NAMES[event]);
+                    separator = ", ";
+                }
+            }
+            fmt::println(".");
+        }
+
+        if (g_is_multiplexed.load(std::memory_order_relaxed))
+        {
+            fmt::println("The kernel multiplexed the counters, so the counts are estimates scaled by the time during which they were counting.");
+        }
+
+        // The counts are given per sample if the receiver has processed samples, e.g. not during a replay.
+        auto number_of_samples = g_number_of_samples.load(std::memory_order_relaxed);
+        auto unit = number_of_samples > 0 ? "sample" : "call";
+        fmt::println("Performance counters per stage in events per {}:", unit);
+        fmt::println("{:<50} {:>8} {:>12} {:>10} {:>6} {:>10} {:>10} {:>10}", "stage", "calls", "task clock", "cycles", "IPC", "L1D miss", "LLC miss", "br. miss");
+
+        // The columns are printed one by one instead of formatted into strings, so a periodic report doesn't allocate.
+        auto print_value = [&](uint64_t value, uint64_t divisor, int event)
+        {
+            if (!is_available(event) || divisor == 0)
+            {
+                fmt::print(" {:>10}", "n/a");
+                return;
+            }
+            fmt::print(" {:>10.3f}", static_cast<double>(value) / divisor);
+        };
+
+        for (int i = 0; i < number_of_merged_stages; i++)
+        {
+            const auto& stage = merged_stages[i];
+            auto divisor = number_of_samples > 0 ? static_cast<uint64_t>(number_of_samples) : stage.number_of_calls;
+            fmt::print("{:<50} {:>8}", stage.name, stage.number_of_calls);
+            if (is_available(TASK_CLOCK))
+            {
+                fmt::print(" {:>10.1f}ms", 1e-6 * stage.values[TASK_CLOCK]);
+            }
+            else
+            {
+                fmt::print(" {:>12}", "n/a");
+            }
+            print_value(stage.values[CYCLES], divisor, CYCLES);
+            if (is_available(CYCLES) && is_available(INSTRUCTIONS) && stage.values[CYCLES] > 0)
+            {
+                fmt::print(" {:>6.2f}", static_cast<double>(stage.values[INSTRUCTIONS]) / stage.values[CYCLES]);
+            }
+            else
+            {
+                fmt::print(" {:>6}", "n/a");
+            }
+            print_value(stage.values[L1D_READ_MISSES], divisor, L1D_READ_MISSES);
+            print_value(stage.values[LLC_MISSES], divisor, LLC_MISSES);
+            print_value(stage.values[BRANCH_MISSES], divisor, BRANCH_MISSES);
+            fmt::println("");
+        }
+    }
+}
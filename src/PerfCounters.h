@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts hardware events by perf_event_open on Linux within the spans of the stages of the receiver,
+// see Tracing::ScopedSpan, and sums them per stage over all threads which run spans of the stage.
+// This tells e.g. whether a stage is bound by cache misses or branch misses instead of only how long it takes.
+// Each thread opens its own group of counters by its first span, so all counters of a span are read by one system call.
+// The counters only count their own thread, so the work which the task scheduler distributes over its threads
+// is counted by a span per task, e.g. per OFDM symbol, and not by the span around the parallel loop.
+// If the kernel multiplexes more events than the CPU has counters, the counts are scaled by the time
+// during which the group was counting, and the report marks them as estimates.
+// The counters of a thread are closed when it exits.
+// The events which the CPU, the hypervisor or the permissions (see /proc/sys/kernel/perf_event_paranoid) don't allow
+// are reported as unavailable, and on other operating systems no event is available.
+// The counts of a span include the ones of the spans nested within it and the reading of the counters.
+namespace PerfCounters
+{
+    enum Event
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_READ_MISSES,
+        LLC_MISSES,
+        BRANCH_MISSES,
+
+        // The CPU time in nanoseconds which is a software event and so available without hardware counters.
+        TASK_CLOCK,
+
+        N_EVENTS
+    };
+
+    struct Counts
+    {
+        uint64_t values[N_EVENTS];
+    };
+
+    // Starts to count the events of every span.
+    void enable();
+
+    bool is_enabled();
+
+    // Reads the counts of the calling thread. The counts of unavailable events are 0.
+    void read(Counts& counts);
+
+    // Adds the counts since the given ones to the stage of the calling thread.
+    // The name must be a string literal since only the pointer is stored.
+    void add(const char* stage_name, const Counts& start_counts);
+
+    // Adds the number of samples which the receiver has processed, so that the counts are reported per sample.
+    void add_samples(int64_t number_of_samples);
+
+    // Prints the counts per stage summed over all threads. The other threads may keep counting meanwhile.
+    void print_report();
+}
\ No newline at end of file
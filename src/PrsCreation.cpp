@@ -3,6 +3,7 @@
 #include "FftCalculator.h"
 
 #include <complex>
+#include <iterator>
 
 using namespace DabConstants;
 using namespace std::complex_literals;
@@ -15,7 +16,7 @@ struct IndexTableEntry
 };
 
 // See table 23 of ETSI EN 300 401 V2.1.1.
-static const IndexTableEntry INDEX_TABLE[] =
+static constexpr IndexTableEntry INDEX_TABLE_MODE_I[] =
 {
     {-768, 0, 1},
     {-736, 1, 2},
@@ -67,6 +68,95 @@ static const IndexTableEntry INDEX_TABLE[] =
     {737, 1, 1}
 };
 
+// See table 40 of ETSI EN 300 401 V1.4.1.
+static constexpr IndexTableEntry INDEX_TABLE_MODE_II[] =
+{
+    {-192, 0, 2},
+    {-160, 1, 3},
+    {-128, 2, 2},
+    {-96, 3, 2},
+    {-64, 0, 1},
+    {-32, 1, 2},
+    {1, 2, 0},
+    {33, 1, 2},
+    {65, 0, 2},
+    {97, 3, 1},
+    {129, 2, 0},
+    {161, 1, 3}
+};
+
+// See table 41 of ETSI EN 300 401 V1.4.1.
+static constexpr IndexTableEntry INDEX_TABLE_MODE_III[] =
+{
+    {-96, 0, 2},
+    {-64, 1, 3},
+    {-32, 2, 0},
+    {1, 3, 2},
+    {33, 2, 2},
+    {65, 1, 2}
+};
+
+// See table 42 of ETSI EN 300 401 V1.4.1.
+static constexpr IndexTableEntry INDEX_TABLE_MODE_IV[] =
+{
+    {-384, 0, 0},
+    {-352, 1, 1},
+    {-320, 2, 1},
+    {-288, 3, 2},
+    {-256, 0, 2},
+    {-224, 1, 2},
+    {-192, 2, 0},
+    {-160, 3, 3},
+    {-128, 0, 3},
+    {-96, 1, 1},
+    {-64, 2, 3},
+    {-32, 3, 2},
+    {1, 0, 0},
+    {33, 3, 1},
+    {65, 2, 0},
+    {97, 1, 2},
+    {129, 0, 0},
+    {161, 3, 1},
+    {193, 2, 2},
+    {225, 1, 2},
+    {257, 0, 2},
+    {289, 3, 1},
+    {321, 2, 3},
+    {353, 1, 0}
+};
+
+// Maps a transmission mode to its index table.
+template <typename Mode>
+struct IndexTable;
+
+template <>
+struct IndexTable<TransmissionModeI>
+{
+    static constexpr const IndexTableEntry* ENTRIES = INDEX_TABLE_MODE_I;
+    static constexpr int SIZE = static_cast<int>(std::size(INDEX_TABLE_MODE_I));
+};
+
+template <>
+struct IndexTable<TransmissionModeII>
+{
+    static constexpr const IndexTableEntry* ENTRIES = INDEX_TABLE_MODE_II;
+    static constexpr int SIZE = static_cast<int>(std::size(INDEX_TABLE_MODE_II));
+};
+
+template <>
+struct IndexTable<TransmissionModeIII>
+{
+    static constexpr const IndexTableEntry* ENTRIES = INDEX_TABLE_MODE_III;
+    static constexpr int SIZE = static_cast<int>(std::size(INDEX_TABLE_MODE_III));
+};
+
+template <>
+struct IndexTable<TransmissionModeIV>
+{
+    static constexpr const IndexTableEntry* ENTRIES = INDEX_TABLE_MODE_IV;
+    static constexpr int SIZE = static_cast<int>(std::size(INDEX_TABLE_MODE_IV));
+};
+
 // See table 24 of ETSI EN 300 401 V2.1.1.
 static const int H_TABLE[4][32] =
 {
@@ -99,52 +189,64 @@ std::complex<float> calculate_z_1k(const int h, const int n)
     }
 }
 
-// Creates a reference PRS symbol as described in section 14.3.2 of ETSI EN 300 401 V2.1.1.
-Eigen::VectorXcf PrsCreation::create(const FftCalculator& fft_calculator)
+// Creates the carrier values of a reference PRS symbol as described in section 14.3.2 of ETSI EN 300 401 V2.1.1.
+template <typename Mode>
+Eigen::VectorXcf PrsCreation::create_fd()
 {
-    auto prs_fd{ Eigen::VectorXcf(T_U) };
+    auto prs_fd{ Eigen::VectorXcf(Mode::T_U) };
+    prs_fd.setZero(); // The DC component and the unused carriers are 0.
 
-    // We start with the second half of the INDEX_TABLE which represents the positive frequencies.
-    auto k = 1;
-    auto current_table_index = 24;
+    auto index_table = IndexTable<Mode>::ENTRIES;
+    auto current_table_index = 0;
 
-    prs_fd[0] = 0; // The DC component is 0.
-    for (int prs_fd_index = 1; prs_fd_index < T_U; prs_fd_index++)
+    for (int k = Mode::K_MIN; k <= Mode::K_MAX; k++)
     {
-        if (prs_fd_index > K_MAX && prs_fd_index < T_U - K_MAX)
+        if (k == 0)
         {
-            prs_fd[prs_fd_index] = 0;
             continue;
         }
 
-        if (prs_fd_index == T_U - K_MAX)
-        {
-            current_table_index = 0;
-            k = K_MIN;
-        }
-
-        if (k <= 737 && k >= INDEX_TABLE[current_table_index + 1].k_prime) // 737 == k_prime_max (see last row of table 23 of ETSI EN 300 401 V2.1.1)
+        if (current_table_index + 1 < IndexTable<Mode>::SIZE && k >= index_table[current_table_index + 1].k_prime)
         {
             current_table_index++;
         }
 
-        auto current_index_row = INDEX_TABLE[current_table_index];
+        auto current_index_row = index_table[current_table_index];
 
         auto k_prime = current_index_row.k_prime;
         auto i = current_index_row.i;
         auto n = current_index_row.n;
         auto h = H_TABLE[i][k - k_prime];
         auto z_1k = calculate_z_1k(h, n);
-        prs_fd[prs_fd_index] = z_1k;
 
-        k++;
+        // The negative frequencies are stored in the second half of prs_fd.
+        prs_fd[(k + Mode::T_U) % Mode::T_U] = z_1k;
     }
 
-    auto prs_td_with_cp{ Eigen::VectorXcf(T_S) };
-    auto prs_td_without_cp = prs_td_with_cp.tail<T_U>().data();
+    return prs_fd;
+}
+
+// Creates a reference PRS symbol as described in section 14.3.2 of ETSI EN 300 401 V2.1.1.
+template <typename Mode>
+Eigen::VectorXcf PrsCreation::create(const FftCalculator& fft_calculator)
+{
+    auto prs_fd = create_fd<Mode>();
+
+    auto prs_td_with_cp{ Eigen::VectorXcf(Mode::T_S) };
+    auto prs_td_without_cp = prs_td_with_cp.tail<Mode::T_U>().data();
     fft_calculator.ifft(prs_fd.data(), prs_td_without_cp);
 
-    prs_td_with_cp.head<T_G>() = prs_td_with_cp.tail<T_G>();
+    prs_td_with_cp.head<Mode::T_G>() = prs_td_with_cp.tail<Mode::T_G>();
 
     return prs_td_with_cp;
 }
+
+template Eigen::VectorXcf PrsCreation::create_fd<TransmissionModeI>();
+template Eigen::VectorXcf PrsCreation::create_fd<TransmissionModeII>();
+template Eigen::VectorXcf PrsCreation::create_fd<TransmissionModeIII>();
+template Eigen::VectorXcf PrsCreation::create_fd<TransmissionModeIV>();
+
+template Eigen::VectorXcf PrsCreation::create<TransmissionModeI>(const FftCalculator& fft_calculator);
+template Eigen::VectorXcf PrsCreation::create<TransmissionModeII>(const FftCalculator& fft_calculator);
+template Eigen::VectorXcf PrsCreation::create<TransmissionModeIII>(const FftCalculator& fft_calculator);
+template Eigen::VectorXcf PrsCreation::create<TransmissionModeIV>(const FftCalculator& fft_calculator);
@@ -6,5 +6,11 @@
 
 namespace PrsCreation
 {
+    // Returns the carrier values of the PRS symbol in the order of the FFT output,
+    // i.e. the positive frequencies are followed by the negative frequencies.
+    template <typename Mode>
+    Eigen::VectorXcf create_fd();
+
+    template <typename Mode>
     Eigen::VectorXcf create(const FftCalculator& fft_calculator);
 }
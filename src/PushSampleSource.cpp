@@ -0,0 +1,89 @@
+#include "PushSampleSource.h"
+
+#include <algorithm>
+
+PushSampleSource::PushSampleSource(SampleFormat sample_format) :
+    m_sample_format(sample_format),
+    m_bytes_per_sample(RawFileHandler::get_bytes_per_sample(sample_format)),
+    m_raw_samples(nullptr),
+    m_number_of_samples(0),
+    m_read_index(0),
+    m_is_closed(false),
+    m_is_cancelled(false),
+    m_file_end_reached(false)
+{
+
+}
+
+void PushSampleSource::push(const uint8_t raw_samples[], int number_of_samples)
+{
+    auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+    if (m_is_cancelled || m_is_closed)
+    {
+        return;
+    }
+
+    m_raw_samples = raw_samples;
+    m_number_of_samples = number_of_samples;
+    m_read_index = 0;
+    m_pushed.notify_one();
+
+    m_read.wait(lock, [this]() { return m_read_index == m_number_of_samples || m_is_cancelled; });
+
+    // The buffer belongs to the caller again.
+    m_raw_samples = nullptr;
+    m_number_of_samples = 0;
+    m_read_index = 0;
+}
+
+void PushSampleSource::close()
+{
+    auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+    m_is_closed = true;
+    m_pushed.notify_one();
+}
+
+void PushSampleSource::cancel()
+{
+    auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+    m_is_cancelled = true;
+    m_read.notify_one();
+}
+
+// The samples are converted straight from the buffer of the caller into the output.
+void PushSampleSource::read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index)
+{
+    auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+
+    auto i = start_index;
+    while (i <= stop_index)
+    {
+        if (m_read_index == m_number_of_samples)
+        {
+            m_read.notify_one();
+            m_pushed.wait(lock, [this]() { return m_read_index < m_number_of_samples || m_is_closed; });
+            if (m_read_index == m_number_of_samples)
+            {
+                m_file_end_reached = true;
+                return;
+            }
+        }
+
+        auto length = std::min(stop_index - i + 1, m_number_of_samples - m_read_index);
+        convert_samples(m_sample_format, m_raw_samples + m_bytes_per_sample * m_read_index, output.data() + i, length);
+        m_read_index = m_read_index + length;
+        i = i + length;
+    }
+
+    // The producer can already continue if the buffer is read completely.
+    if (m_read_index == m_number_of_samples)
+    {
+        m_read.notify_one();
+    }
+}
+
+bool PushSampleSource::get_file_end_reached()
+{
+    auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+    return m_file_end_reached;
+}
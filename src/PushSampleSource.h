@@ -0,0 +1,50 @@
+#pragma once
+
+#include "SampleSource.h"
+#include "RawFileHandler.h"
+
+#include "Eigen/Dense"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// A sample source which reads the samples directly from buffers of the caller.
+// Each push waits until the consumer thread has read the whole buffer,
+// so the samples are never copied into an intermediate queue and the caller can reuse the buffer afterwards.
+class PushSampleSource final : public SampleSource
+{
+public:
+    PushSampleSource(SampleFormat sample_format);
+
+    // Passes the raw samples to the consumer and waits until they are read.
+    // Returns immediately if the consumer has stopped.
+    void push(const uint8_t raw_samples[], int number_of_samples);
+
+    // Tells the consumer that no more samples will be pushed.
+    void close();
+
+    // Tells the producer that no more samples will be read.
+    void cancel();
+
+    void read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index) override;
+
+    bool get_file_end_reached() override;
+
+private:
+    SampleFormat m_sample_format;
+    int m_bytes_per_sample;
+
+    // The buffer of the current push.
+    const uint8_t* m_raw_samples;
+    int m_number_of_samples;
+    int m_read_index;
+
+    bool m_is_closed;
+    bool m_is_cancelled;
+    bool m_file_end_reached;
+
+    std::mutex m_mutex;
+    std::condition_variable m_pushed;
+    std::condition_variable m_read;
+};
\ No newline at end of file
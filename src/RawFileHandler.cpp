@@ -1,8 +1,79 @@
 #include "RawFileHandler.h"
+#include "IqArchive.h"
+#include "Kernels.h"
+#include "Tracing.h"
 
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 
-RawFileHandler::RawFileHandler(const std::string& file_path) :
+std::optional<SampleFormat> parse_sample_format(const std::string& value)
+{
+    if (value == "cu8")
+    {
+        return SampleFormat::CU8;
+    }
+    else if (value == "cs16")
+    {
+        return SampleFormat::CS16;
+    }
+    else if (value == "cf32")
+    {
+        return SampleFormat::CF32;
+    }
+
+    return std::nullopt;
+}
+
+void convert_samples(SampleFormat sample_format, const uint8_t raw_samples[], std::complex<float> samples[], int length)
+{
+    switch (sample_format)
+    {
+    case SampleFormat::CS16:
+        for (int i = 0; i < length; i++)
+        {
+            int16_t values[2];
+            std::memcpy(values, raw_samples + 4 * i, sizeof(values));
+            samples[i] = std::complex<float>(values[0] / 32768.0f, values[1] / 32768.0f);
+        }
+        break;
+    case SampleFormat::CF32:
+        std::memcpy(samples, raw_samples, length * sizeof(std::complex<float>));
+        break;
+    default:
+        // The IQ data of the type uint8_t contains a DC which is removed.
+        Kernels::get().convert_cu8_samples(raw_samples, samples, length);
+        break;
+    }
+}
+
+std::unique_ptr<SampleSource> open_sample_file(const std::string& file_path, SampleFormat sample_format)
+{
+    if (IqArchive::is_archive(file_path))
+    {
+        return std::make_unique<IqArchiveReader>(file_path);
+    }
+
+    return std::make_unique<RawFileHandler>(file_path, sample_format);
+}
+
+int64_t get_number_of_file_samples(const std::string& file_path, SampleFormat sample_format)
+{
+    if (IqArchive::is_archive(file_path))
+    {
+        return IqArchiveReader(file_path).get_number_of_samples();
+    }
+
+    auto error_code{ std::error_code() };
+    auto file_size = std::filesystem::file_size(file_path, error_code);
+    return error_code ? -1 : static_cast<int64_t>(file_size) / RawFileHandler::get_bytes_per_sample(sample_format);
+}
+
+// The buffer size is a multiple of the number of bytes per sample of every sample format.
+RawFileHandler::RawFileHandler(const std::string& file_path, SampleFormat sample_format) :
+    m_sample_format(sample_format),
+    m_bytes_per_sample(get_bytes_per_sample(sample_format)),
     m_ifstream(std::ifstream(file_path, std::ios_base::binary)),
     m_buffer_index(BUFFER_SIZE),
     m_raw_iq_buffer(BUFFER_SIZE),
@@ -16,8 +87,10 @@ RawFileHandler::~RawFileHandler()
     m_ifstream.close();
 }
 
-void RawFileHandler::read(Eigen::VectorXcf& output, int start_index, int stop_index)
+void RawFileHandler::read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index)
 {
+    auto span{ Tracing::ScopedSpan("RawFileHandler::read") };
+
     if (start_index > stop_index)
     {
         return;
@@ -28,7 +101,9 @@ void RawFileHandler::read(Eigen::VectorXcf& output, int start_index, int stop_in
         return;
     }
 
-    for (int i = start_index; i <= stop_index; i++)
+    // The samples are converted in runs up to the end of the buffer.
+    auto i = start_index;
+    while (i <= stop_index)
     {
         if (m_buffer_index >= BUFFER_SIZE)
         {
@@ -45,12 +120,24 @@ void RawFileHandler::read(Eigen::VectorXcf& output, int start_index, int stop_in
             }
         }
 
-        auto real = m_raw_iq_buffer[m_buffer_index++];
-        auto imag = m_raw_iq_buffer[m_buffer_index++];
+        auto length = std::min(stop_index - i + 1, (BUFFER_SIZE - m_buffer_index) / m_bytes_per_sample);
+        convert_samples(m_sample_format, m_raw_iq_buffer.data() + m_buffer_index, output.data() + i, length);
 
-        // The IQ data is expected to be of the type uint8_t.
-        // So we remove the DC and scale it.
-        output[i] = std::complex<float>((real - 128.0f) / 128.0f, (imag - 128.0f) / 128.0f);
+        i = i + length;
+        m_buffer_index = m_buffer_index + length * m_bytes_per_sample;
+    }
+}
+
+int RawFileHandler::get_bytes_per_sample(SampleFormat sample_format)
+{
+    switch (sample_format)
+    {
+    case SampleFormat::CS16:
+        return 2 * sizeof(int16_t);
+    case SampleFormat::CF32:
+        return 2 * sizeof(float);
+    default:
+        return 2 * sizeof(uint8_t);
     }
 }
 
@@ -58,3 +145,23 @@ bool RawFileHandler::get_file_end_reached()
 {
     return m_file_end_reached;
 }
+
+void RawFileHandler::skip(int64_t number_of_samples)
+{
+    if (m_file_end_reached || number_of_samples <= 0)
+    {
+        return;
+    }
+
+    // The samples which are left in the buffer are skipped first.
+    auto number_of_buffered_samples = (BUFFER_SIZE - m_buffer_index) / m_bytes_per_sample;
+    if (number_of_samples <= number_of_buffered_samples)
+    {
+        m_buffer_index = m_buffer_index + m_bytes_per_sample * static_cast<int>(number_of_samples);
+        return;
+    }
+
+    auto number_of_skipped_bytes = m_bytes_per_sample * (number_of_samples - number_of_buffered_samples);
+    m_ifstream.seekg(number_of_skipped_bytes, std::ios_base::cur);
+    m_buffer_index = BUFFER_SIZE;
+}
\ No newline at end of file
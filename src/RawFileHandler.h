@@ -1,23 +1,62 @@
 #pragma once
 
+#include "SampleSource.h"
+
 #include "Eigen/Dense"
 
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
-class RawFileHandler final
+// The type of I and Q of the raw IQ samples.
+enum class SampleFormat
+{
+    // uint8_t with an offset of 128, e.g. as captured by RTL-SDR sticks.
+    CU8,
+
+    // int16_t, e.g. as captured by wideband recorders.
+    CS16,
+
+    // float.
+    CF32
+};
+
+// Parses the sample format, i.e. cu8, cs16 or cf32.
+std::optional<SampleFormat> parse_sample_format(const std::string& value);
+
+// Converts raw IQ samples of the given sample format to complex samples.
+// The integer formats are scaled to the range [-1, 1).
+void convert_samples(SampleFormat sample_format, const uint8_t raw_samples[], std::complex<float> samples[], int length);
+
+// Opens the file as IQ archive if it is one, see IqArchive.h, and as raw IQ file of the sample format otherwise.
+std::unique_ptr<SampleSource> open_sample_file(const std::string& file_path, SampleFormat sample_format);
+
+// Returns the number of samples of the file which is opened by open_sample_file or -1 if it is unknown.
+int64_t get_number_of_file_samples(const std::string& file_path, SampleFormat sample_format);
+
+class RawFileHandler final : public SampleSource
 {
 public:
-    RawFileHandler(const std::string& file_path);
+    RawFileHandler(const std::string& file_path, SampleFormat sample_format = SampleFormat::CU8);
     ~RawFileHandler();
 
-    void read(Eigen::VectorXcf& output, int start_index, int stop_index);
+    void read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index) override;
+
+    bool get_file_end_reached() override;
+
+    // Returns the number of bytes of I and Q of one sample.
+    static int get_bytes_per_sample(SampleFormat sample_format);
 
-    bool get_file_end_reached();
+    // Skips the next samples by seeking in the file.
+    void skip(int64_t number_of_samples) override;
 
 private:
     const int BUFFER_SIZE = 65536;
 
+    SampleFormat m_sample_format;
+    int m_bytes_per_sample;
     std::ifstream m_ifstream;
     int m_buffer_index;
     std::vector<uint8_t> m_raw_iq_buffer;
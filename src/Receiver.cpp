@@ -0,0 +1,68 @@
+#include "Receiver.h"
+#include "DabConstants.h"
+
+#include <stdexcept>
+
+using namespace DabConstants;
+
+Receiver::Receiver(const ReceiverOptions& options, FicBlockCallback fic_block_callback) :
+    m_options(options),
+    m_push_sample_source(std::make_shared<PushSampleSource>(options.sample_format)),
+    m_resampler(nullptr),
+    m_main_controller(options, std::move(fic_block_callback)),
+    m_thread(),
+    m_is_finished(false),
+    m_has_succeeded(false)
+{
+    if (options.sample_rate != SAMPLE_RATE)
+    {
+        m_resampler = std::make_unique<Resampler>(m_push_sample_source, options.sample_rate, SAMPLE_RATE);
+    }
+
+    m_thread = std::thread([this]()
+    {
+        if (m_resampler != nullptr)
+        {
+            m_has_succeeded = m_main_controller.run(*m_resampler, m_resampler.get());
+        }
+        else
+        {
+            m_has_succeeded = m_main_controller.run(*m_push_sample_source, nullptr);
+        }
+
+        // A push mustn't wait for a receiver which has stopped reading.
+        m_push_sample_source->cancel();
+    });
+}
+
+Receiver::~Receiver()
+{
+    finish();
+}
+
+void Receiver::push(const uint8_t raw_samples[], int number_of_samples)
+{
+    m_push_sample_source->push(raw_samples, number_of_samples);
+}
+
+void Receiver::push(const std::complex<float> samples[], int number_of_samples)
+{
+    if (m_options.sample_format != SampleFormat::CF32)
+    {
+        throw std::logic_error("Complex samples can only be pushed if the sample format is cf32.");
+    }
+
+    m_push_sample_source->push(reinterpret_cast<const uint8_t*>(samples), number_of_samples);
+}
+
+bool Receiver::finish()
+{
+    if (!m_is_finished)
+    {
+        m_push_sample_source->close();
+        m_thread.join();
+        m_is_finished = true;
+    }
+
+    return m_has_succeeded;
+}
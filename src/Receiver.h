@@ -0,0 +1,50 @@
+#pragma once
+
+#include "MainController.h"
+#include "PushSampleSource.h"
+#include "Resampler.h"
+#include "FicHandler.h"
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+// The receiver for embedding it into other applications, e.g. a capture daemon.
+// The caller pushes buffers of samples which it owns, and the decoded FIC blocks are passed to a callback.
+// The receiver runs in its own thread which reads the samples directly from the pushed buffers.
+class Receiver final
+{
+public:
+    // The sample rate and the sample format of the pushed samples are taken from the options.
+    // Since the transmission mode can't be detected from a stream, it is taken from the options (I by default).
+    // The callback is called by the thread of the receiver, i.e. during a push or finish.
+    Receiver(const ReceiverOptions& options, FicBlockCallback fic_block_callback);
+
+    // Finishes the receiver if this wasn't done yet.
+    ~Receiver();
+
+    Receiver(const Receiver&) = delete;
+    Receiver& operator=(const Receiver&) = delete;
+
+    // Passes raw samples in the sample format of the options.
+    // Returns once the receiver has read all of them, so the buffer can be reused afterwards.
+    void push(const uint8_t raw_samples[], int number_of_samples);
+
+    // Passes samples if the sample format of the options is cf32.
+    void push(const std::complex<float> samples[], int number_of_samples);
+
+    // Tells the receiver that the stream has ended and waits until it has processed the remaining samples.
+    // Returns whether the run succeeded.
+    bool finish();
+
+private:
+    ReceiverOptions m_options;
+    std::shared_ptr<PushSampleSource> m_push_sample_source;
+    std::unique_ptr<Resampler> m_resampler;
+    MainController m_main_controller;
+    std::thread m_thread;
+
+    bool m_is_finished;
+    bool m_has_succeeded;
+};
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "ReedSolomon.h"
+
+#include <algorithm>
+
+// The field polynomial x^8 + x^4 + x^3 + x^2 + 1.
+static constexpr int FIELD_POLYNOMIAL = 0x11D;
+
+// The maximum number of erroneous bytes which can be corrected per codeword.
+static constexpr int T = ReedSolomon::N_PARITY / 2;
+
+ReedSolomon::ReedSolomon() :
+    m_exp(),
+    m_log(),
+    m_root_multiplication_tables(),
+    m_generator(),
+    m_kernels(Kernels::get()),
+    m_syndromes()
+{
+    auto value = 1;
+    for (int i = 0; i < 255; i++)
+    {
+        m_exp[i] = static_cast<uint8_t>(value);
+        m_exp[i + 255] = static_cast<uint8_t>(value);
+        m_log[value] = i;
+        value = value << 1;
+        if (value & 0x100)
+        {
+            value = value ^ FIELD_POLYNOMIAL;
+        }
+    }
+    m_log[0] = -1;
+
+    for (int i = 0; i < N_PARITY; i++)
+    {
+        for (int nibble = 0; nibble < 16; nibble++)
+        {
+            m_root_multiplication_tables[32 * i + nibble] = multiply(static_cast<uint8_t>(nibble), m_exp[i]);
+            m_root_multiplication_tables[32 * i + 16 + nibble] = multiply(static_cast<uint8_t>(nibble << 4), m_exp[i]);
+        }
+    }
+
+    // The coefficients of the generator polynomial from the highest to the lowest power.
+    m_generator.fill(0);
+    m_generator[0] = 1;
+    for (int i = 0; i < N_PARITY; i++)
+    {
+        for (int j = i + 1; j > 0; j--)
+        {
+            m_generator[j] = m_generator[j] ^ multiply(m_generator[j - 1], m_exp[i]);
+        }
+    }
+}
+
+uint8_t ReedSolomon::multiply(uint8_t a, uint8_t b) const
+{
+    if (a == 0 || b == 0)
+    {
+        return 0;
+    }
+    return m_exp[m_log[a] + m_log[b]];
+}
+
+uint8_t ReedSolomon::divide(uint8_t a, uint8_t b) const
+{
+    if (a == 0)
+    {
+        return 0;
+    }
+    return m_exp[m_log[a] + 255 - m_log[b]];
+}
+
+// The parity bytes are the remainder of the division of the data polynomial times x^N_PARITY by the generator polynomial.
+void ReedSolomon::encode(uint8_t codeword[], int depth) const
+{
+    auto remainder{ std::array<uint8_t, N_PARITY>() };
+    remainder.fill(0);
+    for (int k = 0; k < K; k++)
+    {
+        auto feedback = codeword[k * depth] ^ remainder[0];
+        std::copy(remainder.begin() + 1, remainder.end(), remainder.begin());
+        remainder[N_PARITY - 1] = 0;
+        for (int i = 0; i < N_PARITY; i++)
+        {
+            remainder[i] = remainder[i] ^ multiply(m_generator[i + 1], feedback);
+        }
+    }
+
+    for (int i = 0; i < N_PARITY; i++)
+    {
+        codeword[(K + i) * depth] = remainder[i];
+    }
+}
+
+// The syndromes of all codewords are calculated at once by the vectorized kernel.
+// Only if any syndrome of a codeword isn't zero, which is rare, the errors are located by the Berlekamp-Massey algorithm.
+int ReedSolomon::decode(uint8_t superframe[], int depth)
+{
+    m_kernels.compute_syndromes(superframe, depth, N, m_root_multiplication_tables.data(), N_PARITY, m_syndromes.data());
+
+    auto number_of_corrected_bytes = 0;
+    auto is_correctable = true;
+    for (int j = 0; j < depth; j++)
+    {
+        auto has_errors = false;
+        for (int i = 0; i < N_PARITY; i++)
+        {
+            has_errors = has_errors || m_syndromes[i * depth + j] != 0;
+        }
+
+        if (!has_errors)
+        {
+            continue;
+        }
+
+        auto number_of_codeword_corrections = correct(superframe, depth, j);
+        if (number_of_codeword_corrections < 0)
+        {
+            is_correctable = false;
+        }
+        else
+        {
+            number_of_corrected_bytes = number_of_corrected_bytes + number_of_codeword_corrections;
+        }
+    }
+
+    return is_correctable ? number_of_corrected_bytes : -1;
+}
+
+// The byte k of the codeword is the coefficient of x^(N - 1 - k), so its error locator is a^(N - 1 - k).
+int ReedSolomon::correct(uint8_t superframe[], int depth, int codeword_index)
+{
+    auto syndromes{ std::array<uint8_t, N_PARITY>() };
+    for (int i = 0; i < N_PARITY; i++)
+    {
+        syndromes[i] = m_syndromes[i * depth + codeword_index];
+    }
+
+    // The Berlekamp-Massey algorithm determines the error locator polynomial (lowest power first).
+    auto locator{ std::array<uint8_t, N_PARITY + 1>() };
+    auto previous_locator{ std::array<uint8_t, N_PARITY + 1>() };
+    locator.fill(0);
+    previous_locator.fill(0);
+    locator[0] = 1;
+    previous_locator[0] = 1;
+    auto number_of_errors = 0;
+    auto shift = 1;
+    auto previous_discrepancy = uint8_t(1);
+
+    for (int n = 0; n < N_PARITY; n++)
+    {
+        auto discrepancy = syndromes[n];
+        for (int i = 1; i <= number_of_errors; i++)
+        {
+            discrepancy = discrepancy ^ multiply(locator[i], syndromes[n - i]);
+        }
+
+        if (discrepancy == 0)
+        {
+            shift++;
+            continue;
+        }
+
+        auto factor = divide(discrepancy, previous_discrepancy);
+        auto updated_locator{ locator };
+        for (int i = 0; i + shift <= N_PARITY; i++)
+        {
+            updated_locator[i + shift] = updated_locator[i + shift] ^ multiply(factor, previous_locator[i]);
+        }
+
+        if (2 * number_of_errors <= n)
+        {
+            previous_locator = locator;
+            number_of_errors = n + 1 - number_of_errors;
+            previous_discrepancy = discrepancy;
+            shift = 1;
+        }
+        else
+        {
+            shift++;
+        }
+        locator = updated_locator;
+    }
+
+    if (number_of_errors > T)
+    {
+        return -1;
+    }
+
+    // The error evaluator polynomial is the product of the syndrome polynomial and the error locator polynomial modulo x^N_PARITY.
+    auto evaluator{ std::array<uint8_t, N_PARITY>() };
+    evaluator.fill(0);
+    for (int i = 0; i < N_PARITY; i++)
+    {
+        for (int j = 0; j <= std::min(i, number_of_errors); j++)
+        {
+            evaluator[i] = evaluator[i] ^ multiply(syndromes[i - j], locator[j]);
+        }
+    }
+
+    // The Chien search only covers the positions of the shortened codeword.
+    auto error_positions{ std::array<int, T>() };
+    auto error_values{ std::array<uint8_t, T>() };
+    auto number_of_found_errors = 0;
+    for (int k = 0; k < N; k++)
+    {
+        auto power = N - 1 - k;
+        auto inverse_locator_log = (255 - power) % 255;
+
+        auto locator_value = uint8_t(0);
+        for (int i = 0; i <= number_of_errors; i++)
+        {
+            if (locator[i] != 0)
+            {
+                locator_value = locator_value ^ m_exp[(m_log[locator[i]] + i * inverse_locator_log) % 255];
+            }
+        }
+
+        if (locator_value != 0)
+        {
+            continue;
+        }
+
+        if (number_of_found_errors == number_of_errors)
+        {
+            return -1;
+        }
+
+        // Forney's algorithm for the first consecutive root a^0: e = X * evaluator(X^-1) / locator'(X^-1).
+        auto evaluator_value = uint8_t(0);
+        for (int i = 0; i < N_PARITY; i++)
+        {
+            if (evaluator[i] != 0)
+            {
+                evaluator_value = evaluator_value ^ m_exp[(m_log[evaluator[i]] + i * inverse_locator_log) % 255];
+            }
+        }
+
+        auto derivative_value = uint8_t(0);
+        for (int i = 1; i <= number_of_errors; i += 2)
+        {
+            if (locator[i] != 0)
+            {
+                derivative_value = derivative_value ^ m_exp[(m_log[locator[i]] + (i - 1) * inverse_locator_log) % 255];
+            }
+        }
+
+        if (derivative_value == 0)
+        {
+            return -1;
+        }
+
+        error_positions[number_of_found_errors] = k;
+        error_values[number_of_found_errors] = multiply(m_exp[power], divide(evaluator_value, derivative_value));
+        number_of_found_errors++;
+    }
+
+    if (number_of_found_errors != number_of_errors)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < number_of_found_errors; i++)
+    {
+        auto& byte = superframe[error_positions[i] * depth + codeword_index];
+        byte = byte ^ error_values[i];
+    }
+
+    return number_of_found_errors;
+}
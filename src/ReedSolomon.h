@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Kernels.h"
+
+#include <array>
+#include <cstdint>
+
+// The Reed-Solomon code RS(120, 110) which protects the DAB+ audio superframes,
+// see section 6 of ETSI TS 102 563 V2.1.1.
+// It is shortened from RS(255, 245) over GF(2^8) with the field polynomial x^8 + x^4 + x^3 + x^2 + 1
+// and the generator polynomial (x + a^0) * (x + a^1) * ... * (x + a^9) where a is 2.
+// It corrects up to 5 erroneous bytes per codeword.
+class ReedSolomon final
+{
+public:
+    static constexpr int N = 120;
+    static constexpr int K = 110;
+    static constexpr int N_PARITY = N - K;
+
+    ReedSolomon();
+
+    // Calculates the parity bytes of one codeword from its data bytes, e.g. for tests.
+    // The byte k of the codeword is codeword[k * depth].
+    void encode(uint8_t codeword[], int depth) const;
+
+    // Corrects the depth codewords which are interleaved in the superframe,
+    // i.e. the byte k of the codeword j is superframe[k * depth + j].
+    // Returns the number of corrected bytes or -1 if any codeword couldn't be corrected.
+    // The codewords which couldn't be corrected are left unchanged.
+    int decode(uint8_t superframe[], int depth);
+
+    // The largest depth, i.e. a subchannel of 24 * 8 kbit/s.
+    static constexpr int MAX_DEPTH = 24;
+
+private:
+    // Returns the number of corrected bytes of the codeword or -1 if it couldn't be corrected.
+    int correct(uint8_t superframe[], int depth, int codeword_index);
+
+    uint8_t multiply(uint8_t a, uint8_t b) const;
+    uint8_t divide(uint8_t a, uint8_t b) const;
+
+    // a^i for i from 0 to 509 so that the sum of two logarithms needs no modulo.
+    std::array<uint8_t, 2 * 255> m_exp;
+    std::array<int, 256> m_log;
+
+    // For each root a^i of the generator polynomial, the products of a^i and the 16 values of the low nibble
+    // are followed by the products of a^i and the 16 values of the high nibble.
+    std::array<uint8_t, N_PARITY * 32> m_root_multiplication_tables;
+
+    std::array<uint8_t, N_PARITY + 1> m_generator;
+
+    const Kernels::KernelTable& m_kernels;
+
+    // The syndromes of every codeword, see Kernels::KernelTable::compute_syndromes.
+    std::array<uint8_t, N_PARITY * MAX_DEPTH> m_syndromes;
+};
\ No newline at end of file
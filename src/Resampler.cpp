@@ -0,0 +1,224 @@
+#include "Resampler.h"
+#include "FilterDesign.h"
+#include "Tracing.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <algorithm>
+
+// The cutoff frequency of the anti-aliasing filter in Hz.
+// It lies between the highest carrier of a DAB signal at 768 kHz and
+// the Nyquist frequency of the receiver at 1024 kHz.
+static constexpr double CUTOFF_FREQUENCY = 920'000.0;
+
+Resampler::Resampler(std::shared_ptr<SampleSource> input_sample_source, double input_sample_rate, double output_sample_rate) :
+    m_input_sample_source(std::move(input_sample_source)),
+    m_nominal_ratio(input_sample_rate / output_sample_rate),
+    m_sample_clock_offset(0.0),
+    m_coefficients(create_coefficients(input_sample_rate, output_sample_rate)),
+    m_input_block(INPUT_BLOCK_SIZE),
+    m_input_real(Eigen::VectorXf::Zero(N_TAPS + INPUT_BLOCK_SIZE)),
+    m_input_imag(Eigen::VectorXf::Zero(N_TAPS + INPUT_BLOCK_SIZE)),
+    m_input_length(N_TAPS - 1),
+    m_time(static_cast<uint64_t>(N_TAPS - 1) << FRACTIONAL_BITS),
+    m_time_step(0),
+    m_number_of_discarded_samples(0),
+    m_number_of_output_samples(0),
+    m_time_segments(),
+    m_time_segment_index(0),
+    m_number_of_time_segments(0),
+    m_file_end_reached(false)
+{
+    update_time_step();
+}
+
+// The prototype filter is a windowed sinc filter for the input sample rate upsampled by N_PHASES.
+Eigen::MatrixXf Resampler::create_coefficients(double input_sample_rate, double output_sample_rate)
+{
+    auto cutoff = std::min(CUTOFF_FREQUENCY, 0.45 * std::min(input_sample_rate, output_sample_rate)) / (N_PHASES * input_sample_rate);
+    auto prototype{ FilterDesign::create_kaiser_lowpass(N_PHASES * N_TAPS, cutoff) };
+
+    // Each phase should have a gain of 1.
+    prototype = prototype * (N_PHASES / prototype.sum());
+
+    auto coefficients{ Eigen::MatrixXf(N_TAPS, N_PHASES) };
+    for (int phase = 0; phase < N_PHASES; phase++)
+    {
+        for (int tap = 0; tap < N_TAPS; tap++)
+        {
+            coefficients(tap, phase) = static_cast<float>(prototype[(N_TAPS - 1 - tap) * N_PHASES + phase]);
+        }
+    }
+
+    return coefficients;
+}
+
+void Resampler::set_sample_clock_offset(double sample_clock_offset)
+{
+    m_sample_clock_offset = sample_clock_offset;
+    update_time_step();
+}
+
+double Resampler::get_sample_clock_offset() const
+{
+    return m_sample_clock_offset;
+}
+
+void Resampler::update_time_step()
+{
+    auto ratio = m_nominal_ratio * (1.0 + m_sample_clock_offset);
+    m_time_step = static_cast<uint64_t>(std::llround(std::ldexp(ratio, FRACTIONAL_BITS)));
+    add_time_segment();
+}
+
+// The input sample 0 follows the initial history at the position N_TAPS - 1 of the input buffers.
+ResamplerPosition Resampler::get_current_input_position() const
+{
+    auto input_sample_index = static_cast<int64_t>(m_time >> FRACTIONAL_BITS) + m_number_of_discarded_samples - (N_TAPS - 1);
+    return ResamplerPosition{ input_sample_index, static_cast<uint32_t>(m_time) };
+}
+
+void Resampler::add_time_segment()
+{
+    if (m_number_of_time_segments > 0)
+    {
+        m_time_segment_index = (m_time_segment_index + 1) % N_TIME_SEGMENTS;
+    }
+    m_number_of_time_segments = std::min(m_number_of_time_segments + 1, N_TIME_SEGMENTS);
+    m_time_segments[m_time_segment_index] = TimeSegment{ m_number_of_output_samples, get_current_input_position(), m_time_step };
+}
+
+// The time is advanced from the newest segment which starts at or before the output sample.
+// The product of the number of output samples and the time step fits into 64 bits for segments of far more than a frame.
+ResamplerPosition Resampler::get_input_position(int64_t output_sample_index) const
+{
+    auto segment_index = m_time_segment_index;
+    for (int i = 1; i < m_number_of_time_segments && m_time_segments[segment_index].first_output_sample_index > output_sample_index; i++)
+    {
+        segment_index = (segment_index + N_TIME_SEGMENTS - 1) % N_TIME_SEGMENTS;
+    }
+
+    const auto& segment = m_time_segments[segment_index];
+    auto advance = static_cast<uint64_t>(output_sample_index - segment.first_output_sample_index) * segment.time_step;
+    auto fraction = static_cast<uint64_t>(segment.first_input_position.fraction) + (advance & 0xFFFFFFFF);
+    auto input_sample_index = segment.first_input_position.input_sample_index + static_cast<int64_t>(advance >> FRACTIONAL_BITS) + static_cast<int64_t>(fraction >> FRACTIONAL_BITS);
+    return ResamplerPosition{ input_sample_index, static_cast<uint32_t>(fraction) };
+}
+
+void Resampler::skip(int64_t number_of_samples)
+{
+    if (number_of_samples <= 0 || m_file_end_reached)
+    {
+        return;
+    }
+
+    move_to(get_input_position(m_number_of_output_samples + number_of_samples));
+    m_number_of_output_samples = m_number_of_output_samples + number_of_samples;
+}
+
+// The time segments before are dropped since their output samples don't continue at the new position.
+void Resampler::seek(int64_t output_sample_index, const ResamplerPosition& input_position)
+{
+    move_to(input_position);
+    m_number_of_output_samples = output_sample_index;
+    m_number_of_time_segments = 0;
+    add_time_segment();
+}
+
+// If the filter window of the position still starts within the input buffers, only the time is moved.
+// Otherwise, the input sample source is skipped to the start of the window and the input buffers are refilled by the next read.
+void Resampler::move_to(const ResamplerPosition& input_position)
+{
+    auto buffer_start_index = m_number_of_discarded_samples - (N_TAPS - 1);
+    auto next_input_sample_index = buffer_start_index + m_input_length;
+    auto window_start_index = input_position.input_sample_index - (N_TAPS - 1);
+    if (window_start_index < next_input_sample_index)
+    {
+        m_time = (static_cast<uint64_t>(std::max<int64_t>(input_position.input_sample_index - buffer_start_index, N_TAPS - 1)) << FRACTIONAL_BITS) | input_position.fraction;
+        return;
+    }
+
+    m_input_sample_source->skip(window_start_index - next_input_sample_index);
+    if (m_input_sample_source->get_file_end_reached())
+    {
+        m_file_end_reached = true;
+        return;
+    }
+
+    m_number_of_discarded_samples = window_start_index + (N_TAPS - 1);
+    m_input_length = 0;
+    m_time = (static_cast<uint64_t>(N_TAPS - 1) << FRACTIONAL_BITS) | input_position.fraction;
+}
+
+// Each output sample is the dot product between the last N_TAPS input samples and one filter phase.
+// The real and imaginary parts are stored separately so that these dot products are vectorized.
+void Resampler::read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index)
+{
+    auto span{ Tracing::ScopedSpan("Resampler::read") };
+
+    if (start_index > stop_index)
+    {
+        return;
+    }
+
+    if (m_file_end_reached)
+    {
+        return;
+    }
+
+    for (int i = start_index; i <= stop_index; i++)
+    {
+        auto input_index = static_cast<int>(m_time >> FRACTIONAL_BITS);
+        if (input_index >= m_input_length)
+        {
+            refill_input_buffers();
+            if (m_file_end_reached)
+            {
+                return;
+            }
+            input_index = static_cast<int>(m_time >> FRACTIONAL_BITS);
+        }
+
+        auto phase = static_cast<int>((m_time >> (FRACTIONAL_BITS - PHASE_BITS)) & (N_PHASES - 1));
+        auto window_start_index = input_index - (N_TAPS - 1);
+
+        auto coefficients = m_coefficients.col(phase);
+        auto real = Eigen::Map<const Eigen::Matrix<float, N_TAPS, 1>>(m_input_real.data() + window_start_index).dot(coefficients);
+        auto imag = Eigen::Map<const Eigen::Matrix<float, N_TAPS, 1>>(m_input_imag.data() + window_start_index).dot(coefficients);
+        output[i] = std::complex<float>(real, imag);
+
+        m_time += m_time_step;
+        m_number_of_output_samples++;
+    }
+}
+
+// Keeps the last N_TAPS - 1 input samples needed by the next output sample as history
+// and appends the next block of the input sample source.
+void Resampler::refill_input_buffers()
+{
+    auto input_index = static_cast<int>(m_time >> FRACTIONAL_BITS);
+    auto discarded_length = std::min(input_index - (N_TAPS - 1), m_input_length);
+    auto kept_length = m_input_length - discarded_length;
+
+    // The history is moved to the front in place because evaluating the overlapping segments would allocate a temporary.
+    std::copy(m_input_real.data() + discarded_length, m_input_real.data() + m_input_length, m_input_real.data());
+    std::copy(m_input_imag.data() + discarded_length, m_input_imag.data() + m_input_length, m_input_imag.data());
+    m_time -= static_cast<uint64_t>(discarded_length) << FRACTIONAL_BITS;
+    m_number_of_discarded_samples = m_number_of_discarded_samples + discarded_length;
+
+    m_input_sample_source->read(m_input_block, 0, INPUT_BLOCK_SIZE - 1);
+    if (m_input_sample_source->get_file_end_reached())
+    {
+        m_file_end_reached = true;
+        return;
+    }
+
+    m_input_real.segment(kept_length, INPUT_BLOCK_SIZE) = m_input_block.real();
+    m_input_imag.segment(kept_length, INPUT_BLOCK_SIZE) = m_input_block.imag();
+    m_input_length = kept_length + INPUT_BLOCK_SIZE;
+}
+
+bool Resampler::get_file_end_reached()
+{
+    return m_file_end_reached;
+}
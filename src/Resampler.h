@@ -0,0 +1,123 @@
+#pragma once
+
+#include "SampleSource.h"
+
+#include "Eigen/Dense"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// A time in the samples of the input of a resampler, e.g. the position of a frame in a file at another sample rate.
+struct ResamplerPosition
+{
+    int64_t input_sample_index;
+
+    // The fraction of an input sample in units of 2^-32.
+    uint32_t fraction;
+};
+
+// Resamples the samples of another sample source to the sample rate of the receiver
+// by a polyphase FIR filter.
+// Since the phase of the filter is determined by a fixed-point time accumulator,
+// rational ratios like 2.048 / 2.4 are resampled exactly and
+// any other ratio is resampled by the filter phase at or before the exact time,
+// i.e. the time is truncated to a multiple of 1 / N_PHASES input samples.
+class Resampler final : public SampleSource
+{
+public:
+    // The input sample source may be shared with a producer, e.g. the channelizer.
+    Resampler(std::shared_ptr<SampleSource> input_sample_source, double input_sample_rate, double output_sample_rate);
+
+    void read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index) override;
+
+    bool get_file_end_reached() override;
+
+    // Fine-tunes the resampling ratio to compensate the given relative deviation of the input sample clock,
+    // i.e. the actual input sample rate is input_sample_rate * (1 + sample_clock_offset).
+    void set_sample_clock_offset(double sample_clock_offset);
+
+    double get_sample_clock_offset() const;
+
+    // Skips the next output samples by seeking the input sample source instead of resampling them.
+    void skip(int64_t number_of_samples) override;
+
+    // Returns the input position of an output sample since the creation of the resampler.
+    // The output sample may lie before the current one as long as the resampling ratio was changed
+    // at most N_TIME_SEGMENTS - 1 times since it, e.g. once per frame.
+    ResamplerPosition get_input_position(int64_t output_sample_index) const;
+
+    // Continues at the given input position, e.g. of a frame index, whose output sample gets the given index.
+    // The input position must not lie before the input which is still buffered, since the input is only skipped forward.
+    void seek(int64_t output_sample_index, const ResamplerPosition& input_position);
+
+private:
+    // The number of filter phases is 2 to the power of PHASE_BITS.
+    static constexpr int PHASE_BITS = 8;
+    static constexpr int N_PHASES = 1 << PHASE_BITS;
+
+    // The number of filter taps per phase.
+    static constexpr int N_TAPS = 64;
+
+    // The number of input samples which are read at once.
+    static constexpr int INPUT_BLOCK_SIZE = 16'384;
+
+    // The number of fractional bits of the time accumulator.
+    static constexpr int FRACTIONAL_BITS = 32;
+
+    // The number of the last resampling ratios whose output samples are mapped to input positions.
+    static constexpr int N_TIME_SEGMENTS = 4;
+
+    // The output samples from the first one on are resampled by the same time step.
+    struct TimeSegment
+    {
+        int64_t first_output_sample_index;
+        ResamplerPosition first_input_position;
+        uint64_t time_step;
+    };
+
+    // Creates the coefficients of all filter phases.
+    // The coefficients of each phase are stored in reverse order
+    // so that they can be multiplied with consecutive input samples.
+    static Eigen::MatrixXf create_coefficients(double input_sample_rate, double output_sample_rate);
+
+    void update_time_step();
+    void refill_input_buffers();
+
+    ResamplerPosition get_current_input_position() const;
+
+    // Starts a new time segment at the current output sample.
+    void add_time_segment();
+
+    // Moves the time of the next output sample to the given input position.
+    void move_to(const ResamplerPosition& input_position);
+
+    std::shared_ptr<SampleSource> m_input_sample_source;
+    double m_nominal_ratio;
+    double m_sample_clock_offset;
+
+    // Each column contains the coefficients of one filter phase.
+    Eigen::MatrixXf m_coefficients;
+
+    Eigen::VectorXcf m_input_block;
+    Eigen::VectorXf m_input_real;
+    Eigen::VectorXf m_input_imag;
+    int m_input_length;
+
+    // The time of the next output sample in input samples relative to the start of the input buffers.
+    uint64_t m_time;
+    uint64_t m_time_step;
+
+    // The number of input samples which were dropped from the front of the input buffers.
+    // The initial history of N_TAPS - 1 zeros is counted, too.
+    int64_t m_number_of_discarded_samples;
+
+    int64_t m_number_of_output_samples;
+
+    // The time segments are a ring whose newest entry is at m_time_segment_index.
+    std::array<TimeSegment, N_TIME_SEGMENTS> m_time_segments;
+    int m_time_segment_index;
+    int m_number_of_time_segments;
+
+    bool m_file_end_reached;
+};
\ No newline at end of file
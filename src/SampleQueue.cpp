@@ -0,0 +1,99 @@
+#include "SampleQueue.h"
+
+#include <algorithm>
+
+SampleQueue::SampleQueue(int capacity) :
+    m_buffer(capacity),
+    m_read_index(0),
+    m_size(0),
+    m_is_closed(false),
+    m_is_cancelled(false),
+    m_file_end_reached(false)
+{
+
+}
+
+void SampleQueue::push(const std::complex<float> samples[], int length)
+{
+    auto capacity = static_cast<int>(m_buffer.size());
+    auto pushed_length = 0;
+
+    while (pushed_length < length)
+    {
+        auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+        m_not_full.wait(lock, [this, capacity] { return m_size < capacity || m_is_cancelled; });
+        if (m_is_cancelled)
+        {
+            return;
+        }
+
+        // The free part of the ring buffer is filled up to its end at most.
+        auto write_index = (m_read_index + m_size) % capacity;
+        auto chunk_length = std::min({ length - pushed_length, capacity - m_size, capacity - write_index });
+        std::copy(samples + pushed_length, samples + pushed_length + chunk_length, m_buffer.data() + write_index);
+        m_size = m_size + chunk_length;
+        pushed_length = pushed_length + chunk_length;
+
+        lock.unlock();
+        m_not_empty.notify_one();
+    }
+}
+
+void SampleQueue::close()
+{
+    {
+        auto lock{ std::lock_guard<std::mutex>(m_mutex) };
+        m_is_closed = true;
+    }
+    m_not_empty.notify_one();
+}
+
+void SampleQueue::cancel()
+{
+    {
+        auto lock{ std::lock_guard<std::mutex>(m_mutex) };
+        m_is_cancelled = true;
+    }
+    m_not_full.notify_one();
+}
+
+void SampleQueue::read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index)
+{
+    if (start_index > stop_index)
+    {
+        return;
+    }
+
+    if (m_file_end_reached)
+    {
+        return;
+    }
+
+    auto capacity = static_cast<int>(m_buffer.size());
+    auto read_index = start_index;
+
+    while (read_index <= stop_index)
+    {
+        auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+        m_not_empty.wait(lock, [this] { return m_size > 0 || m_is_closed; });
+        if (m_size == 0)
+        {
+            m_file_end_reached = true;
+            return;
+        }
+
+        auto chunk_length = std::min({ stop_index - read_index + 1, m_size, capacity - m_read_index });
+        std::copy(m_buffer.data() + m_read_index, m_buffer.data() + m_read_index + chunk_length, output.data() + read_index);
+        m_read_index = (m_read_index + chunk_length) % capacity;
+        m_size = m_size - chunk_length;
+        read_index = read_index + chunk_length;
+
+        lock.unlock();
+        m_not_full.notify_one();
+    }
+}
+
+bool SampleQueue::get_file_end_reached()
+{
+    return m_file_end_reached;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "SampleSource.h"
+
+#include "Eigen/Dense"
+
+#include <condition_variable>
+#include <mutex>
+
+// A bounded first-in-first-out queue of samples between a producer thread and a consumer thread.
+// The consumer reads the samples as sample source.
+class SampleQueue final : public SampleSource
+{
+public:
+    SampleQueue(int capacity);
+
+    // Appends the samples and waits while the queue is full.
+    // If the consumer has stopped, the samples are discarded.
+    void push(const std::complex<float> samples[], int length);
+
+    // Tells the consumer that no more samples will be pushed.
+    void close();
+
+    // Tells the producer that no more samples will be read.
+    void cancel();
+
+    void read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index) override;
+
+    bool get_file_end_reached() override;
+
+private:
+    Eigen::VectorXcf m_buffer;
+    int m_read_index;
+    int m_size;
+
+    bool m_is_closed;
+    bool m_is_cancelled;
+    bool m_file_end_reached;
+
+    std::mutex m_mutex;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+};
\ No newline at end of file
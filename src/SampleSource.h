@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Eigen/Dense"
+
+#include <algorithm>
+#include <cstdint>
+
+// A source of complex baseband samples at the sample rate of the receiver.
+class SampleSource
+{
+public:
+    virtual ~SampleSource() = default;
+
+    // Fills the output from start_index to stop_index (both inclusive) with the next samples.
+    virtual void read(Eigen::Ref<Eigen::VectorXcf> output, int start_index, int stop_index) = 0;
+
+    virtual bool get_file_end_reached() = 0;
+
+    // Skips the next samples.
+    // By default, they are read into a buffer, which is allocated once, and discarded.
+    virtual void skip(int64_t number_of_samples)
+    {
+        if (m_skip_buffer.size() == 0)
+        {
+            m_skip_buffer.resize(SKIP_BUFFER_SIZE);
+        }
+
+        while (number_of_samples > 0 && !get_file_end_reached())
+        {
+            auto length = static_cast<int>(std::min<int64_t>(number_of_samples, SKIP_BUFFER_SIZE));
+            read(m_skip_buffer, 0, length - 1);
+            number_of_samples = number_of_samples - length;
+        }
+    }
+
+private:
+    static constexpr int SKIP_BUFFER_SIZE = 16'384;
+
+    Eigen::VectorXcf m_skip_buffer;
+};
\ No newline at end of file
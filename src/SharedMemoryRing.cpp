@@ -0,0 +1,224 @@
+#include "SharedMemoryRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The entries follow the header at the alignment of a cache line.
+static size_t get_entries_offset()
+{
+    return ((sizeof(SharedMemoryRingHeader) + 63) / 64) * 64;
+}
+
+SharedMemoryPublisher::SharedMemoryPublisher(const std::string& name, int number_of_slots) :
+    m_name(name),
+    m_memory(nullptr),
+    m_size(get_entries_offset() + static_cast<size_t>(number_of_slots) * sizeof(SharedMemoryEntry)),
+    m_header(nullptr),
+    m_entries(nullptr),
+    m_sequence(0)
+{
+#if !defined(_WIN32)
+    // A former ring of the same name is unlinked instead of truncated,
+    // so its subscribers keep their mapping until they attach again.
+    shm_unlink(name.c_str());
+    auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(m_size)) != 0)
+    {
+        close(fd);
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    auto memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    // The new object is zeroed, so all entries are invalid until they are published.
+    // The magic number is written last, so a subscriber doesn't accept a half initialized header.
+    m_memory = memory;
+    m_header = static_cast<SharedMemoryRingHeader*>(memory);
+    m_entries = reinterpret_cast<SharedMemoryEntry*>(static_cast<uint8_t*>(memory) + get_entries_offset());
+    m_header->version = SharedMemoryRingHeader::VERSION;
+    m_header->number_of_slots = static_cast<uint32_t>(number_of_slots);
+    m_header->entry_size = sizeof(SharedMemoryEntry);
+    m_header->last_sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = SharedMemoryRingHeader::MAGIC;
+#endif
+}
+
+// The name is removed, but subscribers which are attached can still read the last entries.
+SharedMemoryPublisher::~SharedMemoryPublisher()
+{
+#if !defined(_WIN32)
+    if (m_memory != nullptr)
+    {
+        munmap(m_memory, m_size);
+        shm_unlink(m_name.c_str());
+    }
+#endif
+}
+
+bool SharedMemoryPublisher::is_open() const
+{
+    return m_memory != nullptr;
+}
+
+// The release fence orders the invalidation before the writes of the entry,
+// so a subscriber which has seen any of them also sees that the entry is invalid.
+SharedMemoryEntry& SharedMemoryPublisher::begin_entry()
+{
+    auto& entry = m_entries[m_sequence % m_header->number_of_slots];
+    entry.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return entry;
+}
+
+void SharedMemoryPublisher::publish()
+{
+    auto& entry = m_entries[m_sequence % m_header->number_of_slots];
+    entry.publish_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    m_sequence++;
+    entry.sequence.store(m_sequence, std::memory_order_release);
+    m_header->last_sequence.store(m_sequence, std::memory_order_release);
+}
+
+uint64_t SharedMemoryPublisher::get_number_of_entries() const
+{
+    return m_sequence;
+}
+
+SharedMemorySubscriber::SharedMemorySubscriber(const std::string& name) :
+    m_memory(nullptr),
+    m_size(0),
+    m_header(nullptr),
+    m_entries(nullptr),
+    m_next_sequence(1),
+    m_number_of_lost_entries(0)
+{
+#if !defined(_WIN32)
+    auto fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0 || static_cast<size_t>(file_status.st_size) < get_entries_offset())
+    {
+        close(fd);
+        return;
+    }
+
+    auto memory = mmap(nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return;
+    }
+
+    m_memory = memory;
+    m_size = static_cast<size_t>(file_status.st_size);
+
+    auto header = static_cast<const SharedMemoryRingHeader*>(memory);
+    if (header->magic != SharedMemoryRingHeader::MAGIC
+        || header->version != SharedMemoryRingHeader::VERSION
+        || header->entry_size != sizeof(SharedMemoryEntry)
+        || header->number_of_slots == 0
+        || get_entries_offset() + static_cast<size_t>(header->number_of_slots) * sizeof(SharedMemoryEntry) > m_size)
+    {
+        return;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    m_header = header;
+    m_entries = reinterpret_cast<const SharedMemoryEntry*>(static_cast<const uint8_t*>(memory) + get_entries_offset());
+    m_next_sequence = m_header->last_sequence.load(std::memory_order_acquire) + 1;
+#endif
+}
+
+SharedMemorySubscriber::~SharedMemorySubscriber()
+{
+#if !defined(_WIN32)
+    if (m_memory != nullptr)
+    {
+        munmap(m_memory, m_size);
+    }
+#endif
+}
+
+bool SharedMemorySubscriber::is_valid() const
+{
+    return m_header != nullptr;
+}
+
+// The entry is only accepted if its sequence number is the expected one both before and after the copy.
+// Otherwise, the publisher has overwritten it meanwhile, i.e. it is at least a whole ring ahead.
+SharedMemorySubscriber::Result SharedMemorySubscriber::read(SharedMemoryEntry& entry)
+{
+    if (m_header == nullptr)
+    {
+        return Result::NO_ENTRY;
+    }
+
+    auto last_sequence = m_header->last_sequence.load(std::memory_order_acquire);
+    if (last_sequence < m_next_sequence)
+    {
+        return Result::NO_ENTRY;
+    }
+
+    const auto& slot = m_entries[(m_next_sequence - 1) % m_header->number_of_slots];
+    auto sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == m_next_sequence)
+    {
+        entry.type = slot.type;
+        entry.frame_number = slot.frame_number;
+        entry.index = slot.index;
+        entry.number_of_errors = slot.number_of_errors;
+        entry.flags = slot.flags;
+        entry.size = std::min<uint32_t>(slot.size, sizeof(entry.data));
+        entry.frame_time = slot.frame_time;
+        entry.publish_time = slot.publish_time;
+        std::memcpy(entry.data, slot.data, entry.size);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            entry.sequence.store(sequence, std::memory_order_relaxed);
+            m_next_sequence++;
+            return Result::ENTRY;
+        }
+    }
+
+    // The oldest entry which is kept may be being overwritten already, so the one after it is read next.
+    // The last sequence number is read again since the publisher may have gone on meanwhile.
+    auto number_of_slots = m_header->number_of_slots;
+    last_sequence = m_header->last_sequence.load(std::memory_order_acquire);
+    auto next_sequence = std::max(m_next_sequence + 1, last_sequence > number_of_slots ? last_sequence - number_of_slots + 2 : 1);
+    m_number_of_lost_entries = m_number_of_lost_entries + (next_sequence - m_next_sequence);
+    m_next_sequence = next_sequence;
+    return Result::OVERRUN;
+}
+
+uint64_t SharedMemorySubscriber::get_number_of_lost_entries() const
+{
+    return m_number_of_lost_entries;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class SharedMemoryEntryType : uint32_t
+{
+    // The FIBs of a FIC block, see FicHandler. The index is the one of the CIF within the DAB frame.
+    FIC_BLOCK = 1,
+
+    // A frame of a subchannel of the MSC, e.g. a DAB+ superframe. The index is the subchannel ID.
+    SUBCHANNEL_FRAME = 2
+};
+
+struct SharedMemoryEntry
+{
+    // The sequence numbers of the entries start at 1. It is 0 while the entry is being written.
+    std::atomic<uint64_t> sequence;
+
+    SharedMemoryEntryType type;
+    int32_t frame_number;
+    int32_t index;
+
+    // The number of error bits, e.g. of the Viterbi decoding of a FIC block.
+    int32_t number_of_errors;
+
+    // IS_CACHED if a FIC block was taken from the cache of recently decoded FIC blocks.
+    uint32_t flags;
+
+    // The number of valid bytes of the data.
+    uint32_t size;
+
+    // The start of the DAB frame in nanoseconds since the start of the stream.
+    int64_t frame_time;
+
+    // The wall clock time of the publication in nanoseconds since the Unix epoch, e.g. to measure the latency.
+    int64_t publish_time;
+
+    // The FIBs of a FIC block are packed into bytes with the first bit as the most significant one.
+    uint8_t data[4096];
+
+    static constexpr uint32_t IS_CACHED = 1;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The sequence numbers must be lock-free to be shared between processes.");
+
+struct SharedMemoryRingHeader
+{
+    // Identifies the layout of the ring, so subscribers don't misinterpret a ring of another version.
+    uint32_t magic;
+    uint32_t version;
+    uint32_t number_of_slots;
+    uint32_t entry_size;
+
+    // The sequence number of the last published entry. It is on its own cache line since only it changes.
+    alignas(64) std::atomic<uint64_t> last_sequence;
+
+    static constexpr uint32_t MAGIC = 0x52424144;
+    static constexpr uint32_t VERSION = 1;
+};
+
+// A ring of entries in POSIX shared memory by which the receiver publishes its decoded output to local processes,
+// e.g. a logger, an audio decoder or a monitor, without them parsing the text output.
+// The receiver is the single producer, and any number of subscribers attach read-only.
+// Every entry is guarded by its sequence number like a sequence lock: the publisher invalidates it before writing it
+// and stamps it afterwards, and a subscriber validates that it is unchanged after copying the entry.
+// So the publisher never waits for the subscribers, and a subscriber which falls behind by more than the ring
+// only loses the overwritten entries.
+// All numbers are stored in the byte order of the host.
+class SharedMemoryPublisher final
+{
+public:
+    // Creates the shared memory object of the given name, e.g. /dab, or replaces an existing one.
+    SharedMemoryPublisher(const std::string& name, int number_of_slots);
+    ~SharedMemoryPublisher();
+
+    SharedMemoryPublisher(const SharedMemoryPublisher&) = delete;
+    SharedMemoryPublisher& operator=(const SharedMemoryPublisher&) = delete;
+
+    // Returns whether the shared memory could be created.
+    bool is_open() const;
+
+    // Returns the slot of the next entry after invalidating it, so the data can be written in place.
+    // The entry is only visible to the subscribers after publish.
+    SharedMemoryEntry& begin_entry();
+
+    // Stamps the entry returned by begin_entry with its sequence number and the wall clock time.
+    void publish();
+
+    uint64_t get_number_of_entries() const;
+
+    // The number of entries which the ring keeps if no size is given.
+    static constexpr int DEFAULT_NUMBER_OF_SLOTS = 256;
+
+private:
+    std::string m_name;
+    void* m_memory;
+    size_t m_size;
+    SharedMemoryRingHeader* m_header;
+    SharedMemoryEntry* m_entries;
+    uint64_t m_sequence;
+};
+
+// Attaches read-only to the ring of a publisher, which may be in another process.
+// The subscriber starts with the next published entry.
+class SharedMemorySubscriber final
+{
+public:
+    enum class Result
+    {
+        ENTRY,
+
+        // No entry has been published since the last one.
+        NO_ENTRY,
+
+        // Entries were overwritten before they could be read. The subscriber continues with the oldest kept entry.
+        OVERRUN
+    };
+
+    SharedMemorySubscriber(const std::string& name);
+    ~SharedMemorySubscriber();
+
+    SharedMemorySubscriber(const SharedMemorySubscriber&) = delete;
+    SharedMemorySubscriber& operator=(const SharedMemorySubscriber&) = delete;
+
+    // Returns whether the shared memory exists and is a ring of the current version.
+    bool is_valid() const;
+
+    // Copies the next entry without its unused data, since the entry could be overwritten while it is read.
+    // Never waits.
+    Result read(SharedMemoryEntry& entry);
+
+    // Returns the number of entries which were lost by overruns.
+    uint64_t get_number_of_lost_entries() const;
+
+private:
+    void* m_memory;
+    size_t m_size;
+    const SharedMemoryRingHeader* m_header;
+    const SharedMemoryEntry* m_entries;
+    uint64_t m_next_sequence;
+    uint64_t m_number_of_lost_entries;
+};
\ No newline at end of file
@@ -0,0 +1,402 @@
+#include "SuperframeDecoder.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+
+// The generator polynomial of the fire code is x^16 + x^14 + x^13 + x^12 + x^11 + x^5 + x^3 + x^2 + x + 1.
+static constexpr uint16_t FIRE_CODE_POLYNOMIAL = 0x782F;
+
+// The generator polynomial of the CRC of the access units is x^16 + x^12 + x^5 + 1.
+static constexpr uint16_t ACCESS_UNIT_CRC_POLYNOMIAL = 0x1021;
+
+// The bytes of the superframe header before the start addresses of the access units.
+static constexpr int N_HEADER_BYTES = 3;
+
+static constexpr int N_CRC_BYTES = 2;
+
+// The fire code is calculated over the 9 bytes after it.
+static uint16_t calculate_fire_code(const uint8_t bytes[])
+{
+    auto fire_code = uint16_t(0);
+    for (int i = 0; i < 9; i++)
+    {
+        fire_code = fire_code ^ static_cast<uint16_t>(bytes[i] << 8);
+        for (int j = 0; j < 8; j++)
+        {
+            fire_code = (fire_code & 0x8000) ? static_cast<uint16_t>((fire_code << 1) ^ FIRE_CODE_POLYNOMIAL) : static_cast<uint16_t>(fire_code << 1);
+        }
+    }
+    return fire_code;
+}
+
+// The CRC is initialized with ones and transmitted inverted, see section 5.2 of ETSI TS 102 563 V2.1.1.
+static uint16_t calculate_access_unit_crc(const uint8_t bytes[], int length)
+{
+    auto crc = uint16_t(0xFFFF);
+    for (int i = 0; i < length; i++)
+    {
+        crc = crc ^ static_cast<uint16_t>(bytes[i] << 8);
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ ACCESS_UNIT_CRC_POLYNOMIAL) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return static_cast<uint16_t>(~crc);
+}
+
+SuperframeDecoder::SuperframeDecoder(int bit_rate, AccessUnitCallback access_unit_callback) :
+    m_depth(bit_rate / 8),
+    m_logical_frame_length(3 * bit_rate),
+    m_access_unit_callback(std::move(access_unit_callback)),
+    m_reed_solomon(),
+    m_superframe(N_LOGICAL_FRAMES * m_logical_frame_length),
+    m_number_of_logical_frames(0),
+    m_is_synchronized(false),
+    m_corrected_superframe(N_LOGICAL_FRAMES * m_logical_frame_length),
+    m_statistics()
+{
+    if (bit_rate <= 0 || bit_rate % 8 != 0 || m_depth > ReedSolomon::MAX_DEPTH)
+    {
+        throw std::logic_error("The bit rate of a DAB+ subchannel must be a multiple of 8 kbit/s up to 192 kbit/s.");
+    }
+}
+
+int SuperframeDecoder::get_number_of_logical_frame_bits() const
+{
+    return 8 * m_logical_frame_length;
+}
+
+const SuperframeDecoder::Statistics& SuperframeDecoder::get_statistics() const
+{
+    return m_statistics;
+}
+
+// The bits are transmitted with the most significant bit of every byte first.
+void SuperframeDecoder::push_logical_frame(const uint8_t bits[])
+{
+    auto logical_frame = m_superframe.data() + m_number_of_logical_frames * m_logical_frame_length;
+    for (int i = 0; i < m_logical_frame_length; i++)
+    {
+        auto byte = 0;
+        for (int j = 0; j < 8; j++)
+        {
+            byte = (byte << 1) | (bits[8 * i + j] & 1);
+        }
+        logical_frame[i] = static_cast<uint8_t>(byte);
+    }
+
+    m_number_of_logical_frames++;
+    if (m_number_of_logical_frames < N_LOGICAL_FRAMES)
+    {
+        return;
+    }
+
+    // While synchronizing, the Reed-Solomon decoding is only tried once the fire code is found.
+    // Once synchronized, the fire code may also be corrected by the Reed-Solomon decoding.
+    auto is_fire_code_valid = check_fire_code(m_superframe.data());
+    if (!is_fire_code_valid && !m_is_synchronized)
+    {
+        discard_logical_frame();
+        return;
+    }
+
+    std::copy(m_superframe.begin(), m_superframe.end(), m_corrected_superframe.begin());
+    auto number_of_corrected_bytes = m_reed_solomon.decode(m_corrected_superframe.data(), m_depth);
+
+    if (!is_fire_code_valid && !check_fire_code(m_corrected_superframe.data()))
+    {
+        m_is_synchronized = false;
+        m_statistics.number_of_synchronization_losses++;
+        discard_logical_frame();
+        return;
+    }
+
+    if (number_of_corrected_bytes < 0)
+    {
+        m_statistics.number_of_uncorrectable_superframes++;
+    }
+    else
+    {
+        m_statistics.number_of_corrected_bytes = m_statistics.number_of_corrected_bytes + number_of_corrected_bytes;
+    }
+
+    m_is_synchronized = true;
+    m_number_of_logical_frames = 0;
+    extract_access_units(m_corrected_superframe.data());
+    m_statistics.number_of_superframes++;
+}
+
+void SuperframeDecoder::discard_logical_frame()
+{
+    std::copy(m_superframe.begin() + m_logical_frame_length, m_superframe.end(), m_superframe.begin());
+    m_number_of_logical_frames--;
+}
+
+// A beginning of zeros would pass the fire code, e.g. if the subchannel isn't transmitted, so it is rejected.
+bool SuperframeDecoder::check_fire_code(const uint8_t superframe[])
+{
+    auto is_zero = std::all_of(superframe, superframe + N_FIRE_CODE_BYTES, [](uint8_t byte) { return byte == 0; });
+    auto transmitted_fire_code = static_cast<uint16_t>((superframe[0] << 8) | superframe[1]);
+    return !is_zero && calculate_fire_code(superframe + 2) == transmitted_fire_code;
+}
+
+// The header is followed by the 12 bit start addresses of all access units but the first one.
+// The first access unit starts after the header and the last one ends before the parity bytes.
+void SuperframeDecoder::extract_access_units(const uint8_t superframe[])
+{
+    auto format{ SuperframeFormat() };
+    format.dac_rate = (superframe[2] >> 6) & 1;
+    format.sbr_flag = (superframe[2] >> 5) & 1;
+    format.aac_channel_mode = (superframe[2] >> 4) & 1;
+    format.ps_flag = (superframe[2] >> 3) & 1;
+    format.mpeg_surround_config = superframe[2] & 0x07;
+    format.number_of_access_units = format.sbr_flag ? (format.dac_rate ? 3 : 2) : (format.dac_rate ? 6 : 4);
+
+    auto audio_length = ReedSolomon::K * m_depth;
+    auto number_of_address_bits = 12 * (format.number_of_access_units - 1);
+    auto start = N_HEADER_BYTES + (number_of_address_bits + 7) / 8;
+
+    for (int i = 0; i < format.number_of_access_units; i++)
+    {
+        auto end = audio_length;
+        if (i + 1 < format.number_of_access_units)
+        {
+            auto bit_index = 8 * N_HEADER_BYTES + 12 * i;
+            auto word = (superframe[bit_index / 8] << 8) | superframe[bit_index / 8 + 1];
+            end = (bit_index % 8 == 0) ? (word >> 4) : (word & 0x0FFF);
+        }
+
+        m_statistics.number_of_access_units++;
+
+        auto length = end - start - N_CRC_BYTES;
+        if (length <= 0 || end > audio_length)
+        {
+            m_statistics.number_of_access_unit_crc_errors++;
+            start = std::max(start, std::min(end, audio_length));
+            continue;
+        }
+
+        auto transmitted_crc = static_cast<uint16_t>((superframe[start + length] << 8) | superframe[start + length + 1]);
+        if (calculate_access_unit_crc(superframe + start, length) != transmitted_crc)
+        {
+            m_statistics.number_of_access_unit_crc_errors++;
+            start = end;
+            continue;
+        }
+
+        auto access_unit{ AccessUnit() };
+        access_unit.superframe_number = m_statistics.number_of_superframes;
+        access_unit.access_unit_index = i;
+        access_unit.format = format;
+        access_unit.data = superframe + start;
+        access_unit.length = length;
+        m_access_unit_callback(access_unit);
+
+        start = end;
+    }
+}
+
+void SuperframeDecoder::print_statistics() const
+{
+    fmt::println("{} superframes were decoded after {} losses of the synchronization.", m_statistics.number_of_superframes, m_statistics.number_of_synchronization_losses);
+    fmt::println("The Reed-Solomon code corrected {} bytes and failed in {} superframes.", m_statistics.number_of_corrected_bytes, m_statistics.number_of_uncorrectable_superframes);
+    fmt::println("{} of {} access units had a CRC error.", m_statistics.number_of_access_unit_crc_errors, m_statistics.number_of_access_units);
+}
+
+// The bit rates cover depths which are below, at and above the vector widths of the syndrome kernels.
+static constexpr int SELF_TEST_BIT_RATES[] = { 8, 40, 88, 128, 192 };
+
+static constexpr int SELF_TEST_N_SUPERFRAMES = 24;
+
+// The number of superframes of the highest bit rate which are decoded to measure the throughput.
+static constexpr int THROUGHPUT_N_SUPERFRAMES = 2'000;
+
+// The highest net bit rate of an ensemble in kbit/s, i.e. 864 capacity units of the protection level EEP-4A.
+static constexpr int FULL_ENSEMBLE_BIT_RATE = 1'728;
+
+// Creates a superframe of random access units whose data is appended to the expected access units.
+// The format cycles through all combinations of the sample rate and SBR.
+static std::vector<uint8_t> create_superframe(int bit_rate, int superframe_number, std::mt19937& random_engine, std::vector<std::vector<uint8_t>>& expected_access_units)
+{
+    auto depth = bit_rate / 8;
+    auto superframe{ std::vector<uint8_t>(ReedSolomon::N * depth) };
+    auto byte_distribution{ std::uniform_int_distribution<int>(0, 255) };
+
+    auto dac_rate = (superframe_number & 1) != 0;
+    auto sbr_flag = (superframe_number & 2) != 0;
+    auto number_of_access_units = sbr_flag ? (dac_rate ? 3 : 2) : (dac_rate ? 6 : 4);
+    superframe[2] = static_cast<uint8_t>((dac_rate << 6) | (sbr_flag << 5) | (1 << 4) | (superframe_number % 8));
+
+    auto audio_length = ReedSolomon::K * depth;
+    auto start = N_HEADER_BYTES + (12 * (number_of_access_units - 1) + 7) / 8;
+    auto access_unit_length = (audio_length - start) / number_of_access_units;
+    for (int i = 0; i < number_of_access_units; i++)
+    {
+        auto end = (i + 1 == number_of_access_units) ? audio_length : start + access_unit_length;
+        if (i + 1 < number_of_access_units)
+        {
+            auto bit_index = 8 * N_HEADER_BYTES + 12 * i;
+            if (bit_index % 8 == 0)
+            {
+                superframe[bit_index / 8] = static_cast<uint8_t>(end >> 4);
+                superframe[bit_index / 8 + 1] = static_cast<uint8_t>(superframe[bit_index / 8 + 1] | ((end & 0x0F) << 4));
+            }
+            else
+            {
+                superframe[bit_index / 8] = static_cast<uint8_t>(superframe[bit_index / 8] | (end >> 8));
+                superframe[bit_index / 8 + 1] = static_cast<uint8_t>(end & 0xFF);
+            }
+        }
+
+        auto length = end - start - N_CRC_BYTES;
+        for (int j = 0; j < length; j++)
+        {
+            superframe[start + j] = static_cast<uint8_t>(byte_distribution(random_engine));
+        }
+
+        auto crc = calculate_access_unit_crc(superframe.data() + start, length);
+        superframe[start + length] = static_cast<uint8_t>(crc >> 8);
+        superframe[start + length + 1] = static_cast<uint8_t>(crc & 0xFF);
+
+        expected_access_units.emplace_back(superframe.begin() + start, superframe.begin() + start + length);
+        start = end;
+    }
+
+    auto fire_code = calculate_fire_code(superframe.data() + 2);
+    superframe[0] = static_cast<uint8_t>(fire_code >> 8);
+    superframe[1] = static_cast<uint8_t>(fire_code & 0xFF);
+
+    auto reed_solomon{ ReedSolomon() };
+    for (int j = 0; j < depth; j++)
+    {
+        reed_solomon.encode(superframe.data() + j, depth);
+    }
+
+    return superframe;
+}
+
+// Adds up to 5 byte errors to every codeword at distinct positions.
+static void add_byte_errors(std::vector<uint8_t>& superframe, int depth, std::mt19937& random_engine)
+{
+    auto position_distribution{ std::uniform_int_distribution<int>(0, ReedSolomon::N - 1) };
+    auto error_distribution{ std::uniform_int_distribution<int>(1, 255) };
+    auto count_distribution{ std::uniform_int_distribution<int>(1, ReedSolomon::N_PARITY / 2) };
+    for (int j = 0; j < depth; j++)
+    {
+        auto positions{ std::vector<int>() };
+        auto number_of_errors = count_distribution(random_engine);
+        while (static_cast<int>(positions.size()) < number_of_errors)
+        {
+            auto position = position_distribution(random_engine);
+            if (std::find(positions.begin(), positions.end(), position) == positions.end())
+            {
+                positions.push_back(position);
+                superframe[position * depth + j] = static_cast<uint8_t>(superframe[position * depth + j] ^ error_distribution(random_engine));
+            }
+        }
+    }
+}
+
+// Unpacks the bytes to one bit per byte like the Viterbi decoder outputs them.
+static std::vector<uint8_t> unpack_bits(const std::vector<uint8_t>& bytes)
+{
+    auto bits{ std::vector<uint8_t>(8 * bytes.size()) };
+    for (int i = 0; i < static_cast<int>(bits.size()); i++)
+    {
+        bits[i] = (bytes[i / 8] >> (7 - i % 8)) & 1;
+    }
+    return bits;
+}
+
+static void push_bits(SuperframeDecoder& superframe_decoder, const std::vector<uint8_t>& bits)
+{
+    auto number_of_logical_frame_bits = superframe_decoder.get_number_of_logical_frame_bits();
+    for (int offset = 0; offset < static_cast<int>(bits.size()); offset += number_of_logical_frame_bits)
+    {
+        superframe_decoder.push_logical_frame(bits.data() + offset);
+    }
+}
+
+// The stream of every bit rate begins with 2 logical frames of noise which must be skipped by the synchronization.
+// Every second superframe contains correctable errors.
+static bool test_bit_rate(int bit_rate)
+{
+    auto depth = bit_rate / 8;
+    auto random_engine{ std::mt19937(bit_rate) };
+    auto byte_distribution{ std::uniform_int_distribution<int>(0, 255) };
+
+    auto expected_access_units{ std::vector<std::vector<uint8_t>>() };
+    auto actual_access_units{ std::vector<std::vector<uint8_t>>() };
+    auto superframe_decoder{ SuperframeDecoder(bit_rate, [&](const AccessUnit& access_unit)
+    {
+        actual_access_units.emplace_back(access_unit.data, access_unit.data + access_unit.length);
+    }) };
+
+    auto noise{ std::vector<uint8_t>(2 * 3 * bit_rate) };
+    for (auto& byte : noise)
+    {
+        byte = static_cast<uint8_t>(byte_distribution(random_engine));
+    }
+    push_bits(superframe_decoder, unpack_bits(noise));
+
+    for (int i = 0; i < SELF_TEST_N_SUPERFRAMES; i++)
+    {
+        auto superframe = create_superframe(bit_rate, i, random_engine, expected_access_units);
+        if (i % 2 == 1)
+        {
+            add_byte_errors(superframe, depth, random_engine);
+        }
+        push_bits(superframe_decoder, unpack_bits(superframe));
+    }
+
+    auto& statistics = superframe_decoder.get_statistics();
+    auto is_recovered = actual_access_units == expected_access_units && statistics.number_of_superframes == SELF_TEST_N_SUPERFRAMES;
+    fmt::println("DAB+ superframes of {} kbit/s: {} of {} access units recovered, {} bytes corrected: {}",
+        bit_rate, actual_access_units.size(), expected_access_units.size(), statistics.number_of_corrected_bytes, is_recovered ? "passed" : "FAILED");
+    return is_recovered;
+}
+
+// The throughput is measured for superframes with and without errors because only the latter take the fast path of the Reed-Solomon decoder.
+static void measure_throughput(bool has_errors)
+{
+    auto bit_rate = 8 * ReedSolomon::MAX_DEPTH;
+    auto random_engine{ std::mt19937(1) };
+    auto expected_access_units{ std::vector<std::vector<uint8_t>>() };
+    auto superframe = create_superframe(bit_rate, 0, random_engine, expected_access_units);
+    if (has_errors)
+    {
+        add_byte_errors(superframe, ReedSolomon::MAX_DEPTH, random_engine);
+    }
+
+    auto superframe_decoder{ SuperframeDecoder(bit_rate, [](const AccessUnit&) {}) };
+    auto bits = unpack_bits(superframe);
+
+    auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < THROUGHPUT_N_SUPERFRAMES; i++)
+    {
+        push_bits(superframe_decoder, bits);
+    }
+    auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    // A superframe covers 120 ms of its subchannel.
+    auto decoded_bit_rate = THROUGHPUT_N_SUPERFRAMES * static_cast<double>(bit_rate) * 0.12 / duration;
+    fmt::println("DAB+ superframes {} errors: {:.0f} kbit/s on one core, {:.1f} times a fully loaded ensemble of {} kbit/s.",
+        has_errors ? "with" : "without", decoded_bit_rate, decoded_bit_rate / FULL_ENSEMBLE_BIT_RATE, FULL_ENSEMBLE_BIT_RATE);
+}
+
+bool SuperframeDecoder::run_self_test()
+{
+    auto is_recovered = true;
+    for (auto bit_rate : SELF_TEST_BIT_RATES)
+    {
+        is_recovered = test_bit_rate(bit_rate) && is_recovered;
+    }
+
+    measure_throughput(false);
+    measure_throughput(true);
+    return is_recovered;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ReedSolomon.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// The format of a DAB+ audio superframe, see section 5.2 of ETSI TS 102 563 V2.1.1.
+struct SuperframeFormat
+{
+    // Whether the sample rate of the AAC core is 48 kHz instead of 32 kHz.
+    bool dac_rate;
+
+    // Whether spectral band replication is used.
+    bool sbr_flag;
+
+    // Whether the AAC core is stereo instead of mono.
+    bool aac_channel_mode;
+
+    // Whether parametric stereo is used.
+    bool ps_flag;
+
+    int mpeg_surround_config;
+
+    // 2, 3, 4 or 6 depending on the sample rate and SBR.
+    int number_of_access_units;
+};
+
+// An access unit of a DAB+ audio superframe whose CRC is valid.
+// The data references a buffer of the superframe decoder, so it is only valid during the callback.
+struct AccessUnit
+{
+    // The number of the superframe since the start of the subchannel.
+    int superframe_number;
+
+    int access_unit_index;
+
+    SuperframeFormat format;
+
+    // The AAC data without the CRC.
+    const uint8_t* data;
+    int length;
+};
+
+// Is called for every access unit whose CRC is valid.
+using AccessUnitCallback = std::function<void(const AccessUnit&)>;
+
+// Extracts the access units of a DAB+ audio subchannel from its logical frames,
+// see sections 5 and 6 of ETSI TS 102 563 V2.1.1.
+// 5 logical frames form a superframe whose start is found by the fire code,
+// and whose codewords of the Reed-Solomon code are interleaved byte by byte.
+// It is fed by the decoded bits of a subchannel of the MSC, which this receiver doesn't decode yet.
+class SuperframeDecoder final
+{
+public:
+    struct Statistics
+    {
+        int number_of_superframes;
+
+        // The number of times the superframes were synchronized again after a superframe wasn't found.
+        int number_of_synchronization_losses;
+
+        int number_of_corrected_bytes;
+        int number_of_uncorrectable_superframes;
+
+        int number_of_access_units;
+        int number_of_access_unit_crc_errors;
+    };
+
+    // The bit rate of the subchannel in kbit/s is a multiple of 8 kbit/s up to 192 kbit/s.
+    SuperframeDecoder(int bit_rate, AccessUnitCallback access_unit_callback);
+
+    // Returns the number of bits of a logical frame, i.e. 24 ms of the subchannel.
+    int get_number_of_logical_frame_bits() const;
+
+    // Pushes the decoded bits of the next logical frame, one bit per byte.
+    void push_logical_frame(const uint8_t bits[]);
+
+    const Statistics& get_statistics() const;
+
+    void print_statistics() const;
+
+    // Decodes synthetic superframes with and without correctable errors at several bit rates,
+    // prints the throughput and returns whether every access unit was recovered.
+    static bool run_self_test();
+
+private:
+    static constexpr int N_LOGICAL_FRAMES = 5;
+
+    // The fire code protects the 9 bytes after it at the beginning of the superframe.
+    static constexpr int N_FIRE_CODE_BYTES = 11;
+
+    static bool check_fire_code(const uint8_t superframe[]);
+
+    // Slides the superframe by one logical frame because the oldest one isn't the start of a superframe.
+    void discard_logical_frame();
+
+    void extract_access_units(const uint8_t superframe[]);
+
+    // The number of Reed-Solomon codewords which are interleaved, i.e. the bit rate divided by 8 kbit/s.
+    int m_depth;
+    int m_logical_frame_length;
+    AccessUnitCallback m_access_unit_callback;
+
+    ReedSolomon m_reed_solomon;
+
+    // The last logical frames of which the oldest one may be the start of a superframe.
+    std::vector<uint8_t> m_superframe;
+    int m_number_of_logical_frames;
+    bool m_is_synchronized;
+
+    // The superframe is corrected in a copy so that the received bytes are kept if it turns out to be misaligned.
+    std::vector<uint8_t> m_corrected_superframe;
+
+    Statistics m_statistics;
+};
\ No newline at end of file
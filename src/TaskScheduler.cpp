@@ -0,0 +1,160 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+static uint64_t pack_bounds(int begin, int end)
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(begin)) | (static_cast<uint64_t>(static_cast<uint32_t>(end)) << 32);
+}
+
+TaskScheduler::TaskScheduler(int number_of_threads, AllocationCounter::Counter* allocation_counter) :
+    m_number_of_threads(std::max(1, number_of_threads)),
+    m_allocation_counter(allocation_counter),
+    m_ranges(std::make_unique<Range[]>(m_number_of_threads)),
+    m_context(nullptr),
+    m_task_function(nullptr),
+    m_mutex(),
+    m_loop_started(),
+    m_workers_finished(),
+    m_loop_number(0),
+    m_number_of_busy_workers(0),
+    m_is_stopping(false),
+    m_workers()
+{
+    for (int i = 0; i < m_number_of_threads; i++)
+    {
+        m_ranges[i].bounds.store(0, std::memory_order_relaxed);
+    }
+
+    // The calling thread has the index 0.
+    for (int i = 1; i < m_number_of_threads; i++)
+    {
+        m_workers.emplace_back(&TaskScheduler::run_worker, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        auto lock{ std::lock_guard<std::mutex>(m_mutex) };
+        m_is_stopping = true;
+    }
+    m_loop_started.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+int TaskScheduler::get_number_of_threads() const
+{
+    return m_number_of_threads;
+}
+
+// The loop only returns once every worker has left it,
+// so that no worker can take an index of the next loop while still holding the task of this one.
+void TaskScheduler::run(int length, const void* context, TaskFunction task_function)
+{
+    if (m_number_of_threads == 1 || length <= 1)
+    {
+        for (int i = 0; i < length; i++)
+        {
+            task_function(context, i, 0);
+        }
+        return;
+    }
+
+    for (int i = 0; i < m_number_of_threads; i++)
+    {
+        auto begin = static_cast<int>(static_cast<int64_t>(length) * i / m_number_of_threads);
+        auto end = static_cast<int>(static_cast<int64_t>(length) * (i + 1) / m_number_of_threads);
+        m_ranges[i].bounds.store(pack_bounds(begin, end), std::memory_order_relaxed);
+    }
+
+    {
+        auto lock{ std::lock_guard<std::mutex>(m_mutex) };
+        m_context = context;
+        m_task_function = task_function;
+        m_number_of_busy_workers = m_number_of_threads - 1;
+        m_loop_number++;
+    }
+    m_loop_started.notify_all();
+
+    work(0);
+
+    auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+    m_workers_finished.wait(lock, [this]() { return m_number_of_busy_workers == 0; });
+}
+
+void TaskScheduler::run_worker(int thread_index)
+{
+    AllocationCounter::set_thread_counter(m_allocation_counter);
+
+    auto loop_number = uint64_t(0);
+    while (true)
+    {
+        {
+            auto lock{ std::unique_lock<std::mutex>(m_mutex) };
+            m_loop_started.wait(lock, [this, loop_number]() { return m_is_stopping || m_loop_number != loop_number; });
+            if (m_is_stopping)
+            {
+                return;
+            }
+            loop_number = m_loop_number;
+        }
+
+        work(thread_index);
+
+        auto is_last = false;
+        {
+            auto lock{ std::lock_guard<std::mutex>(m_mutex) };
+            m_number_of_busy_workers--;
+            is_last = m_number_of_busy_workers == 0;
+        }
+        if (is_last)
+        {
+            m_workers_finished.notify_one();
+        }
+    }
+}
+
+// The victims are visited starting after the own range so that the thieves spread over the ranges.
+void TaskScheduler::work(int thread_index)
+{
+    auto index = 0;
+    while (take_index(m_ranges[thread_index], true, index))
+    {
+        m_task_function(m_context, index, thread_index);
+    }
+
+    for (int i = 1; i < m_number_of_threads; i++)
+    {
+        auto& victim_range = m_ranges[(thread_index + i) % m_number_of_threads];
+        while (take_index(victim_range, false, index))
+        {
+            m_task_function(m_context, index, thread_index);
+        }
+    }
+}
+
+bool TaskScheduler::take_index(Range& range, bool is_owner, int& index)
+{
+    auto bounds = range.bounds.load(std::memory_order_acquire);
+    while (true)
+    {
+        auto begin = static_cast<int>(static_cast<uint32_t>(bounds));
+        auto end = static_cast<int>(static_cast<uint32_t>(bounds >> 32));
+        if (begin >= end)
+        {
+            return false;
+        }
+
+        auto new_bounds = is_owner ? pack_bounds(begin + 1, end) : pack_bounds(begin, end - 1);
+        if (range.bounds.compare_exchange_weak(bounds, new_bounds, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            index = is_owner ? begin : end - 1;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the independent tasks within one frame on several threads, e.g. the FFTs of the OFDM symbols
+// or the Viterbi decoding of the FIC blocks.
+// The indices of a parallel loop are split into a contiguous range per thread.
+// A thread takes the indices of its own range from the front and, once it is empty,
+// steals the indices of the other ranges from the back so that uneven tasks are balanced.
+// The calling thread takes part in every loop, which is the join point of its tasks.
+class TaskScheduler final
+{
+public:
+    // The number of threads includes the calling thread, so that 1 runs every loop serially without any worker thread.
+    // The allocations of the worker threads are attributed to the given counter, e.g. of the receiver which owns the scheduler.
+    explicit TaskScheduler(int number_of_threads, AllocationCounter::Counter* allocation_counter = nullptr);
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+    ~TaskScheduler();
+
+    int get_number_of_threads() const;
+
+    // Calls task(index, thread_index) for every index from 0 to length - 1 and returns once all calls have returned.
+    // The thread index from 0 to get_number_of_threads() - 1 identifies the thread, e.g. to select its scratch buffers.
+    // The task isn't wrapped into a std::function so that a loop doesn't allocate.
+    template <typename Task>
+    void parallel_for(int length, const Task& task)
+    {
+        run(length, &task, [](const void* context, int index, int thread_index)
+        {
+            (*static_cast<const Task*>(context))(index, thread_index);
+        });
+    }
+
+private:
+    using TaskFunction = void (*)(const void* context, int index, int thread_index);
+
+    // The range of indices of a thread with the first index in the low and the end in the high 32 bits,
+    // so that the owner and the thieves update it by a single compare-and-swap.
+    // Each range has its own cache line.
+    struct alignas(64) Range
+    {
+        std::atomic<uint64_t> bounds;
+    };
+
+    void run(int length, const void* context, TaskFunction task_function);
+
+    void run_worker(int thread_index);
+
+    // Runs the tasks of the own range and then the stolen ones until all ranges are empty.
+    void work(int thread_index);
+
+    // Takes the first or the last index of the range and returns false if it is empty.
+    bool take_index(Range& range, bool is_owner, int& index);
+
+    int m_number_of_threads;
+    AllocationCounter::Counter* m_allocation_counter;
+    std::unique_ptr<Range[]> m_ranges;
+
+    // The loop which is currently run.
+    const void* m_context;
+    TaskFunction m_task_function;
+
+    std::mutex m_mutex;
+    std::condition_variable m_loop_started;
+    std::condition_variable m_workers_finished;
+    uint64_t m_loop_number;
+    int m_number_of_busy_workers;
+    bool m_is_stopping;
+
+    std::vector<std::thread> m_workers;
+};
\ No newline at end of file
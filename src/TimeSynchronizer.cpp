@@ -1,72 +1,235 @@
 #include "TimeSynchronizer.h"
+#include "Tracing.h"
 #include "DabConstants.h"
+#include "NullSymbolDetector.h"
 #include "PrsCreation.h"
 
-TimeSynchronizer::TimeSynchronizer(const FftCalculator& fft_calculator, const Eigen::VectorXcf& prepared_prs_symbol_fd) :
-    m_fft_calculator(fft_calculator),
-    m_prepared_prs_symbol_fd(prepared_prs_symbol_fd),
-    m_signal_fd(DabConstants::T_F_FFT),
-    m_product_fd(DabConstants::T_F_FFT),
-    m_correlation_result(DabConstants::T_F_FFT)
+using namespace DabConstants;
+
+template <typename Mode>
+PrsCorrelator<Mode>::PrsCorrelator(int size, const Eigen::VectorXcf& prs_symbol) :
+    m_size(size),
+    m_fft_calculator(size),
+    m_prepared_prs_symbol_fd(size),
+    m_prepared_differential_prs_symbol_fd(size),
+    m_differential_signal_td(size),
+    m_signal_fd(size),
+    m_product_fd(size),
+    m_correlation_result(size)
 {
+    auto differential_prs_symbol{ Eigen::VectorXcf(Mode::T_S) };
+    calculate_differential_signal(prs_symbol, differential_prs_symbol);
 
+    m_prepared_prs_symbol_fd = create_prepared_prs_symbol_fd(prs_symbol, m_fft_calculator);
+    m_prepared_differential_prs_symbol_fd = create_prepared_prs_symbol_fd(differential_prs_symbol, m_fft_calculator);
 }
 
-TimeSynchronizer TimeSynchronizer::create()
+template <typename Mode>
+Eigen::VectorXcf PrsCorrelator<Mode>::create_prepared_prs_symbol_fd(const Eigen::VectorXcf& prs_symbol, const FftCalculator& fft_calculator)
 {
-    auto symbol_fft_calculator{ FftCalculator(DabConstants::T_U) };
-    auto frame_fft_calculator{ FftCalculator(DabConstants::T_F_FFT) };
+    auto size = fft_calculator.get_size();
+    Eigen::VectorXcf prepared_prs_symbol_td = Eigen::VectorXcf::Zero(size);
+    Eigen::VectorXcf prepared_prs_symbol_fd = Eigen::VectorXcf::Zero(size);
 
-    auto prs_symbol = PrsCreation::create(symbol_fft_calculator);
-    auto prepared_prs_symbol_fd = create_prepared_prs_symbol_fd(prs_symbol, frame_fft_calculator);
-    auto time_synchronizer{ TimeSynchronizer(frame_fft_calculator, prepared_prs_symbol_fd) };
+    prepared_prs_symbol_td.head<Mode::T_S>() = prs_symbol.reverse().conjugate();
+    fft_calculator.fft(prepared_prs_symbol_td.data(), prepared_prs_symbol_fd.data());
 
-    return time_synchronizer;
+    return prepared_prs_symbol_fd;
 }
 
-Eigen::VectorXcf TimeSynchronizer::create_prepared_prs_symbol_fd(const Eigen::VectorXcf& prs_symbol, const FftCalculator& fft_calculator)
+// Multiplies each sample with the conjugate of its predecessor.
+// A frequency offset only causes a constant phase in the resulting signal.
+template <typename Mode>
+void PrsCorrelator<Mode>::calculate_differential_signal(const Eigen::Ref<const Eigen::VectorXcf>& signal_td, Eigen::VectorXcf& differential_signal_td)
 {
-    Eigen::VectorXcf prepared_prs_symbol_td = Eigen::VectorXcf::Zero(DabConstants::T_F_FFT);
-    Eigen::VectorXcf prepared_prs_symbol_fd = Eigen::VectorXcf::Zero(DabConstants::T_F_FFT);
+    auto size = signal_td.size();
+    differential_signal_td[0] = 0;
+    differential_signal_td.tail(size - 1) = signal_td.tail(size - 1).cwiseProduct(signal_td.head(size - 1).conjugate());
+}
 
-    prepared_prs_symbol_td.head<DabConstants::T_S>() = prs_symbol.reverse().conjugate();
-    fft_calculator.fft(prepared_prs_symbol_td.data(), prepared_prs_symbol_fd.data());
+template <typename Mode>
+CorrelationPeak PrsCorrelator<Mode>::get_peak(
+    const std::complex<float> signal_td[],
+    std::optional<int> coarse_frequency_offset,
+    int first_prs_start_index,
+    int last_prs_start_index)
+{
+    if (coarse_frequency_offset.has_value())
+    {
+        m_fft_calculator.fft(signal_td, m_signal_fd.data());
+        correlate(coarse_frequency_offset.value());
+    }
+    else
+    {
+        calculate_differential_signal(Eigen::Map<const Eigen::VectorXcf>(signal_td, m_size), m_differential_signal_td);
+        m_fft_calculator.fft(m_differential_signal_td.data(), m_signal_fd.data());
+        correlate_robustly();
+    }
 
-    return prepared_prs_symbol_fd;
+    // The correlation result at index i belongs to the PRS symbol starting at i - T_S + 1.
+    auto argmax = first_prs_start_index;
+    auto max = 0.0f;
+    auto sum = 0.0f;
+    for (int i = first_prs_start_index; i <= last_prs_start_index; i++)
+    {
+        auto current_max = std::norm(m_correlation_result[i + Mode::T_S - 1]);
+        sum += current_max;
+        if (current_max > max)
+        {
+            argmax = i;
+            max = current_max;
+        }
+    }
+
+    auto mean = sum / (last_prs_start_index - first_prs_start_index + 1);
+    auto peak_to_mean_ratio = mean > 0.0f ? max / mean : 0.0f;
+
+    return CorrelationPeak{ argmax, peak_to_mean_ratio };
 }
 
 // Calculates the cross correlation between the signal and the PRS symbol to find the start of the PRS symbol.
 // The cross correlation is calculated using the "fourier transformation trick".
-int TimeSynchronizer::get_prs_start_index(const Eigen::VectorXcf& signal_td)
+// The integer part of the frequency offset is compensated by shifting the spectrum of the signal
+// by the corresponding number of FFT bins.
+template <typename Mode>
+void PrsCorrelator<Mode>::correlate(int coarse_frequency_offset)
 {
-    m_fft_calculator.fft(signal_td.data(), m_signal_fd.data());
-    m_product_fd = m_signal_fd.array() * m_prepared_prs_symbol_fd.array();
+    auto bins_per_carrier = m_size / Mode::T_U;
+    auto shift = ((coarse_frequency_offset * bins_per_carrier) % m_size + m_size) % m_size;
+
+    m_product_fd.head(m_size - shift) = m_signal_fd.tail(m_size - shift).cwiseProduct(m_prepared_prs_symbol_fd.head(m_size - shift));
+    m_product_fd.tail(shift) = m_signal_fd.head(shift).cwiseProduct(m_prepared_prs_symbol_fd.tail(shift));
     m_fft_calculator.ifft(m_product_fd.data(), m_correlation_result.data());
+}
 
-    auto argmax = 0;
-    auto max = 0.0f;
-    for (int i = 0; i < signal_td.size(); i++)
+// Calculates the cross correlation between the differential signal and the differential PRS symbol.
+// This is used during the acquisition when the frequency offset is not known yet.
+template <typename Mode>
+void PrsCorrelator<Mode>::correlate_robustly()
+{
+    m_product_fd = m_signal_fd.cwiseProduct(m_prepared_differential_prs_symbol_fd);
+    m_fft_calculator.ifft(m_product_fd.data(), m_correlation_result.data());
+}
+
+template <typename Mode>
+TimeSynchronizer<Mode>::TimeSynchronizer(const PrsCorrelator<Mode>& frame_prs_correlator, const PrsCorrelator<Mode>& refinement_prs_correlator) :
+    m_frame_prs_correlator(frame_prs_correlator),
+    m_refinement_prs_correlator(refinement_prs_correlator)
+{
+
+}
+
+template <typename Mode>
+TimeSynchronizer<Mode> TimeSynchronizer<Mode>::create()
+{
+    auto symbol_fft_calculator{ FftCalculator(Mode::T_U) };
+
+    auto prs_symbol = PrsCreation::create<Mode>(symbol_fft_calculator);
+    auto frame_prs_correlator{ PrsCorrelator<Mode>(Mode::T_F_FFT, prs_symbol) };
+    auto refinement_prs_correlator{ PrsCorrelator<Mode>(REFINEMENT_LENGTH, prs_symbol) };
+
+    auto time_synchronizer{ TimeSynchronizer(frame_prs_correlator, refinement_prs_correlator) };
+
+    return time_synchronizer;
+}
+
+template <typename Mode>
+int TimeSynchronizer<Mode>::get_prs_start_index(
+    const Eigen::Ref<const Eigen::VectorXcf>& signal_td,
+    std::optional<int> coarse_frequency_offset,
+    std::optional<int> predicted_prs_start_index)
+{
+    auto span{ Tracing::ScopedSpan("TimeSynchronizer::get_prs_start_index") };
+
+    if (predicted_prs_start_index.has_value())
     {
-        auto current_max = std::norm(m_correlation_result[i]);
-        if (current_max > max)
+        auto prs_start_index = refine_prs_start_index(signal_td, predicted_prs_start_index.value(), coarse_frequency_offset);
+        if (prs_start_index.has_value())
         {
-            argmax = i;
-            max = current_max;
+            return prs_start_index.value();
         }
     }
 
-    argmax = argmax - DabConstants::T_S + 1; // Offset corrected by the length of the PRS symbol.
+    // The search is limited so that the Null symbol of the next frame is not found instead.
+    auto coarse_prs_start_index = NullSymbolDetector<Mode>::detect(signal_td, Mode::T_F_U);
+    if (coarse_prs_start_index.has_value())
+    {
+        auto prs_start_index = refine_prs_start_index(signal_td, coarse_prs_start_index.value(), coarse_frequency_offset);
+        if (prs_start_index.has_value())
+        {
+            return prs_start_index.value();
+        }
+    }
 
-    if (argmax < 0)
+    // Without a Null symbol, the PRS symbol may start anywhere in the signal.
+    // If it starts at the very end, the PRS symbol of the next frame is used.
+    auto prs_start_index = m_frame_prs_correlator.get_peak(signal_td.data(), coarse_frequency_offset, 1 - Mode::T_S, Mode::T_F_FFT - Mode::T_S).prs_start_index;
+    if (prs_start_index < 0)
     {
-        throw std::logic_error("How to handle the case when argmax is less than 0?");
+        return prs_start_index + Mode::T_F;
     }
-    else if (argmax > DabConstants::T_F)
+    else if (prs_start_index > Mode::T_F)
     {
-        return argmax - DabConstants::T_F;
+        return prs_start_index - Mode::T_F;
     }
     else
     {
-        return argmax;
+        return prs_start_index;
+    }
+}
+
+template <typename Mode>
+std::optional<int> TimeSynchronizer<Mode>::track_prs_start_index(
+    const Eigen::Ref<const Eigen::VectorXcf>& signal_td,
+    std::optional<int> coarse_frequency_offset,
+    int predicted_prs_start_index)
+{
+    auto span{ Tracing::ScopedSpan("TimeSynchronizer::track_prs_start_index") };
+
+    return refine_prs_start_index(signal_td, predicted_prs_start_index, coarse_frequency_offset);
+}
+
+// The refinement fails if the coarse estimation is too close to the borders of the signal,
+// if the correlation peak lies at the border of the searched range,
+// i.e. the actual peak is probably outside of it,
+// or if the correlation peak is too weak, e.g. because the coarse estimation lies in a silent part of the signal.
+template <typename Mode>
+std::optional<int> TimeSynchronizer<Mode>::refine_prs_start_index(
+    const Eigen::Ref<const Eigen::VectorXcf>& signal_td,
+    int coarse_prs_start_index,
+    std::optional<int> coarse_frequency_offset)
+{
+    auto segment_start_index = coarse_prs_start_index - REFINEMENT_RANGE;
+    if (segment_start_index < 0 || segment_start_index + REFINEMENT_LENGTH > signal_td.size())
+    {
+        return std::nullopt;
     }
+
+    auto peak = m_refinement_prs_correlator.get_peak(
+        signal_td.data() + segment_start_index,
+        coarse_frequency_offset,
+        0,
+        2 * REFINEMENT_RANGE);
+
+    if (peak.prs_start_index == 0 || peak.prs_start_index == 2 * REFINEMENT_RANGE)
+    {
+        return std::nullopt;
+    }
+
+    if (peak.peak_to_mean_ratio < MIN_REFINEMENT_PEAK_TO_MEAN_RATIO)
+    {
+        return std::nullopt;
+    }
+
+    return segment_start_index + peak.prs_start_index;
 }
+
+template class PrsCorrelator<TransmissionModeI>;
+template class PrsCorrelator<TransmissionModeII>;
+template class PrsCorrelator<TransmissionModeIII>;
+template class PrsCorrelator<TransmissionModeIV>;
+
+template class TimeSynchronizer<TransmissionModeI>;
+template class TimeSynchronizer<TransmissionModeII>;
+template class TimeSynchronizer<TransmissionModeIII>;
+template class TimeSynchronizer<TransmissionModeIV>;
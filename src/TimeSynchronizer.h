@@ -1,24 +1,99 @@
 #pragma once
 
+#include "DabConstants.h"
 #include "FftCalculator.h"
 
 #include "Eigen/Dense"
 
-class TimeSynchronizer final
+#include <optional>
+
+struct CorrelationPeak
+{
+    // The start index of the PRS symbol belonging to the peak.
+    int prs_start_index;
+
+    // The ratio between the power of the peak and the mean power of the searched correlation result.
+    float peak_to_mean_ratio;
+};
+
+// Correlates a signal of a fixed length with the PRS symbol.
+template <typename Mode>
+class PrsCorrelator final
 {
 public:
-    static TimeSynchronizer create();
+    PrsCorrelator(int size, const Eigen::VectorXcf& prs_symbol);
 
-    int get_prs_start_index(const Eigen::VectorXcf& signal_td);
+    // Returns the peak of the correlation for the PRS start indices within [first_prs_start_index, last_prs_start_index].
+    // If the integer part of the frequency offset is known, it is compensated during the correlation.
+    // Otherwise, a correlation is used which is robust against frequency offsets.
+    CorrelationPeak get_peak(
+        const std::complex<float> signal_td[],
+        std::optional<int> coarse_frequency_offset,
+        int first_prs_start_index,
+        int last_prs_start_index);
 
 private:
-    TimeSynchronizer(const FftCalculator& fft_calculator, const Eigen::VectorXcf& prepared_prs_symbol_fd);
-
     static Eigen::VectorXcf create_prepared_prs_symbol_fd(const Eigen::VectorXcf& prs_symbol, const FftCalculator& fft_calculator);
+    static void calculate_differential_signal(const Eigen::Ref<const Eigen::VectorXcf>& signal_td, Eigen::VectorXcf& differential_signal_td);
+
+    void correlate(int coarse_frequency_offset);
+    void correlate_robustly();
 
+    int m_size;
     FftCalculator m_fft_calculator;
     Eigen::VectorXcf m_prepared_prs_symbol_fd;
+    Eigen::VectorXcf m_prepared_differential_prs_symbol_fd;
+    Eigen::VectorXcf m_differential_signal_td;
     Eigen::VectorXcf m_signal_fd;
     Eigen::VectorXcf m_product_fd;
     Eigen::VectorXcf m_correlation_result;
+};
+
+template <typename Mode>
+class TimeSynchronizer final
+{
+public:
+    static TimeSynchronizer create();
+
+    // Determines the start of the PRS symbol.
+    // The Null symbol detector gives a coarse estimation which is refined by a short correlation.
+    // Only if this fails, the correlation is calculated over the whole signal.
+    // If the start is predicted by the timing of the frames before, the short correlation is tried around the prediction first,
+    // so that the Null symbol detector is skipped as long as the timing stays locked.
+    int get_prs_start_index(
+        const Eigen::Ref<const Eigen::VectorXcf>& signal_td,
+        std::optional<int> coarse_frequency_offset,
+        std::optional<int> predicted_prs_start_index = std::nullopt);
+
+    // Determines the start of the PRS symbol only by the short correlation around the prediction.
+    // The signal only needs get_tracking_length(predicted_prs_start_index) samples,
+    // so a stream doesn't have to be read further ahead than the PRS symbol.
+    std::optional<int> track_prs_start_index(
+        const Eigen::Ref<const Eigen::VectorXcf>& signal_td,
+        std::optional<int> coarse_frequency_offset,
+        int predicted_prs_start_index);
+
+    static constexpr int get_tracking_length(int predicted_prs_start_index)
+    {
+        return predicted_prs_start_index - REFINEMENT_RANGE + REFINEMENT_LENGTH;
+    }
+
+private:
+    TimeSynchronizer(const PrsCorrelator<Mode>& frame_prs_correlator, const PrsCorrelator<Mode>& refinement_prs_correlator);
+
+    // The range in samples around the coarse estimation of the Null symbol detector or the prediction
+    // which is searched by the refinement.
+    static constexpr int REFINEMENT_RANGE = Mode::T_G;
+
+    // The minimum ratio between the peak power and the mean power of the refinement correlation.
+    // Otherwise, the coarse estimation is assumed to be wrong.
+    static constexpr float MIN_REFINEMENT_PEAK_TO_MEAN_RATIO = 100.0f;
+
+    // The length of the signal used for the refinement.
+    static constexpr int REFINEMENT_LENGTH = DabConstants::next_power_of_two(Mode::T_S + 2 * REFINEMENT_RANGE);
+
+    std::optional<int> refine_prs_start_index(const Eigen::Ref<const Eigen::VectorXcf>& signal_td, int coarse_prs_start_index, std::optional<int> coarse_frequency_offset);
+
+    PrsCorrelator<Mode> m_frame_prs_correlator;
+    PrsCorrelator<Mode> m_refinement_prs_correlator;
 };
\ No newline at end of file
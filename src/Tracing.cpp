@@ -0,0 +1,126 @@
+#include "Tracing.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Tracing
+{
+    // The number of spans per thread which are kept, e.g. about 800 frames of the transmission mode I.
+    static constexpr uint64_t RING_BUFFER_SIZE = 1 << 16;
+
+    struct ThreadRingBuffer
+    {
+        int thread_index;
+        std::vector<SpanRecord> span_records;
+
+        // The number of spans which were ever recorded.
+        // Only the owning thread writes it, so it is only atomic for the export.
+        std::atomic<uint64_t> number_of_span_records;
+    };
+
+    static std::atomic<bool> g_is_enabled{ false };
+
+    // The time stamps at which tracing was enabled to convert the time stamp counter into microseconds.
+    static uint64_t g_start_timestamp;
+    static std::chrono::steady_clock::time_point g_start_time;
+
+    // The ring buffers are kept beyond the lifetime of their threads until they are written.
+    static std::mutex g_ring_buffers_mutex;
+    static std::vector<std::unique_ptr<ThreadRingBuffer>> g_ring_buffers;
+
+    static thread_local ThreadRingBuffer* t_ring_buffer = nullptr;
+
+    void enable()
+    {
+        g_start_timestamp = read_timestamp();
+        g_start_time = std::chrono::steady_clock::now();
+        g_is_enabled.store(true, std::memory_order_release);
+    }
+
+    bool is_enabled()
+    {
+        return g_is_enabled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t read_timestamp()
+    {
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // The ring buffer of a thread is created by its first span.
+    void record(const SpanRecord& span_record)
+    {
+        if (t_ring_buffer == nullptr)
+        {
+            auto lock{ std::lock_guard<std::mutex>(g_ring_buffers_mutex) };
+            auto ring_buffer = std::make_unique<ThreadRingBuffer>();
+            ring_buffer->thread_index = static_cast<int>(g_ring_buffers.size());
+            ring_buffer->span_records.resize(RING_BUFFER_SIZE);
+            ring_buffer->number_of_span_records.store(0);
+            t_ring_buffer = ring_buffer.get();
+            g_ring_buffers.push_back(std::move(ring_buffer));
+        }
+
+        auto number_of_span_records = t_ring_buffer->number_of_span_records.load(std::memory_order_relaxed);
+        t_ring_buffer->span_records[number_of_span_records % RING_BUFFER_SIZE] = span_record;
+        t_ring_buffer->number_of_span_records.store(number_of_span_records + 1, std::memory_order_release);
+    }
+
+    bool write_chrome_trace(const std::string& file_path)
+    {
+        auto ofstream{ std::ofstream(file_path) };
+        if (!ofstream.is_open())
+        {
+            return false;
+        }
+
+        // The time stamp counter runs at a constant rate on all CPUs which support tracing by it.
+        auto elapsed_microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - g_start_time).count();
+        auto elapsed_ticks = static_cast<double>(read_timestamp() - g_start_timestamp);
+        auto microseconds_per_tick = elapsed_ticks > 0 ? elapsed_microseconds / elapsed_ticks : 0.0;
+
+        auto lock{ std::lock_guard<std::mutex>(g_ring_buffers_mutex) };
+        ofstream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        ofstream.precision(3);
+        ofstream << std::fixed;
+
+        auto is_first_event = true;
+        for (const auto& ring_buffer : g_ring_buffers)
+        {
+            if (!is_first_event)
+            {
+                ofstream << ',';
+            }
+            is_first_event = false;
+            ofstream << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring_buffer->thread_index
+                << ",\"args\":{\"name\":\"receiver thread " << ring_buffer->thread_index << "\"}}";
+
+            auto number_of_span_records = ring_buffer->number_of_span_records.load(std::memory_order_acquire);
+            auto first_span_record = number_of_span_records > RING_BUFFER_SIZE ? number_of_span_records - RING_BUFFER_SIZE : 0;
+            for (auto i = first_span_record; i < number_of_span_records; i++)
+            {
+                const auto& span_record = ring_buffer->span_records[i % RING_BUFFER_SIZE];
+                auto start = (static_cast<double>(span_record.start_timestamp) - static_cast<double>(g_start_timestamp)) * microseconds_per_tick;
+                auto duration = static_cast<double>(span_record.end_timestamp - span_record.start_timestamp) * microseconds_per_tick;
+                ofstream << ",\n{\"name\":\"" << span_record.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring_buffer->thread_index
+                    << ",\"ts\":" << start << ",\"dur\":" << duration << '}';
+            }
+        }
+
+        ofstream << "\n]}\n";
+        return static_cast<bool>(ofstream);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "PerfCounters.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Records spans around the stages of the receiver and writes them as Chrome trace events
+// which can be viewed by chrome://tracing or Perfetto.
+// Each thread records into its own ring buffer, so recording needs no lock.
+// If the ring buffer is full, the oldest spans are overwritten.
+// While tracing is disabled, a span costs only the check of a flag.
+namespace Tracing
+{
+    // A span of which the name must be a string literal since only the pointer is stored.
+    struct SpanRecord
+    {
+        const char* name;
+        uint64_t start_timestamp;
+        uint64_t end_timestamp;
+    };
+
+    // Starts to record spans.
+    void enable();
+
+    bool is_enabled();
+
+    // Returns the time stamp counter of the CPU or, on other architectures, a steady clock in nanoseconds.
+    uint64_t read_timestamp();
+
+    void record(const SpanRecord& span_record);
+
+    // Writes the recorded spans of all threads as trace event JSON.
+    // The threads mustn't record spans meanwhile.
+    // Returns whether the file could be written.
+    bool write_chrome_trace(const std::string& file_path);
+
+    // Records the time from its construction to its destruction if tracing is enabled
+    // and counts the events of the performance counters in between if they are enabled.
+    class ScopedSpan final
+    {
+    public:
+        explicit ScopedSpan(const char* name) :
+            m_name(name),
+            m_start_timestamp(is_enabled() ? read_timestamp() : 0),
+            m_is_counted(PerfCounters::is_enabled())
+        {
+            if (m_is_counted)
+            {
+                PerfCounters::read(m_start_counts);
+            }
+        }
+
+        ~ScopedSpan()
+        {
+            if (m_is_counted)
+            {
+                PerfCounters::add(m_name, m_start_counts);
+            }
+
+            if (m_start_timestamp != 0)
+            {
+                record(SpanRecord{ m_name, m_start_timestamp, read_timestamp() });
+            }
+        }
+
+        ScopedSpan(const ScopedSpan&) = delete;
+        ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_start_timestamp;
+        bool m_is_counted;
+        PerfCounters::Counts m_start_counts;
+    };
+}
\ No newline at end of file
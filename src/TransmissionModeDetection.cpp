@@ -0,0 +1,60 @@
+#include "TransmissionModeDetection.h"
+#include "DabConstants.h"
+
+#include <complex>
+
+using namespace DabConstants;
+
+// The minimum normalized correlation between the guard intervals and the symbol tails
+// which is required to accept a transmission mode.
+// The ideal value is T_G / T_S which is approximately 0.2 for all transmission modes.
+static constexpr float MIN_GUARD_INTERVAL_CORRELATION = 0.05f;
+
+// Determines the normalized correlation between the signal and the signal delayed by T_U.
+// Only the guard intervals contribute to this correlation because they are copies of the symbol tails.
+// Since the phase of each of these contributions only depends on the frequency offset,
+// all guard intervals of a transmission mode add up coherently.
+template <typename Mode>
+static float calculate_guard_interval_correlation(const Eigen::VectorXcf& signal_td)
+{
+    auto length = signal_td.size() - Mode::T_U;
+    auto signal = signal_td.head(length);
+    auto delayed_signal = signal_td.segment(Mode::T_U, length);
+
+    auto energy = signal.squaredNorm();
+    if (energy <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    return std::abs(signal.dot(delayed_signal)) / energy;
+}
+
+// Detects the transmission mode by the length of the useful part of the OFDM symbols.
+// The signal must comprise at least one DAB frame of the transmission mode I.
+std::optional<TransmissionModeId> TransmissionModeDetection::detect(const Eigen::VectorXcf& signal_td)
+{
+    const std::pair<TransmissionModeId, float> correlations[] =
+    {
+        { TransmissionModeId::I, calculate_guard_interval_correlation<TransmissionModeI>(signal_td) },
+        { TransmissionModeId::II, calculate_guard_interval_correlation<TransmissionModeII>(signal_td) },
+        { TransmissionModeId::III, calculate_guard_interval_correlation<TransmissionModeIII>(signal_td) },
+        { TransmissionModeId::IV, calculate_guard_interval_correlation<TransmissionModeIV>(signal_td) }
+    };
+
+    auto best_correlation = correlations[0];
+    for (const auto& correlation : correlations)
+    {
+        if (correlation.second > best_correlation.second)
+        {
+            best_correlation = correlation;
+        }
+    }
+
+    if (best_correlation.second < MIN_GUARD_INTERVAL_CORRELATION)
+    {
+        return std::nullopt;
+    }
+
+    return best_correlation.first;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "DabConstants.h"
+
+#include "Eigen/Dense"
+
+#include <optional>
+
+namespace TransmissionModeDetection
+{
+    std::optional<DabConstants::TransmissionModeId> detect(const Eigen::VectorXcf& signal_td);
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "Viterbi.h";
+#include "PackedBits.h"
+#include "Tracing.h"
 
+#include <algorithm>
 #include <iostream>;
 
 ConvolutionalCodeConfig::ConvolutionalCodeConfig(
@@ -21,30 +24,144 @@ ConvolutionalCodeConfig::ConvolutionalCodeConfig(
 
 }
 
-Viterbi::Viterbi(const std::shared_ptr<ConvolutionalCodeConfig>& convolutional_code_config, int l_conv_codeword) :
+Viterbi::Viterbi(const std::shared_ptr<ConvolutionalCodeConfig>& convolutional_code_config, int l_conv_codeword, bool is_adaptive) :
     m_convolutional_code_config(convolutional_code_config),
     m_l_conv_codeword(l_conv_codeword),
+    m_packed_output_by_state_transition(Eigen::MatrixX<uint8_t>::Zero(convolutional_code_config->n_states, convolutional_code_config->n_states)),
+    m_previous_states_by_state(convolutional_code_config->n_states, convolutional_code_config->previous_states_by_state.at(0).size()),
+    m_packed_previous_outputs(m_previous_states_by_state.rows(), m_previous_states_by_state.cols()),
+    m_packed_outputs_by_state_and_input(convolutional_code_config->n_states, convolutional_code_config->next_state_by_state_and_input.cols()),
+    m_branch_metrics(1 << convolutional_code_config->n_conv_output),
+    m_kernels(Kernels::get()),
     m_time_length((l_conv_codeword / convolutional_code_config->n_conv_output) + 1),
     m_viterbi_matrix(convolutional_code_config->n_states, m_time_length),
-    m_best_states(m_time_length)
+    m_best_states(m_time_length),
+    m_is_adaptive(is_adaptive),
+    m_number_of_runs(0),
+    m_number_of_escalations(0)
 {
+    // The add-compare-select kernels expect 2 previous states per state.
+    assert(m_previous_states_by_state.cols() == 2);
 
+    // The lookups of the map and the vectors of the config are flattened into tables.
+    for (int state_index = 0; state_index < convolutional_code_config->n_states; state_index++)
+    {
+        const auto& previous_states = convolutional_code_config->previous_states_by_state.at(state_index);
+        for (int i = 0; i < static_cast<int>(previous_states.size()); i++)
+        {
+            auto previous_state_index = previous_states[i];
+            m_previous_states_by_state(state_index, i) = previous_state_index;
+
+            const auto& output = convolutional_code_config->output_by_state_transition(previous_state_index, state_index);
+            for (int bit_index = 0; bit_index < convolutional_code_config->n_conv_output; bit_index++)
+            {
+                m_packed_output_by_state_transition(previous_state_index, state_index) |= output[bit_index] << bit_index;
+            }
+            m_packed_previous_outputs(state_index, i) = m_packed_output_by_state_transition(previous_state_index, state_index);
+        }
+    }
+
+    for (int state_index = 0; state_index < convolutional_code_config->n_states; state_index++)
+    {
+        for (int bit = 0; bit < m_packed_outputs_by_state_and_input.cols(); bit++)
+        {
+            auto next_state_index = convolutional_code_config->next_state_by_state_and_input(state_index, bit);
+            m_packed_outputs_by_state_and_input(state_index, bit) = m_packed_output_by_state_transition(state_index, next_state_index);
+        }
+    }
 }
 
 int Viterbi::run(
-    const Eigen::VectorX<uint8_t>& depunctured_received_bits,
-    const Eigen::VectorX<uint8_t>& puncturing_mask,
+    const Eigen::Ref<const Eigen::VectorX<uint64_t>>& depunctured_received_bits,
+    const Eigen::VectorX<uint64_t>& puncturing_mask,
+    Eigen::VectorX<uint8_t>& decoded_bits)
+{
+    auto span{ Tracing::ScopedSpan("Viterbi::run") };
+
+    assert(PackedBits::get_number_of_words(m_l_conv_codeword) == depunctured_received_bits.size());
+    m_number_of_runs++;
+
+    if (m_is_adaptive)
+    {
+        auto number_of_error_bits = decode_directly(depunctured_received_bits, puncturing_mask, decoded_bits);
+        if (number_of_error_bits.has_value())
+        {
+            return number_of_error_bits.value();
+        }
+        m_number_of_escalations++;
+    }
+
+    return decode_by_trellis(depunctured_received_bits, puncturing_mask, decoded_bits);
+}
+
+int64_t Viterbi::get_number_of_runs() const
+{
+    return m_number_of_runs;
+}
+
+int64_t Viterbi::get_number_of_escalations() const
+{
+    return m_number_of_escalations;
+}
+
+// Every output bit of the code depends on the input bit, so the received bits of a time step
+// vote for the input bit given the state, and a single error bit is outvoted by the other unpunctured bits.
+// The number of error bits is the distance between the received bits and the outputs of the decided transitions,
+// i.e. the re-encoded decided bits.
+// A wrong decision leads to wrong states for the next time steps whose outputs differ in many bits,
+// so the decoding is aborted early once the error bits exceed the maximum.
+std::optional<int> Viterbi::decode_directly(
+    const Eigen::Ref<const Eigen::VectorX<uint64_t>>& depunctured_received_bits,
+    const Eigen::VectorX<uint64_t>& puncturing_mask,
+    Eigen::VectorX<uint8_t>& decoded_bits)
+{
+    auto span{ Tracing::ScopedSpan("Viterbi::decode_directly") };
+
+    decoded_bits.setZero(m_time_length - 1);
+    auto state_index = 0;
+    auto number_of_error_bits = 0;
+    for (int time = 0; time < m_time_length - 1; time++)
+    {
+        auto bit_index = m_convolutional_code_config->n_conv_output * time;
+        auto received_bits_group = PackedBits::read_bits(depunctured_received_bits.data(), bit_index, m_convolutional_code_config->n_conv_output);
+        auto puncturing_group = PackedBits::read_bits(puncturing_mask.data(), bit_index, m_convolutional_code_config->n_conv_output);
+
+        auto distance_0 = PackedBits::popcount((received_bits_group ^ m_packed_outputs_by_state_and_input(state_index, 0)) & puncturing_group);
+        auto distance_1 = PackedBits::popcount((received_bits_group ^ m_packed_outputs_by_state_and_input(state_index, 1)) & puncturing_group);
+        auto bit = distance_1 < distance_0 ? 1 : 0;
+
+        number_of_error_bits = number_of_error_bits + std::min(distance_0, distance_1);
+        if (number_of_error_bits > MAX_DIRECT_ERROR_BITS)
+        {
+            return std::nullopt;
+        }
+
+        decoded_bits[time] = bit;
+        state_index = m_convolutional_code_config->next_state_by_state_and_input(state_index, bit);
+    }
+
+    // The tail bits of every codeword return the encoder to the state 0.
+    if (state_index != 0)
+    {
+        return std::nullopt;
+    }
+
+    return number_of_error_bits;
+}
+
+int Viterbi::decode_by_trellis(
+    const Eigen::Ref<const Eigen::VectorX<uint64_t>>& depunctured_received_bits,
+    const Eigen::VectorX<uint64_t>& puncturing_mask,
     Eigen::VectorX<uint8_t>& decoded_bits)
 {
-    auto length_of_received_bits = static_cast<int>(depunctured_received_bits.size());
-    assert(m_l_conv_codeword == length_of_received_bits);
     auto end_time = m_time_length - 1;
 
     // Reset the viterbi matrix buffer.
     // We know that the state at time 0 is 0.
     // Hence, the number of error bits of the state 0 is set to 0.
     // The number of the other states at time 0 is set to the maximum possible integer.
-    m_viterbi_matrix = Eigen::MatrixX<int>::Zero(m_convolutional_code_config->n_states, m_time_length);
+    // The buffers are only overwritten here and never resized, so no heap allocation happens per call.
+    m_viterbi_matrix.setZero();
     for (int row = 0; row < m_convolutional_code_config->n_states; row++)
     {
         m_viterbi_matrix(row, 0) = INT_MAX;
@@ -52,77 +169,45 @@ int Viterbi::run(
     m_viterbi_matrix(0, 0) = 0;
 
     // In the forward direction we determine the minimum number of error bits per state and time step.
+    // The Hamming distance of a state transition is the number of differing bits which aren't punctured.
+    // Since it only depends on the output of the transition, it is calculated once per possible output and time step.
+    auto n_previous_states = static_cast<int>(m_previous_states_by_state.cols());
     for (int time = 1; time < m_time_length; time++)
     {
-        auto received_bits_group =
-            depunctured_received_bits.segment(m_convolutional_code_config->n_conv_output * (time - 1), m_convolutional_code_config->n_conv_output).eval();
-        auto puncturing_group =
-            puncturing_mask.segment(m_convolutional_code_config->n_conv_output * (time - 1), m_convolutional_code_config->n_conv_output).eval();
+        auto bit_index = m_convolutional_code_config->n_conv_output * (time - 1);
+        auto received_bits_group = PackedBits::read_bits(depunctured_received_bits.data(), bit_index, m_convolutional_code_config->n_conv_output);
+        auto puncturing_group = PackedBits::read_bits(puncturing_mask.data(), bit_index, m_convolutional_code_config->n_conv_output);
 
-        for (int state_index = 0; state_index < m_convolutional_code_config->n_states; state_index++)
+        for (int output = 0; output < m_branch_metrics.size(); output++)
         {
-            auto distance = INT_MAX;
-            auto possible_previous_states = m_convolutional_code_config->previous_states_by_state[state_index];
-
-            for (auto previous_state_index : possible_previous_states)
-            {
-                auto possible_previous_distance = m_viterbi_matrix(previous_state_index, time - 1);
-                auto possible_output = m_convolutional_code_config->output_by_state_transition(previous_state_index, state_index);
-
-                // Determine the Hamming distance.
-                auto hamming_distance = 0;
-                for (int i = 0; i < m_convolutional_code_config->n_conv_output; i++)
-                {
-                    if (puncturing_group[i] == 1)
-                    {
-                        if (received_bits_group[i] != possible_output[i])
-                        {
-                            hamming_distance += 1;
-                        }
-                    }
-                }
-
-                auto possible_distance = INT_MAX;
-                if (possible_previous_distance < INT_MAX)
-                {
-                    possible_distance = possible_previous_distance + hamming_distance;
-                }
-
-                if (possible_distance < distance)
-                {
-                    distance = possible_distance;
-                }
-            }
-
-            m_viterbi_matrix(state_index, time) = distance;
+            m_branch_metrics[output] = PackedBits::popcount((received_bits_group ^ output) & puncturing_group);
         }
+
+        m_kernels.add_compare_select(
+            &m_viterbi_matrix(0, time - 1),
+            &m_viterbi_matrix(0, time),
+            m_previous_states_by_state.data(),
+            m_packed_previous_outputs.data(),
+            m_branch_metrics.data(),
+            m_convolutional_code_config->n_states);
     }
 
     // In the backward direction we select the state with the minimum number of error bits.
 
     // First we reset the selected states from a previous run.
-    m_best_states = Eigen::VectorX<uint8_t>::Zero(m_time_length);
+    m_best_states.setZero();
 
-    // Find the best state at the end time.
-    auto best_value = m_viterbi_matrix(0, end_time);
-    auto chosen_state_index = 0;
-    for (int state_index = 0; state_index < m_convolutional_code_config->n_states; state_index++)
-    {
-        auto value = m_viterbi_matrix(state_index, end_time);
-        if (value < best_value)
-        {
-            chosen_state_index = state_index;
-        }
-    }
-    m_best_states[end_time] = chosen_state_index;
+    // The tail bits of every codeword return the encoder to the state 0, so the path ends there
+    // like in the direct decoding.
+    m_best_states[end_time] = 0;
 
     // Go back in time and select the state with the minimum number of error bits.
     for (auto time = end_time; time > 0; time--)
     {
-        auto possible_previous_states = m_convolutional_code_config->previous_states_by_state[m_best_states[time]];
-        best_value = INT_MAX;
-        for (auto previous_state_index : possible_previous_states)
+        auto best_value = INT_MAX;
+        for (int i = 0; i < n_previous_states; i++)
         {
+            auto previous_state_index = m_previous_states_by_state(m_best_states[time], i);
             auto value = m_viterbi_matrix(previous_state_index, time - 1);
             if (value < best_value)
             {
@@ -133,7 +218,7 @@ int Viterbi::run(
     }
 
     // Determine the decoded_bits by going again forward in time and using the best state per time step.
-    decoded_bits = Eigen::VectorX<uint8_t>::Zero(m_time_length - 1);
+    decoded_bits.setZero(m_time_length - 1);
     for (int time = 0; time < m_time_length - 1; time++)
     {
         auto decoded_bit = m_convolutional_code_config->input_by_state_transition(m_best_states[time], m_best_states[time + 1]);
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "Kernels.h"
+
 #include "Eigen/Dense";
 
 #include <map>
+#include <optional>
 
 struct ConvolutionalCodeConfig
 {
@@ -47,22 +50,67 @@ struct ConvolutionalCodeConfig
 class Viterbi final
 {
 public:
-    Viterbi(const std::shared_ptr<ConvolutionalCodeConfig>& convolutional_code_config, int l_conv_codeword);
+    // In the adaptive mode, every codeword is first decoded along a single path, see decode_directly,
+    // and only escalated to the full trellis if this path has too many error bits.
+    // So the effort scales with the quality of the reception.
+    Viterbi(const std::shared_ptr<ConvolutionalCodeConfig>& convolutional_code_config, int l_conv_codeword, bool is_adaptive = false);
 
     // Determines the decoded_bits and returns the number of error bits
     // found in the last time step of the Viterbi algorithm.
+    // The received bits and the puncturing mask are packed into 64-bit words.
     int run(
-        const Eigen::VectorX<uint8_t>& depunctured_received_bits,
-        const Eigen::VectorX<uint8_t>& puncturing_mask,
+        const Eigen::Ref<const Eigen::VectorX<uint64_t>>& depunctured_received_bits,
+        const Eigen::VectorX<uint64_t>& puncturing_mask,
         Eigen::VectorX<uint8_t>& decoded_bits);
 
+    int64_t get_number_of_runs() const;
+
+    // Returns the number of runs of the adaptive mode which were escalated to the full trellis.
+    int64_t get_number_of_escalations() const;
+
 private:
+    // The maximum number of error bits of a directly decoded codeword.
+    // It lies well below half the free distance of the punctured code, so the directly decoded codeword
+    // is expected to be the one which the full trellis finds, too. This isn't proven; on the synthetic captures,
+    // the full trellis decoded all of 609 directly accepted codewords (148 of them with 1 to 4 error bits) identically.
+    static constexpr int MAX_DIRECT_ERROR_BITS = 4;
+
+    // Decides each input bit by the received bits of its time step given the state reached by the bits decided before.
+    // Returns the number of error bits or nothing if there are too many or if the codeword doesn't end in the state 0.
+    std::optional<int> decode_directly(
+        const Eigen::Ref<const Eigen::VectorX<uint64_t>>& depunctured_received_bits,
+        const Eigen::VectorX<uint64_t>& puncturing_mask,
+        Eigen::VectorX<uint8_t>& decoded_bits);
+
+    int decode_by_trellis(
+        const Eigen::Ref<const Eigen::VectorX<uint64_t>>& depunctured_received_bits,
+        const Eigen::VectorX<uint64_t>& puncturing_mask,
+        Eigen::VectorX<uint8_t>& decoded_bits);
+
     // The convolutional code config.
     std::shared_ptr<ConvolutionalCodeConfig> m_convolutional_code_config;
 
     // The length of the convolutional codeword.
     int m_l_conv_codeword;
 
+    // The output bits of each state transition packed into one byte, see output_by_state_transition.
+    // The first output bit is the least significant bit so that it can be compared with the packed received bits.
+    Eigen::MatrixX<uint8_t> m_packed_output_by_state_transition;
+
+    // Each row contains the previous states of a state, see previous_states_by_state.
+    Eigen::MatrixX<uint8_t> m_previous_states_by_state;
+
+    // The packed outputs of the transitions from the previous states in m_previous_states_by_state.
+    Eigen::MatrixX<uint8_t> m_packed_previous_outputs;
+
+    // The packed outputs of the transitions to the next states, see next_state_by_state_and_input.
+    Eigen::MatrixX<uint8_t> m_packed_outputs_by_state_and_input;
+
+    // The Hamming distance between the received bits of the current time step and each possible packed output.
+    Eigen::VectorXi m_branch_metrics;
+
+    const Kernels::KernelTable& m_kernels;
+
     // The length of the input vector to the convolutional encoder.
     // Correponds directly to m_l_conv_codeword.
     int m_time_length;
@@ -75,4 +123,8 @@ private:
     // The chosen states per time step.
     // The length of this vector is equal to m_time_length.
     Eigen::VectorX<uint8_t> m_best_states;
+
+    bool m_is_adaptive;
+    int64_t m_number_of_runs;
+    int64_t m_number_of_escalations;
 };
@@ -0,0 +1,105 @@
+#include "WidebandController.h"
+#include "DabConstants.h"
+#include "RawFileHandler.h"
+#include "Resampler.h"
+#include "Channelizer.h"
+
+#include "fmt/printf.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace DabConstants;
+
+WidebandController::WidebandController(const ReceiverOptions& options, FicBlockCallback fic_block_callback) :
+    m_options(options),
+    m_fic_block_callback(std::move(fic_block_callback))
+{
+
+}
+
+bool WidebandController::run(const std::string& file_path)
+{
+    if (m_options.sample_rate < MIN_INPUT_SAMPLE_RATE)
+    {
+        fmt::println("The sample rate of a wideband capture must be at least {} samples per second.", MIN_INPUT_SAMPLE_RATE);
+        return false;
+    }
+
+    if (!are_channel_frequencies_valid())
+    {
+        fmt::println("Every channel must lie within the bandwidth of the capture, i.e. within +-{} Hz.", m_options.sample_rate / 2 - DAB_HALF_BANDWIDTH);
+        return false;
+    }
+
+    auto file_sample_source = std::shared_ptr<SampleSource>(open_sample_file(file_path, m_options.sample_format));
+    auto channelizer{ Channelizer(file_sample_source, m_options.sample_rate, m_options.channel_frequencies) };
+    fmt::println("Splitting the capture into {} channels of {} samples per second.", m_options.channel_frequencies.size(), channelizer.get_channel_sample_rate());
+
+    // Each receiver runs on a stream at the sample rate of the receiver
+    // because the channels are already resampled.
+    auto channel_options{ m_options };
+    channel_options.sample_rate = SAMPLE_RATE;
+    channel_options.use_frame_index = false;
+
+    auto number_of_failed_channels{ std::atomic<int>(0) };
+    auto receiver_threads{ std::vector<std::thread>() };
+    for (int i = 0; i < static_cast<int>(m_options.channel_frequencies.size()); i++)
+    {
+        // Every channel records its own checkpoint.
+        if (m_options.checkpoint_file_path.has_value())
+        {
+            channel_options.checkpoint_file_path = fmt::format("{}.{}", m_options.checkpoint_file_path.value(), i);
+        }
+
+        // Every channel publishes to its own shared memory since a ring has a single publisher.
+        if (m_options.shared_memory_name.has_value())
+        {
+            channel_options.shared_memory_name = fmt::format("{}.{}", m_options.shared_memory_name.value(), i);
+        }
+
+        auto channel_queue = channelizer.get_channel_queue(i);
+        auto resampler = std::make_unique<Resampler>(channel_queue, channelizer.get_channel_sample_rate(), SAMPLE_RATE);
+        receiver_threads.emplace_back([this, &number_of_failed_channels, channel_options, channel_queue, resampler = std::move(resampler)]()
+        {
+            auto main_controller{ MainController(channel_options, m_fic_block_callback) };
+            if (!main_controller.run(*resampler, resampler.get()))
+            {
+                number_of_failed_channels++;
+            }
+
+            // The channelizer mustn't wait for a receiver which has stopped reading.
+            channel_queue->cancel();
+        });
+    }
+
+    auto channelizer_thread{ std::thread([&channelizer]() { channelizer.run(); }) };
+
+    for (auto& receiver_thread : receiver_threads)
+    {
+        receiver_thread.join();
+    }
+    channelizer_thread.join();
+
+    return number_of_failed_channels == 0;
+}
+
+bool WidebandController::are_channel_frequencies_valid() const
+{
+    if (m_options.channel_frequencies.empty())
+    {
+        return false;
+    }
+
+    for (auto channel_frequency : m_options.channel_frequencies)
+    {
+        if (std::abs(channel_frequency) > m_options.sample_rate / 2 - DAB_HALF_BANDWIDTH)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
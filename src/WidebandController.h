@@ -0,0 +1,28 @@
+#pragma once
+
+#include "MainController.h"
+
+#include <string>
+
+// Receives several DAB channels of a wideband capture at once.
+// The channelizer splits the capture into the channels in its own thread
+// while every channel is resampled to the sample rate of the receiver and decoded by its own receiver thread.
+class WidebandController final
+{
+public:
+    // The callback is called for every decoded FIC block of every channel,
+    // so it is called by several threads.
+    WidebandController(const ReceiverOptions& options, FicBlockCallback fic_block_callback);
+
+    // Returns whether the run succeeded for all channels.
+    bool run(const std::string& file_path);
+
+private:
+    // The channelizer needs a bin spacing of about 400 kHz with 8 times oversampling.
+    static constexpr int MIN_INPUT_SAMPLE_RATE = 3'200'000;
+
+    ReceiverOptions m_options;
+    FicBlockCallback m_fic_block_callback;
+
+    bool are_channel_frequencies_valid() const;
+};
\ No newline at end of file
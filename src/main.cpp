@@ -1,20 +1,548 @@
 ﻿#include "MainController.h"
+#include "WidebandController.h"
+#include "Receiver.h"
+#include "RawFileHandler.h"
+#include "CaptureScanner.h"
+#include "IqArchive.h"
+#include "Kernels.h"
+#include "SuperframeDecoder.h"
+#include "Tracing.h"
+#include "PerfCounters.h"
+#include "SharedMemoryRing.h"
+#include "DabConstants.h"
 
 #include <fmt/printf.h>
 
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
 
-int main(int argc, char* argv[])
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+static std::optional<DabConstants::TransmissionModeId> parse_transmission_mode_id(const std::string& value)
+{
+    if (value == "I")
+    {
+        return DabConstants::TransmissionModeId::I;
+    }
+    else if (value == "II")
+    {
+        return DabConstants::TransmissionModeId::II;
+    }
+    else if (value == "III")
+    {
+        return DabConstants::TransmissionModeId::III;
+    }
+    else if (value == "IV")
+    {
+        return DabConstants::TransmissionModeId::IV;
+    }
+
+    return std::nullopt;
+}
+
+// Parses a comma separated list of frequencies in Hz, e.g. -1712000,0,1712000.
+static std::optional<std::vector<int>> parse_channel_frequencies(const std::string& value)
+{
+    auto channel_frequencies{ std::vector<int>() };
+    auto stream{ std::istringstream(value) };
+    auto token{ std::string() };
+    while (std::getline(stream, token, ','))
+    {
+        auto end{ static_cast<char*>(nullptr) };
+        auto channel_frequency = std::strtol(token.c_str(), &end, 10);
+        if (token.empty() || *end != '\0')
+        {
+            return std::nullopt;
+        }
+        channel_frequencies.push_back(static_cast<int>(channel_frequency));
+    }
+
+    if (channel_frequencies.empty())
+    {
+        return std::nullopt;
+    }
+
+    return channel_frequencies;
+}
+
+static void print_fic_block(const FicBlock& fic_block)
+{
+    fmt::println("The number of error bits is {} for the FIC block {}.", fic_block.number_of_error_bits, fic_block.fic_block_index);
+}
+
+// Pushes the samples of the standard input into the receiver.
+static int receive_standard_input(const ReceiverOptions& options)
+{
+#if defined(_WIN32)
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+    constexpr int N_SAMPLES_PER_PUSH = 16'384;
+    auto bytes_per_sample = RawFileHandler::get_bytes_per_sample(options.sample_format);
+    auto buffer{ std::vector<uint8_t>(N_SAMPLES_PER_PUSH * bytes_per_sample) };
+
+    auto receiver{ Receiver(options, print_fic_block) };
+    while (true)
+    {
+        auto number_of_samples = static_cast<int>(std::fread(buffer.data(), bytes_per_sample, N_SAMPLES_PER_PUSH, stdin));
+        if (number_of_samples == 0)
+        {
+            break;
+        }
+        receiver.push(buffer.data(), number_of_samples);
+    }
+
+    return receiver.finish() ? 0 : -1;
+}
+
+// Classifies each file of the given sample format and sample rate as DAB signal or not.
+static int scan(const std::vector<std::string>& file_paths, const ReceiverOptions& options)
+{
+    for (const auto& file_path : file_paths)
+    {
+        auto transmission_mode_id = CaptureScanner::scan(file_path, options.sample_format, options.sample_rate);
+        if (transmission_mode_id.has_value())
+        {
+            fmt::println("{}: DAB signal of the transmission mode {}.", file_path, DabConstants::get_transmission_mode_name(transmission_mode_id.value()));
+        }
+        else
+        {
+            fmt::println("{}: No DAB signal.", file_path);
+        }
+    }
+
+    return 0;
+}
+
+// Prints the entries of the shared memory of a receiver until it is interrupted, e.g. to monitor it.
+// It waits until the receiver has created the shared memory.
+static int subscribe(const std::string& name)
+{
+    constexpr auto POLLING_INTERVAL = std::chrono::milliseconds(10);
+    auto subscriber = std::make_unique<SharedMemorySubscriber>(name);
+    while (!subscriber->is_valid())
+    {
+        std::this_thread::sleep_for(POLLING_INTERVAL);
+        subscriber = std::make_unique<SharedMemorySubscriber>(name);
+    }
+
+    auto entry{ std::make_unique<SharedMemoryEntry>() };
+    while (true)
+    {
+        switch (subscriber->read(*entry))
+        {
+        case SharedMemorySubscriber::Result::ENTRY:
+        {
+            auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            fmt::println("Entry {} of the frame {} at {:.3f} s: FIC block {} with {} error bits{}, read {:.0f} us after its publication.",
+                entry->sequence.load(), entry->frame_number, 1e-9 * entry->frame_time, entry->index, entry->number_of_errors,
+                (entry->flags & SharedMemoryEntry::IS_CACHED) != 0 ? " from the cache" : "", 1e-3 * (now - entry->publish_time));
+            break;
+        }
+        case SharedMemorySubscriber::Result::NO_ENTRY:
+            std::this_thread::sleep_for(POLLING_INTERVAL);
+            break;
+        case SharedMemorySubscriber::Result::OVERRUN:
+            fmt::println("{} entries lost in total because the subscriber fell behind.", subscriber->get_number_of_lost_entries());
+            break;
+        }
+    }
+}
+
+// Converts a raw IQ file of cu8 samples into an IQ archive.
+static int compress(const std::string& input_file_path, const std::string& output_file_path, int n_kept_bits)
+{
+    constexpr int N_SAMPLES_PER_WRITE = 65'536;
+    auto ifstream{ std::ifstream(input_file_path, std::ios_base::binary) };
+    auto writer{ IqArchiveWriter(output_file_path, n_kept_bits) };
+    if (!ifstream.is_open() || !writer.is_open())
+    {
+        fmt::println("{} couldn't be compressed to {}.", input_file_path, output_file_path);
+        return -1;
+    }
+
+    auto buffer{ std::vector<uint8_t>(2 * N_SAMPLES_PER_WRITE) };
+    while (ifstream)
+    {
+        ifstream.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+        writer.write(buffer.data(), static_cast<int>(ifstream.gcount() / 2));
+    }
+
+    if (!writer.finish())
+    {
+        fmt::println("{} couldn't be written.", output_file_path);
+        return -1;
+    }
+
+    auto number_of_raw_bytes = 2 * writer.get_number_of_samples();
+    fmt::println("{} samples compressed from {} to {} bytes ({:.1f} %) with {} kept bits.",
+        writer.get_number_of_samples(), number_of_raw_bytes, writer.get_number_of_bytes(),
+        number_of_raw_bytes > 0 ? 100.0 * writer.get_number_of_bytes() / number_of_raw_bytes : 0.0, n_kept_bits);
+    return 0;
+}
+
+// Converts an IQ archive back into a raw IQ file of cu8 samples.
+static int decompress(const std::string& input_file_path, const std::string& output_file_path)
 {
-    if (argc != 2)
+    constexpr int N_SAMPLES_PER_READ = 65'536;
+    if (!IqArchive::is_archive(input_file_path))
     {
-        fmt::println("Please pass exactly one argument to this program; the file path of a raw IQ file where I and Q are of the type uint8_t.");
+        fmt::println("{} isn't an IQ archive.", input_file_path);
         return -1;
     }
 
-    auto file_path{ std::string(argv[1]) };
-    auto mainController{ MainController() };
-    mainController.run(file_path);
+    auto reader{ IqArchiveReader(input_file_path) };
+    auto ofstream{ std::ofstream(output_file_path, std::ios_base::binary) };
+    auto buffer{ std::vector<uint8_t>(2 * N_SAMPLES_PER_READ) };
+    auto number_of_samples = int64_t(0);
+    auto start_time = std::chrono::steady_clock::now();
+    while (true)
+    {
+        auto length = reader.read_raw(buffer.data(), N_SAMPLES_PER_READ);
+        if (length == 0)
+        {
+            break;
+        }
+        ofstream.write(reinterpret_cast<const char*>(buffer.data()), 2 * length);
+        number_of_samples = number_of_samples + length;
+    }
+    ofstream.close();
+    auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    if (ofstream.fail())
+    {
+        fmt::println("{} couldn't be written.", output_file_path);
+        return -1;
+    }
 
+    fmt::println("{} samples decompressed at {:.0f} MB/s of raw samples.", number_of_samples, duration > 0.0 ? 2 * number_of_samples / duration / 1e6 : 0.0);
     return 0;
 }
+
+// Runs the receiver for the file path which is either a raw IQ file, a wideband capture or - for the standard input.
+static int run(const std::string& file_path, const ReceiverOptions& options)
+{
+    if (file_path == "-")
+    {
+        return receive_standard_input(options);
+    }
+
+    if (!options.channel_frequencies.empty())
+    {
+        auto widebandController{ WidebandController(options, print_fic_block) };
+        return widebandController.run(file_path) ? 0 : -1;
+    }
+
+    auto mainController{ MainController(options, print_fic_block) };
+    return mainController.run(file_path) ? 0 : -1;
+}
+
+int main(int argc, char* argv[])
+{
+    auto file_paths{ std::vector<std::string>() };
+    auto options{ ReceiverOptions() };
+    auto scan_mode = false;
+    auto trace_file_path{ std::optional<std::string>() };
+    auto use_perf_counters = false;
+    auto subscribed_name{ std::optional<std::string>() };
+    auto compressed_file_path{ std::optional<std::string>() };
+    auto decompressed_file_path{ std::optional<std::string>() };
+    auto checkpoint_file_path{ std::optional<std::string>() };
+    auto n_kept_bits = 8;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto argument{ std::string(argv[i]) };
+        if (argument == "--mode" && i + 1 < argc)
+        {
+            options.transmission_mode_id = parse_transmission_mode_id(argv[++i]);
+            if (!options.transmission_mode_id.has_value())
+            {
+                fmt::println("The transmission mode must be one of I, II, III or IV.");
+                return -1;
+            }
+        }
+        else if (argument == "--sample-rate" && i + 1 < argc)
+        {
+            options.sample_rate = std::atoi(argv[++i]);
+            if (options.sample_rate <= 0)
+            {
+                fmt::println("The sample rate must be a positive number of samples per second.");
+                return -1;
+            }
+        }
+        else if (argument == "--format" && i + 1 < argc)
+        {
+            auto sample_format = parse_sample_format(argv[++i]);
+            if (!sample_format.has_value())
+            {
+                fmt::println("The sample format must be one of cu8, cs16 or cf32.");
+                return -1;
+            }
+            options.sample_format = sample_format.value();
+        }
+        else if (argument == "--channels" && i + 1 < argc)
+        {
+            auto channel_frequencies = parse_channel_frequencies(argv[++i]);
+            if (!channel_frequencies.has_value())
+            {
+                fmt::println("The channels must be a comma separated list of frequencies in Hz.");
+                return -1;
+            }
+            options.channel_frequencies = channel_frequencies.value();
+        }
+        else if (argument == "--first-frame" && i + 1 < argc)
+        {
+            options.first_frame = std::atoi(argv[++i]);
+        }
+        else if (argument == "--frame-count" && i + 1 < argc)
+        {
+            options.number_of_frames = std::atoi(argv[++i]);
+        }
+        else if (argument == "--chunks" && i + 1 < argc)
+        {
+            options.number_of_chunks = std::atoi(argv[++i]);
+            if (options.number_of_chunks.value() <= 0)
+            {
+                fmt::println("The number of chunks must be positive.");
+                return -1;
+            }
+        }
+        else if (argument == "--fic-interval" && i + 1 < argc)
+        {
+            options.fic_interval = std::atoi(argv[++i]);
+            if (options.fic_interval.value() <= 0)
+            {
+                fmt::println("The FIC interval must be a positive number of frames.");
+                return -1;
+            }
+        }
+        else if (argument == "--fic-on-change")
+        {
+            options.detect_fic_changes = true;
+        }
+        else if (argument == "--adaptive-viterbi")
+        {
+            options.use_adaptive_viterbi = true;
+        }
+        else if (argument == "--fic-cache" && i + 1 < argc)
+        {
+            options.fic_block_cache_capacity = std::atoi(argv[++i]);
+            if (options.fic_block_cache_capacity < 0)
+            {
+                fmt::println("The capacity of the FIC block cache must not be negative.");
+                return -1;
+            }
+        }
+        else if (argument == "--real-time" && i + 1 < argc)
+        {
+            options.real_time_speed = std::atof(argv[++i]);
+            if (options.real_time_speed.value() <= 0.0)
+            {
+                fmt::println("The real-time speed must be positive.");
+                return -1;
+            }
+        }
+        else if (argument == "--low-latency")
+        {
+            options.stream_symbols = true;
+        }
+        else if (argument == "--threads" && i + 1 < argc)
+        {
+            options.number_of_threads = std::atoi(argv[++i]);
+            if (options.number_of_threads <= 0)
+            {
+                fmt::println("The number of threads must be positive.");
+                return -1;
+            }
+        }
+        else if (argument == "--huge-pages")
+        {
+            options.use_huge_pages = true;
+        }
+        else if (argument == "--check-allocations")
+        {
+            options.check_allocations = true;
+        }
+        else if (argument == "--no-index")
+        {
+            options.use_frame_index = false;
+        }
+        else if (argument == "--trace" && i + 1 < argc)
+        {
+            trace_file_path = argv[++i];
+        }
+        else if (argument == "--perf-counters")
+        {
+            use_perf_counters = true;
+        }
+        else if (argument == "--perf-interval" && i + 1 < argc)
+        {
+            use_perf_counters = true;
+            options.perf_report_interval = std::atoi(argv[++i]);
+            if (options.perf_report_interval.value() <= 0)
+            {
+                fmt::println("The interval of the performance counters must be positive.");
+                return -1;
+            }
+        }
+        else if (argument == "--publish" && i + 1 < argc)
+        {
+            options.shared_memory_name = argv[++i];
+        }
+        else if (argument == "--subscribe" && i + 1 < argc)
+        {
+            subscribed_name = argv[++i];
+        }
+        else if (argument == "--compress" && i + 1 < argc)
+        {
+            compressed_file_path = argv[++i];
+        }
+        else if (argument == "--kept-bits" && i + 1 < argc)
+        {
+            n_kept_bits = std::atoi(argv[++i]);
+            if (n_kept_bits < 1 || n_kept_bits > 8)
+            {
+                fmt::println("The number of kept bits must be between 1 and 8.");
+                return -1;
+            }
+        }
+        else if (argument == "--decompress" && i + 1 < argc)
+        {
+            decompressed_file_path = argv[++i];
+        }
+        else if (argument == "--record" && i + 1 < argc)
+        {
+            options.checkpoint_file_path = argv[++i];
+        }
+        else if (argument == "--record-stage" && i + 1 < argc)
+        {
+            auto checkpoint_stage = parse_checkpoint_stage(argv[++i]);
+            if (!checkpoint_stage.has_value())
+            {
+                fmt::println("The checkpoint stage must be one of frames, carriers, hard-bits or codewords.");
+                return -1;
+            }
+            options.checkpoint_stage = checkpoint_stage.value();
+        }
+        else if (argument == "--replay" && i + 1 < argc)
+        {
+            checkpoint_file_path = argv[++i];
+        }
+        else if (argument == "--scan")
+        {
+            scan_mode = true;
+        }
+        else if (argument == "--self-test")
+        {
+            auto are_kernels_bit_exact = Kernels::run_self_test();
+            auto are_superframes_recovered = SuperframeDecoder::run_self_test();
+            return are_kernels_bit_exact && are_superframes_recovered ? 0 : -1;
+        }
+        else
+        {
+            file_paths.push_back(argument);
+        }
+    }
+
+    if (subscribed_name.has_value())
+    {
+        return subscribe(subscribed_name.value());
+    }
+
+    if (scan_mode && !file_paths.empty())
+    {
+        return scan(file_paths, options);
+    }
+
+    if (compressed_file_path.has_value() && file_paths.size() == 1)
+    {
+        return compress(file_paths[0], compressed_file_path.value(), n_kept_bits);
+    }
+
+    if (decompressed_file_path.has_value() && file_paths.size() == 1)
+    {
+        return decompress(file_paths[0], decompressed_file_path.value());
+    }
+
+    if (options.checkpoint_file_path.has_value() && options.checkpoint_stage == CheckpointStage::FRAMES && options.stream_symbols)
+    {
+        fmt::println("The frames can't be recorded with --low-latency because their samples are corrected while they arrive.");
+        return -1;
+    }
+
+    if (use_perf_counters)
+    {
+        PerfCounters::enable();
+    }
+
+    if (checkpoint_file_path.has_value())
+    {
+        auto mainController{ MainController(options, print_fic_block) };
+        auto is_replayed = mainController.replay(checkpoint_file_path.value());
+        if (use_perf_counters)
+        {
+            PerfCounters::print_report();
+        }
+        return is_replayed ? 0 : -1;
+    }
+
+    if (file_paths.size() != 1)
+    {
+        fmt::println("Please pass the file path of a raw IQ file where I and Q are of the type uint8_t to this program.");
+        fmt::println("Optionally, the transmission mode can be passed by --mode I|II|III|IV. Otherwise, it is detected.");
+        fmt::println("If the file isn't sampled at 2048000 samples per second, its sample rate must be passed by --sample-rate, e.g. --sample-rate 2400000.");
+        fmt::println("The start of every frame is written to a frame index next to the file which is used by later runs unless --no-index is passed.");
+        fmt::println("With --first-frame and --frame-count, only a range of frames is decoded. --chunks N prints N such ranges.");
+        fmt::println("With --fic-interval N, the FIC is only decoded every N frames and, with --fic-on-change, whenever its raw bits change.");
+        fmt::println("With --adaptive-viterbi, the FIC blocks are first decoded along a single path and only escalated to the full trellis if they have too many error bits.");
+        fmt::println("With --fic-cache N, the last N decoded FIC blocks are cached, so that repeated FIC blocks aren't decoded again (32 by default, 0 disables it).");
+        fmt::println("With --threads N, the FFTs of the symbols and the Viterbi decoding of the FIC blocks of each frame are shared by N threads.");
+        fmt::println("With --real-time S, every frame must be done before the next one arrives at S times real time. Otherwise, the MSC demodulation and, if far behind, whole frames are shed.");
+        fmt::println("With --low-latency, every frame is demodulated symbol by symbol as its samples arrive and its FIC is decoded before the rest of the frame is read. Once the timing is locked, no samples are read beyond the next PRS symbol before it is needed.");
+        fmt::println("With --check-allocations, the run fails if the frame loop allocates heap memory after the warm-up. --huge-pages backs the sample buffers by huge pages.");
+        fmt::println("Files of other sample formats are passed with --format cu8|cs16|cf32.");
+        fmt::println("With --channels f1,f2,..., a wideband capture is split into several DAB channels at these frequencies in Hz relative to its center, which are decoded in parallel.");
+        fmt::println("With --self-test, the kernels of every instruction set level which the CPU supports are compared with the scalar ones and synthetic DAB+ superframes are decoded.");
+        fmt::println("With - as file path, the samples are read from the standard input. Then, the transmission mode is I unless --mode is passed.");
+        fmt::println("With --trace out.json, spans of the stages are written as Chrome trace events which can be viewed by chrome://tracing or Perfetto.");
+        fmt::println("With --perf-counters, the cycles, instructions, cache misses and branch misses of the stages are counted by the performance counters of the CPU and printed at the end. --perf-interval N prints them every N frames, too.");
+        fmt::println("With --publish /name, the decoded FIC blocks are also published to a ring in the POSIX shared memory of this name, and --subscribe /name prints them from another process.");
+        fmt::println("With --compress out.iqz, a raw IQ file of cu8 samples is converted into an IQ archive which is read like a raw IQ file. It is lossless unless --kept-bits N drops the low bits of every value.");
+        fmt::println("With --decompress out.iq, an IQ archive is converted back into a raw IQ file of cu8 samples.");
+        fmt::println("With --record out.ckp, the data of every frame at a stage boundary are recorded. --record-stage frames|carriers|hard-bits|codewords selects the stage (hard-bits by default).");
+        fmt::println("With --replay out.ckp, only the stages after the recorded one are run on the recorded data and their throughput is printed.");
+        fmt::println("With --scan, any number of raw IQ files are only classified as DAB signal or not.");
+        return -1;
+    }
+
+    if (trace_file_path.has_value())
+    {
+        Tracing::enable();
+    }
+
+    auto result = run(file_paths[0], options);
+
+    if (use_perf_counters)
+    {
+        PerfCounters::print_report();
+    }
+
+    if (trace_file_path.has_value() && !Tracing::write_chrome_trace(trace_file_path.value()))
+    {
+        fmt::println("The trace couldn't be written to {}.", trace_file_path.value());
+        return -1;
+    }
+
+    return result;
+}